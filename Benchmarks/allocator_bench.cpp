@@ -0,0 +1,237 @@
+/*
+	Measures small-object churn through the allocators in exalloc.h against std::allocator:
+	allocating and freeing in stack order, freeing random live objects and replacing them,
+	a std::list used as a queue, and the random churn on several threads at once (with a size_class_pool per thread).
+	Prints CSV, one row per measurement, in nanoseconds per allocation and free.
+	Usage: allocator_bench [max threads] [operations]
+*/
+#include "../Utils/exalloc.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+	using clock_type=std::chrono::steady_clock;
+
+	double nanos_per(clock_type::time_point start,std::size_t operations)
+	{
+		return std::chrono::duration<double,std::nano>(clock_type::now()-start).count()/operations;
+	}
+
+	void report(char const* benchmark,char const* allocator,std::size_t threads,double value)
+	{
+		std::printf("%s,%s,%zu,%.3f,ns_per_op\n",benchmark,allocator,threads,value);
+	}
+
+	//a typical small node
+	struct object {
+		object* next;
+		std::size_t payload[3];
+	};
+
+	//objects live at once in the churn benchmarks
+	constexpr std::size_t live_objects=1024;
+
+	//makes each benchmark's allocator, once per thread
+	struct std_source {
+		static constexpr char const* name="std::allocator";
+		std::allocator<object> get() noexcept
+		{
+			return {};
+		}
+		void round_done() noexcept
+		{}
+	};
+
+	struct slab_source {
+		static constexpr char const* name="slab_allocator";
+		exlib::slab_allocator<object> get() noexcept
+		{
+			return {};
+		}
+		void round_done() noexcept
+		{}
+	};
+
+	struct pool_source {
+		static constexpr char const* name="pool_allocator";
+		exlib::size_class_pool pool;
+		exlib::pool_allocator<object> get() noexcept
+		{
+			return exlib::pool_allocator<object>(pool);
+		}
+		void round_done() noexcept
+		{}
+	};
+
+	//frees nothing until everything live is dropped, then resets
+	struct monotonic_source {
+		static constexpr char const* name="monotonic_allocator";
+		exlib::monotonic_arena arena;
+		exlib::monotonic_allocator<object> get() noexcept
+		{
+			return exlib::monotonic_allocator<object>(arena);
+		}
+		void round_done() noexcept
+		{
+			arena.reset();
+		}
+	};
+
+	template<typename Allocator>
+	object* make(Allocator& alloc,std::size_t value)
+	{
+		auto const obj=std::allocator_traits<Allocator>::allocate(alloc,1);
+		obj->next=nullptr;
+		obj->payload[0]=value;
+		return obj;
+	}
+
+	template<typename Allocator>
+	void destroy(Allocator& alloc,object* obj)
+	{
+		std::allocator_traits<Allocator>::deallocate(alloc,obj,1);
+	}
+
+	//allocates live_objects, then frees them newest first
+	template<typename Source>
+	double stack_churn(Source& source,std::size_t operations)
+	{
+		auto alloc=source.get();
+		std::vector<object*> live(live_objects);
+		auto const rounds=std::max<std::size_t>(operations/live_objects,1);
+		auto const start=clock_type::now();
+		for(std::size_t r=0;r<rounds;++r)
+		{
+			for(std::size_t i=0;i<live_objects;++i)
+			{
+				live[i]=make(alloc,i);
+			}
+			for(std::size_t i=live_objects;i-->0;)
+			{
+				destroy(alloc,live[i]);
+			}
+			source.round_done();
+		}
+		return nanos_per(start,rounds*live_objects);
+	}
+
+	//frees a random live object and replaces it, live_objects at a time
+	template<typename Source>
+	double random_churn(Source& source,std::size_t operations,unsigned seed)
+	{
+		auto alloc=source.get();
+		std::vector<object*> live(live_objects);
+		std::vector<std::uint16_t> order(live_objects);
+		std::mt19937 rng(seed);
+		for(auto& slot:order)
+		{
+			slot=static_cast<std::uint16_t>(rng()%live_objects);
+		}
+		auto const rounds=std::max<std::size_t>(operations/live_objects,1);
+		auto const start=clock_type::now();
+		for(std::size_t r=0;r<rounds;++r)
+		{
+			for(std::size_t i=0;i<live_objects;++i)
+			{
+				live[i]=make(alloc,i);
+			}
+			for(auto const slot:order)
+			{
+				destroy(alloc,live[slot]);
+				live[slot]=make(alloc,slot);
+			}
+			for(auto const obj:live)
+			{
+				destroy(alloc,obj);
+			}
+			source.round_done();
+		}
+		return nanos_per(start,rounds*live_objects*2);
+	}
+
+	//pushes to the back and pops from the front of a list holding live_objects
+	template<typename Source>
+	double list_queue(Source& source,std::size_t operations)
+	{
+		auto const rounds=std::max<std::size_t>(operations/live_objects,1);
+		auto const start=clock_type::now();
+		for(std::size_t r=0;r<rounds;++r)
+		{
+			{
+				using alloc_type=decltype(source.get());
+				std::list<std::size_t,typename std::allocator_traits<alloc_type>::template rebind_alloc<std::size_t>> queue(source.get());
+				for(std::size_t i=0;i<live_objects;++i)
+				{
+					queue.push_back(i);
+				}
+				for(std::size_t i=0;i<live_objects;++i)
+				{
+					queue.pop_front();
+					queue.push_back(i);
+				}
+			}
+			source.round_done();
+		}
+		return nanos_per(start,rounds*live_objects*2);
+	}
+
+	template<typename Source>
+	void bench_single(std::size_t operations)
+	{
+		Source source;
+		report("stack_churn",Source::name,1,stack_churn(source,operations));
+		report("random_churn",Source::name,1,random_churn(source,operations,1));
+		report("list_queue",Source::name,1,list_queue(source,operations));
+	}
+
+	//each thread churns with its own Source; reports the slowest thread
+	template<typename Source>
+	void bench_threads(std::size_t threads,std::size_t operations)
+	{
+		std::vector<double> results(threads);
+		std::vector<std::thread> workers;
+		for(std::size_t t=0;t<threads;++t)
+		{
+			workers.emplace_back([&results,t,operations]
+				{
+					Source source;
+					results[t]=random_churn(source,operations,static_cast<unsigned>(t+1));
+				});
+		}
+		for(auto& worker:workers)
+		{
+			worker.join();
+		}
+		report("threaded_random_churn",Source::name,threads,*std::max_element(results.begin(),results.end()));
+	}
+}
+
+int main(int argc,char** argv)
+{
+	auto const hardware=std::thread::hardware_concurrency();
+	std::size_t const max_threads=argc>1?std::strtoul(argv[1],nullptr,10):hardware?hardware:4;
+	std::size_t const operations=argc>2?std::strtoul(argv[2],nullptr,10):10000000;
+	std::printf("benchmark,allocator,threads,value,unit\n");
+	bench_single<std_source>(operations);
+	bench_single<slab_source>(operations);
+	bench_single<pool_source>(operations);
+	bench_single<monotonic_source>(operations);
+	for(std::size_t threads=2;threads<=max_threads;threads=std::min(threads*2,max_threads))
+	{
+		bench_threads<std_source>(threads,operations);
+		bench_threads<slab_source>(threads,operations);
+		bench_threads<pool_source>(threads,operations);
+		if(threads>=max_threads)
+		{
+			break;
+		}
+	}
+}
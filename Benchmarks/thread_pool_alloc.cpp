@@ -0,0 +1,93 @@
+/*
+	Counts heap allocations made while pushing small tasks to a thread_pool_a that has warmed up.
+	Usage: thread_pool_alloc [threads] [tasks]
+*/
+#include "../ThreadPool/thread_pool.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	std::atomic<std::size_t> allocation_count{0};
+}
+
+void* operator new(std::size_t n)
+{
+	++allocation_count;
+	if(auto const ptr=std::malloc(n?n:1))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr,std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace {
+	struct small_task {
+		std::atomic<std::size_t>* counter;
+		void operator()() noexcept
+		{
+			counter->fetch_add(1,std::memory_order_relaxed);
+		}
+	};
+
+	struct large_task {
+		std::atomic<std::size_t>* counter;
+		char payload[256];
+		void operator()() noexcept
+		{
+			counter->fetch_add(payload[0]+1,std::memory_order_relaxed);
+		}
+	};
+
+	template<typename Task>
+	std::size_t allocations_per_round(exlib::thread_pool& pool,std::size_t tasks,std::atomic<std::size_t>& counter)
+	{
+		Task task{};
+		task.counter=&counter;
+		auto const before=allocation_count.load();
+		for(std::size_t i=0;i<tasks;++i)
+		{
+			pool.push_back(task);
+		}
+		pool.wait();
+		return allocation_count.load()-before;
+	}
+
+	template<typename Task>
+	void run(char const* name,exlib::thread_pool& pool,std::size_t tasks)
+	{
+		std::atomic<std::size_t> counter{0};
+		pool.reserve(tasks);
+		//the first rounds grow the workers' queues to their high water mark
+		auto const warmup=allocations_per_round<Task>(pool,tasks,counter)+allocations_per_round<Task>(pool,tasks,counter);
+		auto const steady=allocations_per_round<Task>(pool,tasks,counter);
+		std::printf("%s,%s,%zu,%zu,%zu,%zu\n",name,pool.work_stealing()?"stealing":"shared",pool.num_threads(),tasks,warmup,steady);
+	}
+}
+
+int main(int argc,char** argv)
+{
+	std::size_t const threads=argc>1?std::strtoul(argv[1],nullptr,10):exlib::hardware_concurrency_or(4);
+	std::size_t const tasks=argc>2?std::strtoul(argv[2],nullptr,10):100000;
+	std::printf("task,mode,threads,tasks,warmup_allocations,steady_allocations\n");
+	{
+		exlib::thread_pool pool(threads);
+		run<small_task>("small",pool,tasks);
+		run<large_task>("large",pool,tasks);
+	}
+	{
+		exlib::thread_pool pool(threads,exlib::work_stealing_t{});
+		run<small_task>("small",pool,tasks);
+	}
+}
@@ -0,0 +1,279 @@
+/*
+	Measures thread_pool_a (shared queue and work stealing), ThreadPoolA and global_thread_pool:
+	empty task throughput, fan-out/fan-in latency, recursive spawning from inside tasks and async round trips,
+	scaling from 1 to max threads in powers of 2 (global_thread_pool only at its own size).
+	Benchmarks a pool cannot do are left out.
+	Prints CSV, one row per measurement, for tracking regressions.
+	Usage: thread_pool_bench [max threads] [tasks]
+*/
+#include "../ThreadPool/thread_pool.h"
+#include "../ThreadPool/global_thread_pool.h"
+#include "../ThreadPool/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+	using clock_type=std::chrono::steady_clock;
+
+	double seconds_since(clock_type::time_point start)
+	{
+		return std::chrono::duration<double>(clock_type::now()-start).count();
+	}
+
+	double micros_since(clock_type::time_point start)
+	{
+		return std::chrono::duration<double,std::micro>(clock_type::now()-start).count();
+	}
+
+	double median(std::vector<double>& samples)
+	{
+		std::sort(samples.begin(),samples.end());
+		return samples[samples.size()/2];
+	}
+
+	void report(char const* benchmark,char const* pool,std::size_t threads,double value,char const* unit)
+	{
+		std::printf("%s,%s,%zu,%.3f,%s\n",benchmark,pool,threads,value,unit);
+	}
+
+	//for pools without wait(): counts down the tasks left and spins until none are
+	struct countdown {
+		std::atomic<std::size_t> left{0};
+		void wait() const
+		{
+			while(left.load(std::memory_order_acquire)!=0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	};
+
+	struct empty_task {
+		void operator()() noexcept
+		{}
+	};
+
+	struct count_task {
+		countdown* done;
+		void operator()() noexcept
+		{
+			done->left.fetch_sub(1,std::memory_order_release);
+		}
+	};
+
+	//a binary tree of tasks each pushing its two children from inside the pool
+	struct spawn_task {
+		unsigned depth;
+		void operator()(exlib::thread_pool::parent_ref parent) noexcept
+		{
+			if(depth!=0)
+			{
+				parent.push_back(spawn_task{depth-1},spawn_task{depth-1});
+			}
+		}
+	};
+
+	struct global_spawn_task {
+		unsigned depth;
+		countdown* done;
+		void operator()() noexcept
+		{
+			if(depth!=0)
+			{
+				exlib::global_thread_pool::push_back(global_spawn_task{depth-1,done},global_spawn_task{depth-1,done});
+			}
+			done->left.fetch_sub(1,std::memory_order_release);
+		}
+	};
+
+	struct config {
+		std::size_t tasks;
+		//rounds of the latency benchmarks
+		std::size_t rounds;
+		//depth of the spawn tree, which has 2^(depth+1)-1 tasks
+		unsigned spawn_depth;
+	};
+
+	std::size_t fan_width(std::size_t threads)
+	{
+		return 4*threads;
+	}
+
+	void bench_thread_pool(char const* name,exlib::thread_pool& pool,config const& cfg)
+	{
+		auto const threads=pool.num_threads();
+		{
+			for(std::size_t i=0;i<cfg.tasks/10;++i)
+			{
+				pool.push_back(empty_task{});
+			}
+			pool.wait();
+			auto const start=clock_type::now();
+			for(std::size_t i=0;i<cfg.tasks;++i)
+			{
+				pool.push_back(empty_task{});
+			}
+			pool.wait();
+			report("empty_throughput",name,threads,cfg.tasks/seconds_since(start),"tasks_per_s");
+		}
+		{
+			std::vector<double> samples(cfg.rounds);
+			auto const width=fan_width(threads);
+			for(auto& sample:samples)
+			{
+				auto const start=clock_type::now();
+				for(std::size_t i=0;i<width;++i)
+				{
+					pool.push_back(empty_task{});
+				}
+				pool.wait();
+				sample=micros_since(start);
+			}
+			report("fan_out_in_latency",name,threads,median(samples),"us");
+		}
+		{
+			auto const start=clock_type::now();
+			pool.push_back(spawn_task{cfg.spawn_depth});
+			pool.wait();
+			auto const count=(std::size_t(2)<<cfg.spawn_depth)-1;
+			report("recursive_spawn",name,threads,count/seconds_since(start),"tasks_per_s");
+		}
+		{
+			std::vector<double> samples(cfg.rounds);
+			for(auto& sample:samples)
+			{
+				auto const start=clock_type::now();
+				pool.async([]
+					{
+						return 1;
+					}).get();
+				sample=micros_since(start);
+			}
+			report("async_round_trip",name,threads,median(samples),"us");
+		}
+	}
+
+	//ThreadPoolA only runs what was added once start() is called, and has no way to push from tasks or get results
+	void bench_legacy_pool(std::size_t threads,config const& cfg)
+	{
+		char const* const name="ThreadPoolA";
+		exlib::ThreadPool pool(threads);
+		{
+			auto const start=clock_type::now();
+			for(std::size_t i=0;i<cfg.tasks;++i)
+			{
+				pool.add_task([]
+					{});
+			}
+			pool.start();
+			pool.wait();
+			report("empty_throughput",name,threads,cfg.tasks/seconds_since(start),"tasks_per_s");
+		}
+		{
+			std::vector<double> samples(cfg.rounds);
+			auto const width=fan_width(threads);
+			for(auto& sample:samples)
+			{
+				auto const start=clock_type::now();
+				for(std::size_t i=0;i<width;++i)
+				{
+					pool.add_task([]
+						{});
+				}
+				pool.start();
+				pool.wait();
+				sample=micros_since(start);
+			}
+			report("fan_out_in_latency",name,threads,median(samples),"us");
+		}
+	}
+
+	void bench_global_pool(config const& cfg)
+	{
+		namespace global=exlib::global_thread_pool;
+		char const* const name="global_thread_pool";
+		auto const threads=global::num_threads();
+		countdown done;
+		{
+			done.left.store(cfg.tasks,std::memory_order_relaxed);
+			auto const start=clock_type::now();
+			for(std::size_t i=0;i<cfg.tasks;++i)
+			{
+				global::push_back(count_task{&done});
+			}
+			done.wait();
+			report("empty_throughput",name,threads,cfg.tasks/seconds_since(start),"tasks_per_s");
+		}
+		{
+			std::vector<double> samples(cfg.rounds);
+			auto const width=fan_width(threads);
+			for(auto& sample:samples)
+			{
+				done.left.store(width,std::memory_order_relaxed);
+				auto const start=clock_type::now();
+				for(std::size_t i=0;i<width;++i)
+				{
+					global::push_back(count_task{&done});
+				}
+				done.wait();
+				sample=micros_since(start);
+			}
+			report("fan_out_in_latency",name,threads,median(samples),"us");
+		}
+		{
+			auto const count=(std::size_t(2)<<cfg.spawn_depth)-1;
+			done.left.store(count,std::memory_order_relaxed);
+			auto const start=clock_type::now();
+			global::push_back(global_spawn_task{cfg.spawn_depth,&done});
+			done.wait();
+			report("recursive_spawn",name,threads,count/seconds_since(start),"tasks_per_s");
+		}
+		{
+			std::vector<double> samples(cfg.rounds);
+			for(auto& sample:samples)
+			{
+				auto const start=clock_type::now();
+				global::async([]
+					{
+						return 1;
+					}).get();
+				sample=micros_since(start);
+			}
+			report("async_round_trip",name,threads,median(samples),"us");
+		}
+	}
+}
+
+int main(int argc,char** argv)
+{
+	std::size_t const max_threads=argc>1?std::strtoul(argv[1],nullptr,10):exlib::hardware_concurrency_or(4);
+	std::size_t const tasks=argc>2?std::strtoul(argv[2],nullptr,10):1000000;
+	config cfg{tasks,std::max<std::size_t>(tasks/1000,10),0};
+	while((std::size_t(4)<<cfg.spawn_depth)-1<=tasks)
+	{
+		++cfg.spawn_depth;
+	}
+	std::printf("benchmark,pool,threads,value,unit\n");
+	for(std::size_t threads=1;;threads=std::min(threads*2,max_threads))
+	{
+		{
+			exlib::thread_pool pool(threads);
+			bench_thread_pool("thread_pool_a",pool,cfg);
+		}
+		{
+			exlib::thread_pool pool(threads,exlib::work_stealing_t{});
+			bench_thread_pool("thread_pool_a_stealing",pool,cfg);
+		}
+		bench_legacy_pool(threads,cfg);
+		if(threads>=max_threads)
+		{
+			break;
+		}
+	}
+	bench_global_pool(cfg);
+}
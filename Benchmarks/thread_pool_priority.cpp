@@ -0,0 +1,113 @@
+/*
+	Measures how long high priority tasks wait to start while the pool is saturated with low priority work,
+	when pushed with push_back (no priority), push_back_priority and push_back_deadline.
+	Prints CSV.
+	Usage: thread_pool_priority [threads] [samples]
+*/
+#include "../ThreadPool/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	using clock_type=std::chrono::steady_clock;
+
+	struct bulk_task {
+		std::chrono::microseconds work;
+		void operator()() noexcept
+		{
+			auto const end=clock_type::now()+work;
+			while(clock_type::now()<end)
+			{}
+		}
+	};
+
+	struct probe_task {
+		clock_type::time_point submitted;
+		double* latency_us;
+		std::atomic<std::size_t>* finished;
+		void operator()() noexcept
+		{
+			*latency_us=std::chrono::duration<double,std::micro>(clock_type::now()-submitted).count();
+			finished->fetch_add(1,std::memory_order_release);
+		}
+	};
+
+	enum class mode {
+		fifo,priority,deadline
+	};
+
+	char const* name(mode m)
+	{
+		switch(m)
+		{
+			case mode::fifo:
+				return "push_back";
+			case mode::priority:
+				return "push_back_priority";
+			default:
+				return "push_back_deadline";
+		}
+	}
+
+	double percentile(std::vector<double>& sorted,double p)
+	{
+		auto const index=static_cast<std::size_t>(p*(sorted.size()-1));
+		return sorted[index];
+	}
+
+	void run(mode m,std::size_t threads,std::size_t samples)
+	{
+		exlib::thread_pool pool(threads);
+		pool.priority_lanes(2);
+		std::size_t const backlog=threads*64;
+		bulk_task const bulk{std::chrono::microseconds(20)};
+		std::vector<double> latencies(samples);
+		std::atomic<std::size_t> finished{0};
+		for(std::size_t i=0;i<samples;++i)
+		{
+			while(pool.num_jobs()<backlog)
+			{
+				pool.push_back(bulk);
+			}
+			auto const now=clock_type::now();
+			probe_task const probe{now,&latencies[i],&finished};
+			switch(m)
+			{
+				case mode::fifo:
+					pool.push_back(probe);
+					break;
+				case mode::priority:
+					pool.push_back_priority(0,probe);
+					break;
+				case mode::deadline:
+					pool.push_back_deadline(0,now+std::chrono::milliseconds(1),probe);
+					break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		while(finished.load(std::memory_order_acquire)!=samples)
+		{
+			std::this_thread::yield();
+		}
+		pool.clear();
+		pool.wait();
+		std::sort(latencies.begin(),latencies.end());
+		std::printf("%s,%zu,%zu,%.1f,%.1f,%.1f\n",name(m),threads,samples,percentile(latencies,0.5),percentile(latencies,0.99),latencies.back());
+	}
+}
+
+int main(int argc,char** argv)
+{
+	std::size_t const threads=argc>1?std::strtoul(argv[1],nullptr,10):exlib::hardware_concurrency_or(4);
+	std::size_t const samples=argc>2?std::strtoul(argv[2],nullptr,10):1000;
+	std::printf("submit,threads,samples,p50_us,p99_us,max_us\n");
+	run(mode::fifo,threads,samples);
+	run(mode::priority,threads,samples);
+	run(mode::deadline,threads,samples);
+}
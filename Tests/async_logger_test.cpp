@@ -0,0 +1,129 @@
+/*
+	Checks AsyncLogger writing to a string: messages from several threads all arrive, each thread's in order, after flush() and after
+	the logger is destroyed; overflow::drop counts the messages it drops; and a message longer than the ring is written in pieces.
+*/
+#include "../ThreadPool/ThreadPool.h"
+#include "test_check.h"
+#include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	std::size_t const threads=4;
+	std::size_t const per_thread=5000;
+
+	//counts each thread's "<thread> <seq>" lines, failing if a thread's sequence numbers skip or go back
+	bool check_lines(std::string const& out,std::vector<std::size_t>& counts)
+	{
+		counts.assign(threads,0);
+		std::istringstream lines(out);
+		std::size_t thread,seq;
+		while(lines>>thread>>seq)
+		{
+			if(thread>=threads||seq!=counts[thread])
+			{
+				return false;
+			}
+			++counts[thread];
+		}
+		return lines.eof();
+	}
+
+	void log_from_threads(exlib::AsyncStringLogger& logger,std::size_t first)
+	{
+		std::vector<std::thread> loggers;
+		for(std::size_t t=0;t<threads;++t)
+		{
+			loggers.emplace_back([&logger,t,first]
+				{
+					for(std::size_t i=first;i<first+per_thread;++i)
+					{
+						logger.log(t,' ',i,'\n');
+					}
+				});
+		}
+		for(auto& thread:loggers)
+		{
+			thread.join();
+		}
+	}
+
+	void check_order()
+	{
+		std::string out;
+		std::vector<std::size_t> counts;
+		{
+			//a small ring, so the logging threads often wait for the background thread
+			exlib::AsyncStringLogger logger(out,256);
+			log_from_threads(logger,0);
+			logger.flush();
+			EXLIB_CHECK(check_lines(out,counts));
+			for(auto const count:counts)
+			{
+				EXLIB_CHECK(count==per_thread);
+			}
+			//new threads, while the rings of the last ones may not have been removed yet
+			log_from_threads(logger,per_thread);
+		}
+		EXLIB_CHECK(check_lines(out,counts));
+		for(auto const count:counts)
+		{
+			EXLIB_CHECK(count==2*per_thread);
+		}
+	}
+
+	void check_drop()
+	{
+		std::string out;
+		std::size_t const count=1000;
+		using overflow=exlib::AsyncStringLogger::overflow;
+		exlib::AsyncStringLogger logger(out,64,overflow::drop,std::chrono::hours(1));
+		//never fits, so it is always dropped
+		logger.log(std::string(100,'x'));
+		EXLIB_CHECK(logger.dropped()==1);
+		//only a flush drains the ring, so most of these find it full
+		for(std::size_t i=0;i<count;++i)
+		{
+			logger.log("message ",i%10,'\n');
+		}
+		logger.flush();
+		std::size_t lines=0;
+		for(auto const c:out)
+		{
+			lines+=c=='\n';
+		}
+		EXLIB_CHECK(out.find('x')==std::string::npos);
+		EXLIB_CHECK(logger.dropped()>1);
+		EXLIB_CHECK(lines+logger.dropped()-1==count);
+	}
+
+	void check_split()
+	{
+		std::string message;
+		for(std::size_t i=0;i<1000;++i)
+		{
+			message+=static_cast<char>('a'+i%26);
+		}
+		std::string out;
+		{
+			exlib::AsyncStringLogger logger(out,64);
+			logger.log(message);
+			logger.flush();
+			EXLIB_CHECK(out==message);
+			logger.log(message);
+			EXLIB_CHECK(logger.dropped()==0);
+		}
+		EXLIB_CHECK(out==message+message);
+	}
+}
+
+int main()
+{
+	check_order();
+	check_drop();
+	check_split();
+	return exlib_test::result();
+}
@@ -0,0 +1,138 @@
+/*
+	Checks elastic scaling: a blocking_region starts a compensating worker, up to max_threads in all, which retires with the guard,
+	extra workers started on a backlog exit after idle_timeout, and join() waits for the detached extra workers.
+*/
+#include "../ThreadPool/thread_pool.h"
+#include "test_check.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+	template<typename Pred>
+	bool wait_until(Pred pred)
+	{
+		auto const limit=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		while(!pred())
+		{
+			if(std::chrono::steady_clock::now()>limit)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	void check_blocking_region()
+	{
+		exlib::thread_pool pool(1);
+		//a check interval of 0 leaves blocking_region as the only way to start extra workers
+		pool.elastic(1,3,std::chrono::seconds(10),std::chrono::milliseconds(0));
+		EXLIB_CHECK(pool.max_threads()==3);
+		std::atomic<bool> release{false};
+		std::atomic<int> entered{0};
+		auto const blocker=[&](exlib::thread_pool::parent_ref parent) noexcept
+		{
+			auto guard=parent.blocking_region();
+			(void)guard;
+			++entered;
+			while(!release)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		};
+		//each blocker is taken by the worker the last one started, so no worker is free when it blocks
+		std::size_t const expected[]={1,2,2};
+		for(int i=0;i<3;++i)
+		{
+			pool.push_back(blocker);
+			EXLIB_CHECK(wait_until([&]
+				{
+					return entered==i+1;
+				}));
+			EXLIB_CHECK(pool.elastic_threads()==expected[i]);
+		}
+		EXLIB_CHECK(pool.stats().extra_threads==2);
+		release=true;
+		pool.wait();
+		//retired by their guards, long before the idle timeout
+		EXLIB_CHECK(wait_until([&]
+			{
+				return pool.elastic_threads()==0;
+			}));
+	}
+
+	void check_idle_timeout()
+	{
+		exlib::thread_pool pool(1);
+		pool.elastic(1,3,std::chrono::milliseconds(500),std::chrono::milliseconds(5));
+		std::atomic<int> ran{0};
+		for(int i=0;i<40;++i)
+		{
+			pool.push_back([&ran]() noexcept
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+					++ran;
+				});
+		}
+		EXLIB_CHECK(wait_until([&]
+			{
+				return pool.elastic_threads()!=0;
+			}));
+		pool.wait();
+		EXLIB_CHECK(ran==40);
+		EXLIB_CHECK(pool.elastic_threads()!=0);
+		auto const idle_from=std::chrono::steady_clock::now();
+		EXLIB_CHECK(wait_until([&]
+			{
+				return pool.elastic_threads()==0;
+			}));
+		EXLIB_CHECK(std::chrono::steady_clock::now()-idle_from>=std::chrono::milliseconds(200));
+	}
+
+	void check_join()
+	{
+		for(int round=0;round<10;++round)
+		{
+			std::atomic<bool> finished{false};
+			{
+				exlib::thread_pool pool(1);
+				pool.elastic(1,2,std::chrono::seconds(10),std::chrono::milliseconds(0));
+				std::atomic<bool> started{false};
+				pool.push_back([&](exlib::thread_pool::parent_ref parent) noexcept
+					{
+						auto guard=parent.blocking_region();
+						(void)guard;
+						while(!started)
+						{
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));
+						}
+					});
+				pool.push_back([&]() noexcept
+					{
+						started=true;
+						std::this_thread::sleep_for(std::chrono::milliseconds(5));
+						finished=true;
+					});
+				EXLIB_CHECK(wait_until([&]
+					{
+						return started.load();
+					}));
+				EXLIB_CHECK(pool.elastic_threads()==1);
+				//the extra worker would otherwise idle for 10s; it must have exited, as the pool is destroyed next
+				pool.join();
+				EXLIB_CHECK(finished);
+				EXLIB_CHECK(pool.elastic_threads()==0);
+			}
+		}
+	}
+}
+
+int main()
+{
+	check_blocking_region();
+	check_idle_timeout();
+	check_join();
+	return exlib_test::result();
+}
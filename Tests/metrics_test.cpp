@@ -0,0 +1,116 @@
+/*
+	Checks the pool's metrics: after a known workload the workers' task counts and the latency histogram each add up to it,
+	changing the number of threads resets them, and a metrics_callback keeps reading stats() while the number of threads changes.
+*/
+#include "../ThreadPool/thread_pool.h"
+#include "test_check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace {
+	std::uint64_t latency_total(exlib::thread_pool_stats const& stats)
+	{
+		std::uint64_t total=0;
+		for(auto const count:stats.latency)
+		{
+			total+=count;
+		}
+		return total;
+	}
+
+	void check_counts()
+	{
+		exlib::thread_pool pool(4);
+		EXLIB_CHECK(pool.stats().workers.empty());
+		pool.metrics(true);
+		std::size_t const count=10000;
+		std::atomic<std::size_t> ran{0};
+		for(std::size_t i=0;i<count;++i)
+		{
+			pool.push_back([&ran]() noexcept
+				{
+					++ran;
+				});
+		}
+		pool.wait();
+		EXLIB_CHECK(ran==count);
+		auto stats=pool.stats();
+		EXLIB_CHECK(stats.workers.size()==4);
+		EXLIB_CHECK(stats.queued==0);
+		EXLIB_CHECK(stats.tasks_executed()==count);
+		EXLIB_CHECK(latency_total(stats)==count);
+
+		pool.num_threads(2);
+		stats=pool.stats();
+		EXLIB_CHECK(stats.workers.size()==2);
+		EXLIB_CHECK(stats.tasks_executed()==0);
+		EXLIB_CHECK(latency_total(stats)==0);
+		for(std::size_t i=0;i<count;++i)
+		{
+			pool.push_back([&ran]() noexcept
+				{
+					++ran;
+				});
+		}
+		pool.wait();
+		stats=pool.stats();
+		EXLIB_CHECK(stats.tasks_executed()==count);
+		EXLIB_CHECK(latency_total(stats)==count);
+
+		pool.metrics(false);
+		EXLIB_CHECK(pool.stats().workers.empty());
+	}
+
+	//the callback's thread reads stats() while the workers are replaced, which must neither race nor read past the counters
+	void check_callback()
+	{
+		exlib::thread_pool pool(2);
+		std::atomic<int> calls{0};
+		std::atomic<bool> bad_size{false};
+		pool.metrics_callback(std::chrono::milliseconds(1),[&](exlib::thread_pool_stats const& stats)
+			{
+				if(stats.workers.empty()||stats.workers.size()>4)
+				{
+					bad_size=true;
+				}
+				++calls;
+			});
+		std::atomic<std::size_t> ran{0};
+		std::size_t pushed=0;
+		auto const limit=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		for(std::size_t round=0;round<200||calls<20;++round)
+		{
+			if(std::chrono::steady_clock::now()>limit)
+			{
+				break;
+			}
+			pool.num_threads(1+round%4);
+			for(int i=0;i<50;++i)
+			{
+				pool.push_back([&ran]() noexcept
+					{
+						++ran;
+					});
+			}
+			pushed+=50;
+		}
+		pool.wait();
+		EXLIB_CHECK(calls>=20);
+		EXLIB_CHECK(!bad_size);
+		EXLIB_CHECK(ran==pushed);
+		pool.metrics_callback(std::chrono::milliseconds(1),nullptr);
+		int const stopped_at=calls;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		EXLIB_CHECK(calls==stopped_at);
+		EXLIB_CHECK(pool.metrics());
+	}
+}
+
+int main()
+{
+	check_counts();
+	check_callback();
+	return exlib_test::result();
+}
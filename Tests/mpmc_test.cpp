@@ -0,0 +1,292 @@
+/*
+	Stresses mpmc_queue with several producers and consumers through a small ring, once each with the try_ operations,
+	the blocking ones and the _n ones: every value must come out exactly once, and each consumer must see each producer's values in order.
+	Then checks the pool's lock-free job queue (EXLIB_THREAD_POOL_MPMC) with tasks pushed from several threads outside the pool.
+*/
+#include "../Utils/exmpmc.h"
+#include "../ThreadPool/thread_pool.h"
+#include "test_check.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+	enum class mode {
+		try_ops,
+		blocking,
+		batched
+	};
+
+	std::size_t const producers=4;
+	std::size_t const consumers=4;
+	std::uint64_t const per_producer=50000;
+	std::size_t const batch=7;
+
+	std::uint64_t make_value(std::size_t producer,std::uint64_t seq)
+	{
+		return (std::uint64_t(producer)<<32)|seq;
+	}
+
+	void produce(exlib::mpmc_queue<std::uint64_t>& queue,std::size_t producer,mode how)
+	{
+		std::uint64_t seq=0;
+		while(seq<per_producer)
+		{
+			switch(how)
+			{
+				case mode::try_ops:
+					if(queue.try_push(make_value(producer,seq)))
+					{
+						++seq;
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
+					break;
+				case mode::blocking:
+					queue.push(make_value(producer,seq));
+					++seq;
+					break;
+				default:
+				{
+					std::uint64_t values[batch];
+					std::size_t n=0;
+					for(;n<batch&&seq+n<per_producer;++n)
+					{
+						values[n]=make_value(producer,seq+n);
+					}
+					//alternate between the try_ and the waiting form
+					if(seq/batch%2==0)
+					{
+						auto const pushed=queue.try_push_n(values,n);
+						if(pushed==0)
+						{
+							std::this_thread::yield();
+						}
+						seq+=pushed;
+					}
+					else
+					{
+						queue.push_n(values,n);
+						seq+=n;
+					}
+				}
+			}
+		}
+	}
+
+	//each consumer takes an equal share, checking that values from each producer arrive in order
+	void consume(exlib::mpmc_queue<std::uint64_t>& queue,mode how,std::vector<std::atomic<std::uint64_t>>& seen,std::atomic<bool>& out_of_order)
+	{
+		std::uint64_t const share=producers*per_producer/consumers;
+		std::vector<std::uint64_t> next(producers,0);
+		auto const take=[&](std::uint64_t value)
+		{
+			auto const producer=static_cast<std::size_t>(value>>32);
+			auto const seq=value&0xFFFFFFFF;
+			if(producer>=producers||seq<next[producer])
+			{
+				out_of_order=true;
+				return;
+			}
+			next[producer]=seq+1;
+			++seen[producer];
+		};
+		std::uint64_t taken=0;
+		while(taken<share)
+		{
+			switch(how)
+			{
+				case mode::try_ops:
+				{
+					std::uint64_t value;
+					if(queue.try_pop(value))
+					{
+						take(value);
+						++taken;
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
+					break;
+				}
+				case mode::blocking:
+				{
+					std::uint64_t value;
+					queue.pop(value);
+					take(value);
+					++taken;
+					break;
+				}
+				default:
+				{
+					std::uint64_t values[batch];
+					auto const want=static_cast<std::size_t>(share-taken<batch?share-taken:batch);
+					std::size_t const popped=taken/batch%2==0?queue.try_pop_n(values,want):queue.pop_n(values,want);
+					if(popped==0)
+					{
+						std::this_thread::yield();
+					}
+					for(std::size_t i=0;i<popped;++i)
+					{
+						take(values[i]);
+					}
+					taken+=popped;
+				}
+			}
+		}
+	}
+
+	void check_stress(mode how)
+	{
+		exlib::mpmc_queue<std::uint64_t> queue(64);
+		std::vector<std::atomic<std::uint64_t>> seen(producers);
+		for(auto& count:seen)
+		{
+			count=0;
+		}
+		std::atomic<bool> out_of_order{false};
+		std::vector<std::thread> threads;
+		for(std::size_t i=0;i<consumers;++i)
+		{
+			threads.emplace_back([&]
+				{
+					consume(queue,how,seen,out_of_order);
+				});
+		}
+		for(std::size_t i=0;i<producers;++i)
+		{
+			threads.emplace_back([&queue,i,how]
+				{
+					produce(queue,i,how);
+				});
+		}
+		for(auto& thread:threads)
+		{
+			thread.join();
+		}
+		EXLIB_CHECK(!out_of_order);
+		for(auto const& count:seen)
+		{
+			EXLIB_CHECK(count==per_producer);
+		}
+		EXLIB_CHECK(queue.empty());
+	}
+
+	void check_single_thread()
+	{
+		bool threw=false;
+		try
+		{
+			exlib::mpmc_queue<int> queue(0);
+		}
+		catch(std::invalid_argument const&)
+		{
+			threw=true;
+		}
+		EXLIB_CHECK(threw);
+
+		exlib::mpmc_queue<int> queue(5);
+		EXLIB_CHECK(queue.capacity()==8);
+		int value=0;
+		EXLIB_CHECK(!queue.try_pop(value));
+		for(int i=0;i<8;++i)
+		{
+			EXLIB_CHECK(queue.try_push(i));
+		}
+		EXLIB_CHECK(!queue.try_push(8));
+		EXLIB_CHECK(queue.size_approx()==8);
+		int out[8];
+		EXLIB_CHECK(queue.try_pop_n(out,3)==3);
+		EXLIB_CHECK(out[0]==0&&out[1]==1&&out[2]==2);
+		int const more[]={8,9,10,11};
+		EXLIB_CHECK(queue.try_push_n(more,4)==3);
+		for(int i=3;i<11;++i)
+		{
+			EXLIB_CHECK(queue.try_pop(value));
+			EXLIB_CHECK(value==i);
+		}
+		EXLIB_CHECK(queue.empty());
+
+		//elements left in the queue are destroyed with it
+		auto const tracked=std::make_shared<int>(1);
+		{
+			exlib::mpmc_queue<std::shared_ptr<int>> owners(4);
+			owners.push(tracked);
+			owners.emplace(tracked);
+			std::shared_ptr<int> popped;
+			owners.pop(popped);
+			EXLIB_CHECK(tracked.use_count()==3);
+		}
+		EXLIB_CHECK(tracked.use_count()==1);
+	}
+
+	void check_pool_queue()
+	{
+		exlib::thread_pool pool(4);
+		pool.lock_free_queue(64);
+		EXLIB_CHECK(pool.lock_free_queue()==64);
+		std::size_t const pushers=4;
+		std::size_t const per_pusher=20000;
+		std::vector<std::atomic<std::size_t>> ran(pushers);
+		for(auto& count:ran)
+		{
+			count=0;
+		}
+		std::vector<std::thread> threads;
+		for(std::size_t i=0;i<pushers;++i)
+		{
+			threads.emplace_back([&pool,&ran,i]
+				{
+					for(std::size_t j=0;j<per_pusher;++j)
+					{
+						pool.push_back([&ran,i]() noexcept
+							{
+								++ran[i];
+							});
+					}
+				});
+		}
+		for(auto& thread:threads)
+		{
+			thread.join();
+		}
+		pool.wait();
+		for(auto const& count:ran)
+		{
+			EXLIB_CHECK(count==per_pusher);
+		}
+
+		//removing the queue moves the tasks still in it to the shared queue
+		exlib::thread_pool stopped(2,exlib::delay_start);
+		stopped.lock_free_queue(16);
+		std::atomic<int> later{0};
+		for(int i=0;i<40;++i)
+		{
+			stopped.push_back([&later]() noexcept
+				{
+					++later;
+				});
+		}
+		stopped.lock_free_queue(0);
+		EXLIB_CHECK(stopped.lock_free_queue()==0);
+		stopped.start();
+		stopped.wait();
+		EXLIB_CHECK(later==40);
+	}
+}
+
+int main()
+{
+	check_single_thread();
+	check_stress(mode::try_ops);
+	check_stress(mode::blocking);
+	check_stress(mode::batched);
+	check_pool_queue();
+	return exlib_test::result();
+}
@@ -0,0 +1,142 @@
+/*
+	Checks waking a mostly idle pool: a large batch appended to parked workers, many small batches each appended after the workers
+	parked again, and a large batch appended from inside a task in work stealing mode.
+	Every task must run exactly once and wait() must return; a lost wakeup shows as a check failure or as the test timing out.
+*/
+#include "../ThreadPool/thread_pool.h"
+#include "test_check.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct mark_task {
+		std::atomic<unsigned>* slot;
+		void operator()() const noexcept
+		{
+			++*slot;
+		}
+	};
+
+	template<typename Pred>
+	bool wait_until(Pred pred)
+	{
+		auto const limit=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		while(!pred())
+		{
+			if(std::chrono::steady_clock::now()>limit)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	std::vector<mark_task> make_tasks(std::unique_ptr<std::atomic<unsigned>[]>& slots,std::size_t count)
+	{
+		slots.reset(new std::atomic<unsigned>[count]);
+		std::vector<mark_task> tasks(count);
+		for(std::size_t i=0;i<count;++i)
+		{
+			slots[i]=0;
+			tasks[i].slot=&slots[i];
+		}
+		return tasks;
+	}
+
+	bool each_ran_once(std::unique_ptr<std::atomic<unsigned>[]> const& slots,std::size_t count)
+	{
+		for(std::size_t i=0;i<count;++i)
+		{
+			if(slots[i]!=1)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void check_large_append(exlib::thread_pool& pool)
+	{
+		std::size_t const count=200000;
+		std::unique_ptr<std::atomic<unsigned>[]> slots;
+		auto const tasks=make_tasks(slots,count);
+		//let every worker park first
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		EXLIB_CHECK(pool.append(tasks.begin(),tasks.end())==count);
+		pool.wait();
+		EXLIB_CHECK(each_ran_once(slots,count));
+	}
+
+	void check_small_appends(exlib::thread_pool& pool)
+	{
+		std::size_t const rounds=2000;
+		std::unique_ptr<std::atomic<unsigned>[]> slots;
+		auto const tasks=make_tasks(slots,rounds*3);
+		std::size_t added=0;
+		for(std::size_t round=0;round<rounds;++round)
+		{
+			if(round%100==0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+			auto const before=added;
+			auto const first=tasks.begin()+before;
+			added+=pool.append(first,first+1+round%3);
+			bool const ran=wait_until([&]
+				{
+					for(std::size_t i=before;i<added;++i)
+					{
+						if(slots[i]==0)
+						{
+							return false;
+						}
+					}
+					return true;
+				});
+			EXLIB_CHECK(ran);
+			if(!ran)
+			{
+				return;
+			}
+		}
+		pool.wait();
+		EXLIB_CHECK(each_ran_once(slots,added));
+	}
+
+	//the batch goes to the appending worker's own deque, and the parked workers must be woken to steal it
+	void check_nested_append()
+	{
+		exlib::thread_pool pool(8,exlib::work_stealing);
+		std::size_t const count=100000;
+		std::unique_ptr<std::atomic<unsigned>[]> slots;
+		auto const tasks=make_tasks(slots,count);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pool.push_back([&](exlib::thread_pool::parent_ref parent) noexcept
+			{
+				parent.append(tasks.begin(),tasks.end());
+			});
+		pool.wait();
+		EXLIB_CHECK(each_ran_once(slots,count));
+	}
+}
+
+int main()
+{
+	{
+		exlib::thread_pool pool(8);
+		check_large_append(pool);
+		check_small_appends(pool);
+	}
+	{
+		exlib::thread_pool pool(8,exlib::work_stealing);
+		check_large_append(pool);
+		check_small_appends(pool);
+	}
+	check_nested_append();
+	return exlib_test::result();
+}
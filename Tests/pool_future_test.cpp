@@ -0,0 +1,135 @@
+/*
+	Checks pool_future continuations and combinators on thread pools with and without work stealing:
+	then chains, exceptions passing through then, when_all of a pack and of a range, when_any, and broken promises.
+*/
+#include "../ThreadPool/pool_future.h"
+#include "test_check.h"
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+	void check_then(exlib::thread_pool& pool)
+	{
+		auto chained=exlib::pool_async(pool,[]
+			{
+				return 20;
+			}).then([](int x)
+			{
+				return x+1;
+			}).then([](int x)
+			{
+				return std::to_string(x*2);
+			});
+		EXLIB_CHECK(chained.get()=="42");
+		auto from_void=exlib::pool_async(pool,[]
+			{}).then([]
+			{
+				return 3;
+			});
+		EXLIB_CHECK(from_void.get()==3);
+		auto failed=exlib::pool_async(pool,[]() -> int
+			{
+				throw std::runtime_error("failed");
+			}).then([](int x)
+			{
+				return x+1;
+			});
+		bool thrown=false;
+		try
+		{
+			failed.get();
+		}
+		catch(std::runtime_error const&)
+		{
+			thrown=true;
+		}
+		EXLIB_CHECK(thrown);
+	}
+
+	void check_when_all(exlib::thread_pool& pool)
+	{
+		auto pack=exlib::when_all(exlib::pool_async(pool,[]
+			{
+				return 1;
+			}),exlib::pool_async(pool,[]
+			{
+				return std::string("ab");
+			}),exlib::pool_async(pool,[]
+			{})).then([](std::tuple<exlib::pool_future<int>,exlib::pool_future<std::string>,exlib::pool_future<void>> ready)
+			{
+				std::get<2>(ready).get();
+				return std::get<0>(ready).get()+static_cast<int>(std::get<1>(ready).get().size());
+			});
+		EXLIB_CHECK(pack.get()==3);
+		std::vector<exlib::pool_future<int>> futures;
+		for(int i=0;i<10;++i)
+		{
+			futures.push_back(exlib::pool_async(pool,[i]
+				{
+					return i;
+				}));
+		}
+		auto sum=exlib::when_all(futures.begin(),futures.end()).then([](std::vector<exlib::pool_future<int>> ready)
+			{
+				int total=0;
+				for(auto& f:ready)
+				{
+					total+=f.get();
+				}
+				return total;
+			});
+		EXLIB_CHECK(sum.get()==45);
+		std::vector<exlib::pool_future<int>> none;
+		EXLIB_CHECK(exlib::when_all(none.begin(),none.end()).get().empty());
+	}
+
+	void check_when_any(exlib::thread_pool& pool)
+	{
+		exlib::pool_promise<int> never(pool);
+		exlib::pool_promise<int> first(pool);
+		auto any=exlib::when_any(never.get_future(),first.get_future());
+		first.set_value(7);
+		auto ready=any.get();
+		EXLIB_CHECK(ready.index==1);
+		EXLIB_CHECK(std::get<1>(ready.futures).get()==7);
+	}
+
+	void check_broken_promise()
+	{
+		exlib::pool_future<int> broken;
+		{
+			exlib::pool_promise<int> promise;
+			broken=promise.get_future();
+		}
+		bool thrown=false;
+		try
+		{
+			broken.get();
+		}
+		catch(std::future_error const&)
+		{
+			thrown=true;
+		}
+		EXLIB_CHECK(thrown);
+	}
+}
+
+int main()
+{
+	for(bool const stealing:{false,true})
+	{
+		exlib::thread_pool pool(3);
+		pool.work_stealing(stealing);
+		for(int round=0;round<50;++round)
+		{
+			check_then(pool);
+			check_when_all(pool);
+			check_when_any(pool);
+		}
+	}
+	check_broken_promise();
+	return exlib_test::result();
+}
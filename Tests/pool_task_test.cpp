@@ -0,0 +1,93 @@
+/*
+	Checks pool_task coroutines: sync_wait of a deep co_await chain, which must not grow the stack,
+	tasks that move onto a thread pool with co_await pool.schedule(), and exceptions passing back through co_await.
+	Needs C++20.
+*/
+#include "../ThreadPool/pool_task.h"
+#include "test_check.h"
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__SANITIZE_ADDRESS__)||defined(__SANITIZE_THREAD__)
+#define EXLIB_TEST_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)||__has_feature(thread_sanitizer)
+#define EXLIB_TEST_SANITIZED 1
+#endif
+#endif
+
+namespace {
+#ifdef EXLIB_TEST_SANITIZED
+	//sanitizers keep symmetric transfer from being a tail call, so every level of the chain takes stack
+	constexpr int chain_depth=1000;
+#else
+	constexpr int chain_depth=100000;
+#endif
+
+	exlib::task<long> depth(int n)
+	{
+		if(n==0)
+		{
+			co_return 0;
+		}
+		co_return 1+co_await depth(n-1);
+	}
+
+	exlib::task<int> on_pool(exlib::thread_pool& pool,std::thread::id caller,int x)
+	{
+		co_await pool.schedule();
+		EXLIB_CHECK(std::this_thread::get_id()!=caller);
+		co_return 2*x;
+	}
+
+	exlib::task<void> fail_on_pool(exlib::thread_pool& pool)
+	{
+		co_await pool.schedule();
+		throw std::runtime_error("failed");
+	}
+
+	exlib::task<std::string> chain(exlib::thread_pool& pool,std::thread::id caller)
+	{
+		int sum=0;
+		for(int i=0;i<100;++i)
+		{
+			sum+=co_await on_pool(pool,caller,i);
+		}
+		try
+		{
+			co_await fail_on_pool(pool);
+		}
+		catch(std::runtime_error const&)
+		{
+			++sum;
+		}
+		co_return std::to_string(sum);
+	}
+}
+
+int main()
+{
+	EXLIB_CHECK(exlib::sync_wait(depth(chain_depth))==chain_depth);
+	auto const caller=std::this_thread::get_id();
+	for(bool const stealing:{false,true})
+	{
+		exlib::thread_pool pool(3);
+		pool.work_stealing(stealing);
+		for(int round=0;round<50;++round)
+		{
+			EXLIB_CHECK(exlib::sync_wait(chain(pool,caller))==std::to_string(2*4950+1));
+		}
+		bool thrown=false;
+		try
+		{
+			exlib::sync_wait(fail_on_pool(pool));
+		}
+		catch(std::runtime_error const&)
+		{
+			thrown=true;
+		}
+		EXLIB_CHECK(thrown);
+	}
+	return exlib_test::result();
+}
@@ -0,0 +1,149 @@
+/*
+	Checks task_graph on thread pools with and without work stealing: a diamond run twice, layers of tasks that each
+	depend on every task of the layer before, an exception rethrown by run_and_wait on every run, and a cycle being rejected.
+*/
+#include "../ThreadPool/task_graph.h"
+#include "test_check.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	//a before b and c, which are both before d
+	void check_diamond(exlib::thread_pool& pool)
+	{
+		exlib::task_graph graph;
+		std::atomic<int> clock{0};
+		int stamps[4]={};
+		std::size_t ids[4];
+		for(int i=0;i<4;++i)
+		{
+			ids[i]=graph.emplace([&clock,&stamps,i]
+				{
+					stamps[i]=++clock;
+				});
+		}
+		graph.precede(ids[0],ids[1]);
+		graph.precede(ids[0],ids[2]);
+		graph.precede(ids[1],ids[3]);
+		graph.precede(ids[2],ids[3]);
+		for(int run=0;run<2;++run)
+		{
+			clock=0;
+			graph.run_and_wait(pool);
+			EXLIB_CHECK(clock==4);
+			EXLIB_CHECK(stamps[0]==1);
+			EXLIB_CHECK(stamps[1]<stamps[3]&&stamps[2]<stamps[3]);
+			EXLIB_CHECK(stamps[3]==4);
+		}
+	}
+
+	void check_layers(exlib::thread_pool& pool)
+	{
+		int const layers=10;
+		int const width=8;
+		exlib::task_graph graph;
+		std::atomic<int> clock{0};
+		std::vector<int> stamps(layers*width);
+		std::vector<std::size_t> ids;
+		for(int i=0;i<layers*width;++i)
+		{
+			auto const slot=&stamps[i];
+			ids.push_back(graph.emplace([&clock,slot]
+				{
+					*slot=clock++;
+				}));
+		}
+		for(int l=1;l<layers;++l)
+		{
+			for(int a=0;a<width;++a)
+			{
+				for(int b=0;b<width;++b)
+				{
+					graph.precede(ids[(l-1)*width+a],ids[l*width+b]);
+				}
+			}
+		}
+		for(int run=0;run<20;++run)
+		{
+			clock=0;
+			graph.run_and_wait(pool);
+			EXLIB_CHECK(clock==layers*width);
+			for(int l=1;l<layers;++l)
+			{
+				for(int a=0;a<width;++a)
+				{
+					for(int b=0;b<width;++b)
+					{
+						EXLIB_CHECK(stamps[(l-1)*width+a]<stamps[l*width+b]);
+					}
+				}
+			}
+		}
+	}
+
+	void check_exception(exlib::thread_pool& pool)
+	{
+		exlib::task_graph graph;
+		std::atomic<int> ran{0};
+		auto const failing=graph.emplace([]
+			{
+				throw std::runtime_error("failed");
+			});
+		auto const after=graph.emplace([&ran]
+			{
+				++ran;
+			});
+		graph.precede(failing,after);
+		for(int run=1;run<=2;++run)
+		{
+			bool thrown=false;
+			try
+			{
+				graph.run_and_wait(pool);
+			}
+			catch(std::runtime_error const&)
+			{
+				thrown=true;
+			}
+			EXLIB_CHECK(thrown);
+			EXLIB_CHECK(ran==run);
+		}
+	}
+
+	void check_cycle(exlib::thread_pool& pool)
+	{
+		exlib::task_graph graph;
+		auto const a=graph.emplace([]
+			{});
+		auto const b=graph.emplace([]
+			{});
+		graph.precede(a,b);
+		graph.precede(b,a);
+		bool thrown=false;
+		try
+		{
+			graph.run(pool);
+		}
+		catch(std::logic_error const&)
+		{
+			thrown=true;
+		}
+		EXLIB_CHECK(thrown);
+		EXLIB_CHECK(graph.done());
+	}
+}
+
+int main()
+{
+	for(bool const stealing:{false,true})
+	{
+		exlib::thread_pool pool(4);
+		pool.work_stealing(stealing);
+		check_diamond(pool);
+		check_layers(pool);
+		check_exception(pool);
+		check_cycle(pool);
+	}
+	return exlib_test::result();
+}
@@ -0,0 +1,148 @@
+/*
+	Checks task_scope on thread pools with and without work stealing: wait covers only the scope's tasks,
+	cancelling drops the tasks still queued while running ones see the token, an exception cancels the scope and its
+	child scopes and is rethrown by wait, and tasks can add to their own scope.
+*/
+#include "../ThreadPool/task_scope.h"
+#include "test_check.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+	void check_wait(exlib::thread_pool& pool)
+	{
+		std::atomic<bool> release{false};
+		std::atomic<int> other{0};
+		pool.push_back([&release,&other]() noexcept
+			{
+				while(!release)
+				{
+					std::this_thread::yield();
+				}
+				++other;
+			});
+		{
+			exlib::task_scope scope(pool);
+			std::atomic<int> ran{0};
+			for(int i=0;i<100;++i)
+			{
+				scope.push_back([&ran]
+					{
+						++ran;
+					});
+			}
+			scope.wait();
+			EXLIB_CHECK(ran==100);
+			EXLIB_CHECK(other==0);
+		}
+		release=true;
+		pool.wait();
+		EXLIB_CHECK(other==1);
+	}
+
+	//blocks every worker with tasks that wait for the cancel, then cancels with the rest still queued
+	void check_cancel(exlib::thread_pool& pool)
+	{
+		exlib::task_scope scope(pool);
+		auto const workers=static_cast<int>(pool.num_threads());
+		std::atomic<int> started{0};
+		std::atomic<int> ran{0};
+		auto const token=scope.token();
+		for(int i=0;i<workers;++i)
+		{
+			scope.push_back([&,token]
+				{
+					++started;
+					while(!token.cancelled())
+					{
+						std::this_thread::yield();
+					}
+					++ran;
+				});
+		}
+		for(int i=0;i<1000;++i)
+		{
+			scope.push_back([&ran]
+				{
+					++ran;
+				});
+		}
+		while(started!=workers)
+		{
+			std::this_thread::yield();
+		}
+		//every worker is held, so nothing else runs until the cancel; with work stealing some tasks may have run first
+		int const before=ran;
+		scope.cancel();
+		scope.wait();
+		EXLIB_CHECK(scope.cancelled());
+		EXLIB_CHECK(ran==before+workers);
+		EXLIB_CHECK(before<1000);
+		EXLIB_CHECK(scope.pending()==0);
+	}
+
+	void check_exception(exlib::thread_pool& pool)
+	{
+		exlib::task_scope outer(pool);
+		exlib::task_scope inner(pool,outer.token());
+		outer.push_back([]
+			{
+				throw std::runtime_error("failed");
+			});
+		bool thrown=false;
+		try
+		{
+			outer.wait();
+		}
+		catch(std::runtime_error const&)
+		{
+			thrown=true;
+		}
+		EXLIB_CHECK(thrown);
+		EXLIB_CHECK(outer.cancelled());
+		EXLIB_CHECK(inner.cancelled());
+		std::atomic<int> ran{0};
+		inner.push_back([&ran]
+			{
+				++ran;
+			});
+		inner.wait();
+		EXLIB_CHECK(ran==0);
+	}
+
+	void check_nested_push(exlib::thread_pool& pool)
+	{
+		for(int round=0;round<100;++round)
+		{
+			std::atomic<int> ran{0};
+			exlib::task_scope scope(pool);
+			scope.push_back([&scope,&ran]
+				{
+					for(int i=0;i<4;++i)
+					{
+						scope.push_back([&ran]
+							{
+								++ran;
+							});
+					}
+				});
+			scope.wait();
+			EXLIB_CHECK(ran==4);
+		}
+	}
+}
+
+int main()
+{
+	for(bool const stealing:{false,true})
+	{
+		exlib::thread_pool pool(3);
+		pool.work_stealing(stealing);
+		check_wait(pool);
+		check_cancel(pool);
+		check_exception(pool);
+		check_nested_push(pool);
+	}
+	return exlib_test::result();
+}
@@ -0,0 +1,28 @@
+/*
+	EXLIB_CHECK for the test programs in this directory: a failed check prints where it is and is counted,
+	and main returns exlib_test::result() so CTest sees the failure.
+*/
+#ifndef EXLIB_TEST_CHECK_H
+#define EXLIB_TEST_CHECK_H
+#include <cstdio>
+
+namespace exlib_test {
+	inline int& failures() noexcept
+	{
+		static int count=0;
+		return count;
+	}
+
+	inline int result() noexcept
+	{
+		if(failures()!=0)
+		{
+			std::fprintf(stderr,"%d checks failed\n",failures());
+			return 1;
+		}
+		return 0;
+	}
+}
+
+#define EXLIB_CHECK(cond) do{if(!(cond)){++::exlib_test::failures();std::fprintf(stderr,"%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond);}}while(0)
+#endif
@@ -0,0 +1,217 @@
+/*
+	Checks timer_wheel against a plain list of due ticks: timers near and far, past the last level into the overflow list,
+	cancelled ones and periodic ones, advanced in irregular steps.
+	Then checks the pool's timers: schedule_after, schedule_every, cancel_timer, that reconfiguring the pool keeps its timers,
+	and that a pool with waiting timers, or whose tasks add timers while it is destroyed, is destroyed promptly.
+*/
+#include "../ThreadPool/thread_pool.h"
+#include "test_check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct wheel_task {
+		std::size_t id=0;
+	};
+
+	void check_wheel()
+	{
+		exlib::timer_wheel<wheel_task> wheel;
+		std::mt19937_64 rng(5);
+		std::size_t const count=50000;
+		std::vector<std::uint64_t> due(count);
+		std::vector<exlib::timer_handle> handles(count);
+		std::vector<int> fired(count,0);
+		std::vector<bool> cancelled(count,false);
+		for(std::size_t i=0;i<count;++i)
+		{
+			switch(i%4)
+			{
+				case 0:
+					due[i]=1+rng()%300;
+					break;
+				case 1:
+					due[i]=1+rng()%100000;
+					break;
+				case 2:
+					due[i]=1+rng()%(std::uint64_t(1)<<26);
+					break;
+				default:
+					due[i]=(std::uint64_t(1)<<32)+rng()%(std::uint64_t(1)<<33);
+			}
+			handles[i]=wheel.insert(due[i],wheel_task{i});
+		}
+		for(std::size_t i=0;i<count;i+=7)
+		{
+			EXLIB_CHECK(wheel.cancel(handles[i]));
+			EXLIB_CHECK(!wheel.cancel(handles[i]));
+			cancelled[i]=true;
+		}
+		std::uint64_t last=0;
+		while(!wheel.empty())
+		{
+			auto step=wheel.ticks_to_next();
+			if(rng()%3==0)
+			{
+				step=1+rng()%1000;
+			}
+			wheel.advance(wheel.now()+step,[&](wheel_task& task)
+				{
+					EXLIB_CHECK(due[task.id]==wheel.now());
+					EXLIB_CHECK(wheel.now()>=last);
+					last=wheel.now();
+					++fired[task.id];
+				});
+		}
+		for(std::size_t i=0;i<count;++i)
+		{
+			EXLIB_CHECK(fired[i]==(cancelled[i]?0:1));
+			EXLIB_CHECK(!wheel.contains(handles[i]));
+		}
+
+		exlib::timer_wheel<wheel_task> periodic;
+		int calls=0;
+		auto const handle=periodic.insert(5,wheel_task{},10);
+		periodic.advance(100,[&calls](wheel_task&)
+			{
+				++calls;
+			});
+		EXLIB_CHECK(calls==10);
+		EXLIB_CHECK(periodic.contains(handle));
+		EXLIB_CHECK(periodic.cancel(handle));
+		EXLIB_CHECK(periodic.empty());
+	}
+
+	template<typename Pred>
+	bool wait_until(Pred pred)
+	{
+		auto const limit=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		while(!pred())
+		{
+			if(std::chrono::steady_clock::now()>limit)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	void check_pool_timers()
+	{
+		exlib::thread_pool pool(2);
+		std::atomic<int> once{0};
+		auto const start=std::chrono::steady_clock::now();
+		std::atomic<std::chrono::steady_clock::duration::rep> fired_after{0};
+		auto const single=pool.schedule_after(std::chrono::milliseconds(20),[&]() noexcept
+			{
+				fired_after=(std::chrono::steady_clock::now()-start).count();
+				++once;
+			});
+		EXLIB_CHECK(static_cast<bool>(single));
+		EXLIB_CHECK(wait_until([&]
+			{
+				return once==1;
+			}));
+		EXLIB_CHECK(std::chrono::steady_clock::duration(fired_after.load())>=std::chrono::milliseconds(20));
+		EXLIB_CHECK(!pool.cancel_timer(single));
+
+		std::atomic<int> repeats{0};
+		auto const every=pool.schedule_every(std::chrono::milliseconds(2),[&repeats]() noexcept
+			{
+				++repeats;
+			});
+		EXLIB_CHECK(wait_until([&]
+			{
+				return repeats>=5;
+			}));
+		EXLIB_CHECK(pool.cancel_timer(every));
+		EXLIB_CHECK(!pool.cancel_timer(every));
+		pool.wait();
+		int const stopped_at=repeats;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		EXLIB_CHECK(repeats==stopped_at);
+
+		std::atomic<int> never{0};
+		auto const cancelled=pool.schedule_after(std::chrono::milliseconds(20),[&never]() noexcept
+			{
+				++never;
+			});
+		EXLIB_CHECK(pool.cancel_timer(cancelled));
+		std::this_thread::sleep_for(std::chrono::milliseconds(40));
+		EXLIB_CHECK(never==0);
+		EXLIB_CHECK(pool.pending_timers()==0);
+	}
+
+	//changing the workers must not drop the timer wheel
+	void check_reconfigure()
+	{
+		exlib::thread_pool pool(2);
+		std::atomic<int> ran{0};
+		pool.schedule_after(std::chrono::milliseconds(50),[&ran]() noexcept
+			{
+				++ran;
+			});
+		pool.metrics(true);
+		pool.work_stealing(true);
+		pool.num_threads(1);
+		pool.num_threads(3);
+		EXLIB_CHECK(pool.pending_timers()==1);
+		EXLIB_CHECK(wait_until([&]
+			{
+				return ran==1;
+			}));
+	}
+
+	void check_destroy()
+	{
+		auto const start=std::chrono::steady_clock::now();
+		{
+			exlib::thread_pool pool(2);
+			pool.schedule_after(std::chrono::hours(1),[]() noexcept
+				{});
+		}
+		//a task still running when destruction starts adds a timer, which must be refused rather than restart the timer thread
+		std::atomic<bool> refused{false};
+		{
+			exlib::thread_pool pool(2);
+			pool.push_back([&refused](exlib::thread_pool::parent_ref parent) noexcept
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					refused=!parent.schedule_after(std::chrono::milliseconds(1),[]() noexcept
+						{});
+				});
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		EXLIB_CHECK(refused);
+		EXLIB_CHECK(std::chrono::steady_clock::now()-start<std::chrono::seconds(10));
+
+		exlib::thread_pool pool(1);
+		pool.join();
+		EXLIB_CHECK(!pool.schedule_after(std::chrono::milliseconds(1),[]() noexcept
+			{}));
+		pool.start();
+		std::atomic<int> ran{0};
+		EXLIB_CHECK(static_cast<bool>(pool.schedule_after(std::chrono::milliseconds(1),[&ran]() noexcept
+			{
+				++ran;
+			})));
+		EXLIB_CHECK(wait_until([&]
+			{
+				return ran==1;
+			}));
+	}
+}
+
+int main()
+{
+	check_wheel();
+	check_pool_timers();
+	check_reconfigure();
+	check_destroy();
+	return exlib_test::result();
+}
@@ -0,0 +1,113 @@
+/*
+	Round trips TraceLogger: events with every kind of trace argument are written with EXLIB_TRACE, as binary decoded by decode_trace
+	and as text, and must read back as the expected lines. Also checks that decode_trace refuses input that is not a trace or is cut off.
+*/
+#include "../ThreadPool/ThreadPool.h"
+#include "test_check.h"
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	enum class small_enum:unsigned char {
+		first,second
+	};
+	enum plain_enum {
+		plain_zero,plain_one,plain_minus=-3
+	};
+
+	void trace_all(exlib::TraceLogger& logger,int const* pointer)
+	{
+		EXLIB_TRACE(logger,"no arguments");
+		EXLIB_TRACE(logger,"bool {} {}",true,false);
+		EXLIB_TRACE(logger,"char {}",'z');
+		EXLIB_TRACE(logger,"signed {} {} {}",short(-7),-42,std::numeric_limits<std::int64_t>::min());
+		EXLIB_TRACE(logger,"unsigned {} {} {}",static_cast<unsigned char>(200),42u,std::numeric_limits<std::uint64_t>::max());
+		EXLIB_TRACE(logger,"double {} {}",2.5,0.25f);
+		EXLIB_TRACE(logger,"enum {} {}",small_enum::second,plain_minus);
+		EXLIB_TRACE(logger,"pointer {} {}",pointer,static_cast<int const*>(nullptr));
+		EXLIB_TRACE(logger,"extra {}",1,2,'c');
+		std::thread([&logger]
+			{
+				EXLIB_TRACE(logger,"other thread {}",7);
+			}).join();
+	}
+
+	std::vector<std::string> expected_lines(int const* pointer)
+	{
+		std::ostringstream address;
+		address<<"0x"<<std::hex<<reinterpret_cast<std::uintptr_t>(pointer);
+		return {
+			"[0] no arguments",
+			"[0] bool true false",
+			"[0] char z",
+			"[0] signed -7 -42 -9223372036854775808",
+			"[0] unsigned 200 42 18446744073709551615",
+			"[0] double 2.5 0.25",
+			"[0] enum 1 -3",
+			"[0] pointer "+address.str()+" 0x0",
+			"[0] extra 1 2 c",
+			"[1] other thread 7"
+		};
+	}
+
+	//drops the timestamp from each line, checking that it is there
+	std::vector<std::string> strip_times(std::string const& text)
+	{
+		std::vector<std::string> lines;
+		std::istringstream in(text);
+		std::string line;
+		while(std::getline(in,line))
+		{
+			auto const space=line.find(' ');
+			auto const dot=line.find('.');
+			EXLIB_CHECK(dot!=std::string::npos&&space==dot+10);
+			lines.push_back(space==std::string::npos?line:line.substr(space+1));
+		}
+		return lines;
+	}
+
+	void check_binary()
+	{
+		int const target=0;
+		std::ostringstream out;
+		{
+			exlib::TraceLogger logger(out);
+			trace_all(logger,&target);
+		}
+		auto const data=out.str();
+		std::istringstream in(data);
+		std::ostringstream text;
+		EXLIB_CHECK(exlib::decode_trace(in,text));
+		EXLIB_CHECK(strip_times(text.str())==expected_lines(&target));
+
+		std::istringstream cut(data.substr(0,data.size()-3));
+		std::ostringstream ignored;
+		EXLIB_CHECK(!exlib::decode_trace(cut,ignored));
+		std::istringstream not_trace("EXTRACE0 and some bytes");
+		EXLIB_CHECK(!exlib::decode_trace(not_trace,ignored));
+	}
+
+	void check_text()
+	{
+		int const target=0;
+		std::ostringstream out;
+		{
+			exlib::TraceLogger logger(out,exlib::TraceLogger::encoding::text);
+			trace_all(logger,&target);
+			logger.flush();
+			EXLIB_CHECK(strip_times(out.str())==expected_lines(&target));
+		}
+		EXLIB_CHECK(strip_times(out.str())==expected_lines(&target));
+	}
+}
+
+int main()
+{
+	check_binary();
+	check_text();
+	return exlib_test::result();
+}
@@ -14,11 +14,36 @@ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <queue>
 #include <memory>
 #include <atomic>
 #include <utility>
 #include <type_traits>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include <streambuf>
+#include <sstream>
+#include <istream>
+#include <iterator>
+#include <cstdio>
+#if defined(_MSC_VER)&&(defined(_M_X64)||defined(_M_IX86))
+#include <intrin.h>
+#define _EXLIB_TRACE_TSC 1
+#elif defined(__x86_64__)||defined(__i386__)
+#include <x86intrin.h>
+#define _EXLIB_TRACE_TSC 1
+#else
+#define _EXLIB_TRACE_TSC 0
+#endif
+#include "../Utils/exmpmc.h"
 namespace exlib {
 
 	namespace {
@@ -61,7 +86,67 @@ namespace exlib {
 	namespace detail {
 		struct tracked_thread {
 			std::thread thread;
-			std::atomic<bool> working;
+			//whether the thread should be looking for tasks; only changed under the pool's lock
+			std::atomic<bool> working{false};
+		};
+
+		/*
+			Owning queue of tasks that can be pushed to and popped from by any number of threads.
+			Tasks go in a bounded lock-free mpmc_queue;
+			once it is full they go in a locked overflow queue until that drains, so that order is kept.
+		*/
+		template<typename Task>
+		class task_queue {
+			static constexpr std::size_t ring_size=1024;
+			mpmc_queue<Task*> _ring;
+			alignas(64) std::atomic<std::size_t> _overflow_size{0};
+			std::mutex _overflow_lock;
+			std::queue<Task*> _overflow;
+		public:
+			task_queue():_ring(ring_size)
+			{}
+			task_queue(task_queue const&)=delete;
+			task_queue& operator=(task_queue const&)=delete;
+			~task_queue()
+			{
+				while(auto const task=pop())
+				{
+					delete task;
+				}
+			}
+			void push(std::unique_ptr<Task> task)
+			{
+				if(_overflow_size.load(std::memory_order_acquire)==0&&_ring.try_push(task.get()))
+				{
+					task.release();
+					return;
+				}
+				std::lock_guard<std::mutex> guard(_overflow_lock);
+				_overflow.push(task.get());
+				task.release();
+				_overflow_size.fetch_add(1,std::memory_order_release);
+			}
+			//returns nullptr if empty
+			Task* pop()
+			{
+				Task* task;
+				if(_ring.try_pop(task))
+				{
+					return task;
+				}
+				if(_overflow_size.load(std::memory_order_acquire)!=0)
+				{
+					std::lock_guard<std::mutex> guard(_overflow_lock);
+					if(!_overflow.empty())
+					{
+						task=_overflow.front();
+						_overflow.pop();
+						_overflow_size.fetch_sub(1,std::memory_order_release);
+						return task;
+					}
+				}
+				return nullptr;
+			}
 		};
 	}
 
@@ -69,6 +154,7 @@ namespace exlib {
 
 	/*
 		Thread pool for parallelizing a known/sequential set of jobs. Not intended for use as an event loop.
+		Threads sleep while they are not looking for tasks.
 	*/
 	template<typename... Args>
 	class ThreadPoolA {
@@ -76,54 +162,49 @@ namespace exlib {
 		typedef ThreadTaskA<Args...> Task;
 	private:
 		std::vector<detail::tracked_thread> _workers;
-		std::queue<std::unique_ptr<Task>> _tasks;
-		std::atomic<bool> _running;
+		detail::task_queue<Task> _tasks;
+		std::atomic<bool> _running{false};
 		std::mutex _locker;
 		std::tuple<Args...> _args;
+		//signals threads that they should look for tasks or end
+		std::condition_variable _signal;
 		std::condition_variable _queue_done;
-		std::atomic<size_t> _working_threads;
+		std::atomic<size_t> _working_threads{0};
 		inline void task_loop(size_t id)
 		{
-			while(_running)
+			auto& self=_workers[id];
+			while(true)
 			{
-				if(_workers[id].working) //unlikely to be waiting long and threads can be made to wait below, so this is easiest way
 				{
+					std::unique_lock<std::mutex> lk(_locker);
+					_signal.wait(lk,[&]
+						{
+							return self.working||!_running;
+						});
+					if(!self.working)
+					{
+						return;
+					}
 					++_working_threads;
-					while(true)
+				}
+				while(self.working.load(std::memory_order_relaxed))
+				{
+					std::unique_ptr<Task> task(_tasks.pop());
+					if(!task)
 					{
-						std::unique_ptr<Task> task;
-						{
-							std::lock_guard<std::mutex> guard(_locker); //can make threads wait here
-							if(!_tasks.empty())
-							{
-								task=std::move(_tasks.front());
-								_tasks.pop();
-							}
-						}
-						if(!_workers[id].working)
-						{
-							if(--_working_threads==0)
-							{
-								_queue_done.notify_one();
-							}
-							break;
-						}
-						if(task)
-						{
-							std::apply([&](auto&... args)
-							{
-								task->execute(args...);
-							},_args);
-						}
-						else
+						break;
+					}
+					std::apply([&](auto&... args)
 						{
-							_workers[id].working=false;
-							if(--_working_threads==0)
-							{
-								_queue_done.notify_one();
-							}
-							break;
-						}
+							task->execute(args...);
+						},_args);
+				}
+				{
+					std::lock_guard<std::mutex> guard(_locker);
+					self.working=false;
+					if(--_working_threads==0)
+					{
+						_queue_done.notify_all();
 					}
 				}
 			}
@@ -178,7 +259,7 @@ namespace exlib {
 		{}
 
 		/*
-			Adds a task of type Task constructed with args unsynchronized with running threads
+			Adds a task of type Task constructed with args. The queue is lock-free, so this is also safe while threads are running.
 		*/
 		template<typename ConsTask,typename... ConsArgs>
 		void add_task(ConsArgs&&... args)
@@ -208,7 +289,7 @@ namespace exlib {
 			anything with operator(Args...) defined and which is not a ThreadTaskA<Args...>
 		*/
 		template<typename Function>
-		auto add_task(Function func) -> decltype(func(std::declval<Args>()...),std::enable_if<!is_thread_task<Function>::value>::type())
+		auto add_task(Function func) -> decltype(func(std::declval<Args>()...),typename std::enable_if<!is_thread_task<Function>::value>::type())
 		{
 			_tasks.push(std::make_unique<AutoTaskA<decltype(func),Args...>>(std::move(func)));
 		}
@@ -217,9 +298,9 @@ namespace exlib {
 			Overload for copying or moving existing ThreadTasks
 		*/
 		template<typename ATask>
-		auto add_task(ATask&& task) -> decltype(std::enable_if<is_thread_task<ATask>::value>::type())
+		auto add_task(ATask&& task) -> decltype(typename std::enable_if<is_thread_task<ATask>::value>::type())
 		{
-			_tasks.push(std::make_unique<std::remove_reference<ATask>::type>(std::forward<ATask>(task)));
+			_tasks.push(std::make_unique<typename std::remove_cv<typename std::remove_reference<ATask>::type>::type>(std::forward<ATask>(task)));
 		}
 
 		/*
@@ -228,7 +309,6 @@ namespace exlib {
 		template<typename ConsTask,typename... ConsArgs>
 		void add_task_sync(ConsArgs&&... args)
 		{
-			std::lock_guard<std::mutex> guard(_locker);
 			add_task<ConsTask>(std::forward<ConsArgs>(args)...);
 		}
 
@@ -238,7 +318,6 @@ namespace exlib {
 		template<typename ATask>
 		void add_task_sync(ATask&& task)
 		{
-			std::lock_guard<std::mutex> guard(_locker);
 			add_task(std::forward<ATask>(task));
 		}
 
@@ -261,7 +340,6 @@ namespace exlib {
 		void add_tasks_sync(Tasks&&... tasks)
 		{
 			static_assert(sizeof...(tasks)>0,"Arguments needed");
-			std::lock_guard<std::mutex> guard(_locker);
 			add_tasks_base(std::forward<Tasks>(tasks)...);
 		}
 		/*
@@ -290,14 +368,18 @@ namespace exlib {
 		}
 
 		/*
-			Makes threads start looking for tasks.
+			Makes threads start looking for tasks. Each thread stops looking once it finds the queue empty.
 		*/
 		void start()
 		{
-			for(auto& w:_workers)
 			{
-				w.working=true;
+				std::lock_guard<std::mutex> guard(_locker);
+				for(auto& w:_workers)
+				{
+					w.working=true;
+				}
 			}
+			_signal.notify_all();
 		}
 
 		/*
@@ -305,6 +387,7 @@ namespace exlib {
 		*/
 		void give_up()
 		{
+			std::lock_guard<std::mutex> guard(_locker);
 			for(auto& w:_workers)
 			{
 				w.working=false;
@@ -336,11 +419,14 @@ namespace exlib {
 	   */
 		void wait()
 		{
-			if(_working_threads!=0)
-			{
-				std::unique_lock<std::mutex> lk(_locker);
-				_queue_done.wait(lk);
-			}
+			std::unique_lock<std::mutex> lk(_locker);
+			_queue_done.wait(lk,[this]
+				{
+					return _working_threads==0&&(!_running||std::none_of(_workers.begin(),_workers.end(),[](detail::tracked_thread const& w)
+						{
+							return w.working.load();
+						}));
+				});
 		}
 
 		/*
@@ -348,7 +434,11 @@ namespace exlib {
 		*/
 		void join()
 		{
-			_running=false;
+			{
+				std::lock_guard<std::mutex> guard(_locker);
+				_running=false;
+			}
+			_signal.notify_all();
 			for(auto& w:_workers)
 			{
 				if(w.thread.joinable())
@@ -457,5 +547,835 @@ namespace exlib {
 	template<typename Output>
 	Logger(Output&)->Logger<Output>;
 #endif
+
+	namespace detail {
+		/*
+			Single producer single consumer ring of characters. Whole messages are published at once,
+			so the consumer never sees part of one.
+		*/
+		template<typename Char>
+		class log_ring {
+			std::unique_ptr<Char[]> _data;
+			std::size_t _mask;
+			alignas(64) std::atomic<std::size_t> _read{0};
+			alignas(64) std::atomic<std::size_t> _write{0};
+		public:
+			//set once the logger is destroyed, so the producer thread forgets the ring
+			std::atomic<bool> closed{false};
+			//order in which the logger's rings were made
+			std::size_t index=0;
+
+			explicit log_ring(std::size_t capacity):_mask(capacity-1)
+			{
+				assert(capacity!=0&&(capacity&(capacity-1))==0);
+				_data.reset(new Char[capacity]);
+			}
+
+			std::size_t capacity() const noexcept
+			{
+				return _mask+1;
+			}
+
+			//producer only
+			bool try_write(Char const* message,std::size_t size) noexcept
+			{
+				auto const write=_write.load(std::memory_order_relaxed);
+				if(size>capacity()-(write-_read.load(std::memory_order_acquire)))
+				{
+					return false;
+				}
+				auto const start=write&_mask;
+				auto const first=std::min(size,capacity()-start);
+				std::memcpy(&_data[start],message,first*sizeof(Char));
+				std::memcpy(&_data[0],message+first,(size-first)*sizeof(Char));
+				_write.store(write+size,std::memory_order_release);
+				return true;
+			}
+
+			//consumer only; appends everything published to out
+			void drain(std::basic_string<Char>& out)
+			{
+				auto const read=_read.load(std::memory_order_relaxed);
+				auto const size=_write.load(std::memory_order_acquire)-read;
+				if(size==0)
+				{
+					return;
+				}
+				auto const start=read&_mask;
+				auto const first=std::min(size,capacity()-start);
+				out.append(&_data[start],first);
+				out.append(&_data[0],size-first);
+				_read.store(read+size,std::memory_order_release);
+			}
+
+			bool empty() const noexcept
+			{
+				return _read.load(std::memory_order_acquire)==_write.load(std::memory_order_acquire);
+			}
+		};
+
+		//streambuf appending to a string that keeps its capacity between messages
+		template<typename Char>
+		class log_buffer:public std::basic_streambuf<Char> {
+			using traits=std::char_traits<Char>;
+		public:
+			std::basic_string<Char> text;
+		protected:
+			typename traits::int_type overflow(typename traits::int_type c) override
+			{
+				if(!traits::eq_int_type(c,traits::eof()))
+				{
+					text.push_back(traits::to_char_type(c));
+				}
+				return traits::not_eof(c);
+			}
+			std::streamsize xsputn(Char const* s,std::streamsize n) override
+			{
+				text.append(s,static_cast<std::size_t>(n));
+				return n;
+			}
+		};
+
+		template<typename Char>
+		void write_log(std::basic_string<Char>& output,std::basic_string<Char> const& batch)
+		{
+			output+=batch;
+		}
+
+		template<typename Char>
+		void write_log(std::basic_ostream<Char>& output,std::basic_string<Char> const& batch)
+		{
+			output.write(batch.data(),static_cast<std::streamsize>(batch.size()));
+			output.flush();
+		}
+	}
+
+	namespace detail {
+		/*
+			The part of AsyncLogger and TraceLogger that moves messages from each logging thread's own ring
+			to a background thread, which hands them to write_batch in batches.
+			Derived classes must call stop() in their destructor.
+		*/
+		template<typename Char>
+		class ring_logger {
+		public:
+			enum class overflow {
+				block,drop
+			};
+		protected:
+			using ring=log_ring<Char>;
+		private:
+			//rings of this thread, by logger id
+			struct local_rings {
+				std::vector<std::pair<std::uint64_t,std::shared_ptr<ring>>> rings;
+			};
+
+			std::uint64_t const _id;
+			std::size_t const _ring_capacity;
+			overflow const _policy;
+			std::chrono::milliseconds const _interval;
+			std::atomic<std::size_t> _dropped{0};
+			//guards _rings, and the flush and stop state
+			std::mutex _mtx;
+			std::condition_variable _wake;
+			std::condition_variable _flushed;
+			std::vector<std::shared_ptr<ring>> _rings;
+			std::size_t _rings_made=0;
+			std::uint64_t _flush_requested=0;
+			std::uint64_t _flush_done=0;
+			bool _stop=false;
+			std::thread _drainer;
+
+			static std::uint64_t next_id() noexcept
+			{
+				static std::atomic<std::uint64_t> id{0};
+				return ++id;
+			}
+
+			static local_rings& locals()
+			{
+				static thread_local local_rings l;
+				return l;
+			}
+
+			void drain_loop()
+			{
+				std::basic_string<Char> batch;
+				std::unique_lock<std::mutex> lock(_mtx);
+				while(true)
+				{
+					auto const requested=_flush_requested;
+					bool const stopping=_stop;
+					for(auto it=_rings.begin();it!=_rings.end();)
+					{
+						//the thread that wrote it has exited; the fence makes its last messages visible
+						bool const orphaned=it->use_count()==1;
+						if(orphaned)
+						{
+							std::atomic_thread_fence(std::memory_order_acquire);
+						}
+						(*it)->drain(batch);
+						if(orphaned)
+						{
+							it=_rings.erase(it);
+						}
+						else
+						{
+							++it;
+						}
+					}
+					after_drain(batch);
+					if(!batch.empty())
+					{
+						lock.unlock();
+						write_batch(batch);
+						batch.clear();
+						lock.lock();
+					}
+					if(_flush_done!=requested)
+					{
+						_flush_done=requested;
+						_flushed.notify_all();
+					}
+					if(stopping)
+					{
+						return;
+					}
+					if(_flush_requested==requested&&!_stop)
+					{
+						_wake.wait_for(lock,_interval);
+					}
+				}
+			}
+		protected:
+			ring_logger(std::size_t ring_capacity,overflow policy,std::chrono::milliseconds flush_interval):
+				_id(next_id()),_ring_capacity(ring_capacity),_policy(policy),_interval(flush_interval)
+			{}
+
+			virtual ~ring_logger()
+			{
+				assert(!_drainer.joinable()&&"derived loggers must call stop()");
+			}
+
+			//called by the background thread with the lock held, after the rings are drained into batch
+			virtual void after_drain(std::basic_string<Char>&)
+			{}
+
+			virtual void write_batch(std::basic_string<Char>& batch)=0;
+
+			void start()
+			{
+				_drainer=std::thread(&ring_logger::drain_loop,this);
+			}
+
+			//writes everything left and ends the background thread
+			void stop()
+			{
+				{
+					std::lock_guard<std::mutex> guard(_mtx);
+					_stop=true;
+					for(auto const& r:_rings)
+					{
+						r->closed.store(true,std::memory_order_relaxed);
+					}
+				}
+				_wake.notify_one();
+				_drainer.join();
+			}
+
+			ring& this_thread_ring()
+			{
+				auto& rings=locals().rings;
+				for(auto const& entry:rings)
+				{
+					if(entry.first==_id)
+					{
+						return *entry.second;
+					}
+				}
+				rings.erase(std::remove_if(rings.begin(),rings.end(),[](std::pair<std::uint64_t,std::shared_ptr<ring>> const& entry)
+					{
+						return entry.second->closed.load(std::memory_order_relaxed);
+					}),rings.end());
+				auto const made=std::make_shared<ring>(_ring_capacity);
+				{
+					std::lock_guard<std::mutex> guard(_mtx);
+					made->index=_rings_made++;
+					_rings.push_back(made);
+				}
+				rings.emplace_back(_id,made);
+				return *made;
+			}
+
+			void publish(ring& r,Char const* message,std::size_t size)
+			{
+				if(r.try_write(message,size))
+				{
+					return;
+				}
+				if(_policy==overflow::drop)
+				{
+					_dropped.fetch_add(1,std::memory_order_relaxed);
+					return;
+				}
+				while(size!=0)
+				{
+					auto const piece=std::min(size,r.capacity());
+					while(!r.try_write(message,piece))
+					{
+						_wake.notify_one();
+						std::this_thread::yield();
+					}
+					message+=piece;
+					size-=piece;
+				}
+			}
+		public:
+			ring_logger(ring_logger const&)=delete;
+			ring_logger& operator=(ring_logger const&)=delete;
+
+			/*
+				Waits until everything logged before the call has been written to the output.
+			*/
+			void flush()
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				auto const ticket=++_flush_requested;
+				_wake.notify_one();
+				_flushed.wait(lock,[this,ticket]
+					{
+						return _flush_done>=ticket;
+					});
+			}
+
+			/*
+				The number of messages dropped because a ring was full, with overflow::drop.
+			*/
+			std::size_t dropped() const noexcept
+			{
+				return _dropped.load(std::memory_order_relaxed);
+			}
+		};
+	}
+
+	/*
+		Logger that formats on the calling thread into a ring buffer of that thread's own, without locking,
+		and writes to the output from a background thread in batches.
+		Messages from one thread keep their order; messages from different threads are ordered by when they are drained.
+		When a thread's ring is full, log either waits for the background thread (overflow::block)
+		or drops the message and counts it (overflow::drop). A message longer than the ring is written in pieces, or dropped.
+		The output must not be used by anything else while the logger exists.
+	*/
+	template<typename Output>
+	class AsyncLogger:public detail::ring_logger<typename Output::traits_type::char_type> {
+	public:
+		using char_type=typename Output::traits_type::char_type;
+	private:
+		using base=detail::ring_logger<char_type>;
+		struct formatter {
+			detail::log_buffer<char_type> buffer;
+			std::basic_ostream<char_type> stream{&buffer};
+		};
+
+		Output* _output;
+
+		static formatter& this_thread_formatter()
+		{
+			static thread_local formatter f;
+			return f;
+		}
+
+		void write_batch(std::basic_string<char_type>& batch) override
+		{
+			detail::write_log(*_output,batch);
+		}
+	public:
+		using typename base::overflow;
+
+		/*
+			ring_capacity is the number of characters each logging thread can have waiting, and must be a power of 2.
+			Batches are written every flush_interval, when a blocked thread needs room, or on flush.
+		*/
+		explicit AsyncLogger(Output& out,std::size_t ring_capacity=std::size_t(1)<<16,overflow policy=overflow::block,std::chrono::milliseconds flush_interval=std::chrono::milliseconds(10)):
+			base(ring_capacity,policy,flush_interval),_output(&out)
+		{
+			this->start();
+		}
+
+		/*
+			Writes everything logged before it returns.
+		*/
+		~AsyncLogger()
+		{
+			this->stop();
+		}
+
+		/*
+			Formats the arguments with operator<< into this thread's ring.
+		*/
+		template<typename T,typename... U>
+		void log(T const& arg,U const&... args)
+		{
+			auto& f=this_thread_formatter();
+			f.buffer.text.clear();
+			f.stream<<arg;
+			using expand=int[];
+			(void)expand{0,((void)(f.stream<<args),0)...};
+			this->publish(this->this_thread_ring(),f.buffer.text.data(),f.buffer.text.size());
+		}
+	};
+
+	typedef AsyncLogger<std::ofstream> AsyncFileLogger;
+	typedef AsyncLogger<std::ostream> AsyncOstreamLogger;
+	typedef AsyncLogger<std::wostream> AsyncWOstreamLogger;
+	typedef AsyncLogger<std::string> AsyncStringLogger;
+	typedef AsyncLogger<std::wstring> AsyncWStringLogger;
+
+#if __cplusplus>=201700L
+	template<typename Output>
+	AsyncLogger(Output&)->AsyncLogger<Output>;
+#endif
+
+	namespace detail {
+		/*
+			How a trace argument is recorded: a type letter for the decoder, and the type its bytes are stored as.
+			b bool, c char, i signed integer, u unsigned integer, d floating point, p pointer.
+		*/
+		template<typename T,typename Enable=void>
+		struct trace_arg {
+			static_assert(sizeof(T)==0,"trace arguments must be arithmetic types, enums or pointers");
+		};
+		template<>
+		struct trace_arg<bool> {
+			static constexpr char type='b';
+			using stored=bool;
+		};
+		template<>
+		struct trace_arg<char> {
+			static constexpr char type='c';
+			using stored=char;
+		};
+		template<typename T>
+		struct trace_arg<T,std::enable_if_t<std::is_integral_v<T>&&std::is_signed_v<T>&&!std::is_same_v<T,char>>> {
+			static constexpr char type='i';
+			using stored=std::int64_t;
+		};
+		template<typename T>
+		struct trace_arg<T,std::enable_if_t<std::is_integral_v<T>&&std::is_unsigned_v<T>&&!std::is_same_v<T,bool>&&!std::is_same_v<T,char>>> {
+			static constexpr char type='u';
+			using stored=std::uint64_t;
+		};
+		template<typename T>
+		struct trace_arg<T,std::enable_if_t<std::is_floating_point_v<T>>> {
+			static constexpr char type='d';
+			using stored=double;
+		};
+		template<typename T>
+		struct trace_arg<T,std::enable_if_t<std::is_enum_v<T>>>:trace_arg<std::underlying_type_t<T>> {};
+		template<typename T>
+		struct trace_arg<T*> {
+			static constexpr char type='p';
+			using stored=std::uint64_t;
+		};
+
+		template<typename T>
+		typename trace_arg<T>::stored trace_store(T const& value) noexcept
+		{
+			if constexpr(std::is_pointer_v<T>)
+			{
+				return reinterpret_cast<std::uintptr_t>(value);
+			}
+			else
+			{
+				return static_cast<typename trace_arg<T>::stored>(value);
+			}
+		}
+
+		inline std::size_t trace_arg_size(char type) noexcept
+		{
+			return type=='b'||type=='c'?1:8;
+		}
+
+		template<typename T>
+		void trace_put(char*& out,T const& value) noexcept
+		{
+			std::memcpy(out,&value,sizeof(T));
+			out+=sizeof(T);
+		}
+
+		template<typename T>
+		T trace_get(char const*& in) noexcept
+		{
+			T value;
+			std::memcpy(&value,in,sizeof(T));
+			in+=sizeof(T);
+			return value;
+		}
+
+		struct trace_format {
+			std::string types;
+			std::string text;
+		};
+
+		//timestamps of trace records: the time stamp counter where there is one, as it is cheaper to read than steady_clock
+		inline std::uint64_t trace_ticks() noexcept
+		{
+#if _EXLIB_TRACE_TSC
+			return __rdtsc();
+#else
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+
+		//id of records giving the ticks when the logger started and the nanoseconds per tick measured since
+		constexpr std::uint32_t trace_clock_id=0xFFFFFFFF;
+
+		//the formats of every trace call site in the process; ids start at 1
+		class trace_registry {
+			std::mutex _mtx;
+			std::vector<trace_format> _formats;
+		public:
+			static trace_registry& instance()
+			{
+				static trace_registry registry;
+				return registry;
+			}
+			std::uint32_t add(std::string types,char const* text)
+			{
+				std::lock_guard<std::mutex> guard(_mtx);
+				_formats.push_back(trace_format{std::move(types),text});
+				return static_cast<std::uint32_t>(_formats.size());
+			}
+			//appends the formats after the first count of them to out
+			void copy_new(std::vector<trace_format>& out)
+			{
+				std::lock_guard<std::mutex> guard(_mtx);
+				out.insert(out.end(),_formats.begin()+out.size(),_formats.end());
+			}
+		};
+
+		constexpr char trace_magic[8]={'E','X','T','R','A','C','E','1'};
+		constexpr std::size_t trace_header_size=2*sizeof(std::uint32_t)+sizeof(std::uint64_t);
+
+		/*
+			Turns trace records back into text, one line per event: seconds since the logger started, [thread], then the format
+			with each {} replaced by the next argument.
+		*/
+		class trace_decoder {
+			std::vector<trace_format> _formats;
+			std::uint64_t _start_ticks=0;
+			double _ns_per_tick=1;
+
+			static void write_arg(std::ostream& out,char type,char const*& in)
+			{
+				switch(type)
+				{
+					case 'b':
+						out<<(trace_get<bool>(in)?"true":"false");
+						break;
+					case 'c':
+						out<<trace_get<char>(in);
+						break;
+					case 'i':
+						out<<trace_get<std::int64_t>(in);
+						break;
+					case 'u':
+						out<<trace_get<std::uint64_t>(in);
+						break;
+					case 'd':
+						out<<trace_get<double>(in);
+						break;
+					default:
+					{
+						auto const flags=out.flags();
+						out<<"0x"<<std::hex<<trace_get<std::uint64_t>(in);
+						out.flags(flags);
+					}
+				}
+			}
+		public:
+			std::vector<trace_format>& formats() noexcept
+			{
+				return _formats;
+			}
+
+			void calibrate(std::uint64_t start_ticks,double ns_per_tick) noexcept
+			{
+				_start_ticks=start_ticks;
+				_ns_per_tick=ns_per_tick;
+			}
+
+			/*
+				Decodes the record at in, either a format definition or an event, and advances in past it.
+				Returns false, leaving in alone, if the record is cut off by end or is malformed.
+			*/
+			bool decode(char const*& in,char const* end,std::ostream& out)
+			{
+				auto p=in;
+				if(static_cast<std::size_t>(end-p)<sizeof(std::uint32_t))
+				{
+					return false;
+				}
+				auto const id=trace_get<std::uint32_t>(p);
+				if(id==trace_clock_id)
+				{
+					if(static_cast<std::size_t>(end-p)<sizeof(std::uint64_t)+sizeof(double))
+					{
+						return false;
+					}
+					_start_ticks=trace_get<std::uint64_t>(p);
+					_ns_per_tick=trace_get<double>(p);
+					in=p;
+					return true;
+				}
+				if(id==0)
+				{
+					if(static_cast<std::size_t>(end-p)<2*sizeof(std::uint32_t))
+					{
+						return false;
+					}
+					auto const defined=trace_get<std::uint32_t>(p);
+					auto const types_size=trace_get<std::uint32_t>(p);
+					if(static_cast<std::size_t>(end-p)<types_size+sizeof(std::uint32_t))
+					{
+						return false;
+					}
+					std::string types(p,types_size);
+					p+=types_size;
+					auto const text_size=trace_get<std::uint32_t>(p);
+					if(static_cast<std::size_t>(end-p)<text_size||defined==0)
+					{
+						return false;
+					}
+					if(_formats.size()<defined)
+					{
+						_formats.resize(defined);
+					}
+					_formats[defined-1]=trace_format{std::move(types),std::string(p,text_size)};
+					in=p+text_size;
+					return true;
+				}
+				if(id>_formats.size()||static_cast<std::size_t>(end-p)<trace_header_size-sizeof(std::uint32_t))
+				{
+					return false;
+				}
+				auto const& format=_formats[id-1];
+				std::size_t args_size=0;
+				for(auto const type:format.types)
+				{
+					args_size+=trace_arg_size(type);
+				}
+				if(static_cast<std::size_t>(end-p)<trace_header_size-sizeof(std::uint32_t)+args_size)
+				{
+					return false;
+				}
+				auto const thread=trace_get<std::uint32_t>(p);
+				auto const ticks=trace_get<std::uint64_t>(p);
+				auto const ns=ticks>_start_ticks?static_cast<std::uint64_t>(static_cast<double>(ticks-_start_ticks)*_ns_per_tick):0;
+				char time[32];
+				std::snprintf(time,sizeof(time),"%llu.%09llu",static_cast<unsigned long long>(ns/1000000000),static_cast<unsigned long long>(ns%1000000000));
+				out<<time<<" ["<<thread<<"] ";
+				std::size_t arg=0;
+				auto const& text=format.text;
+				for(std::size_t i=0;i<text.size();++i)
+				{
+					if(text[i]=='{'&&i+1<text.size()&&text[i+1]=='}'&&arg<format.types.size())
+					{
+						write_arg(out,format.types[arg++],p);
+						++i;
+					}
+					else
+					{
+						out<<text[i];
+					}
+				}
+				for(;arg<format.types.size();++arg)
+				{
+					out<<' ';
+					write_arg(out,format.types[arg],p);
+				}
+				out<<'\n';
+				in=p;
+				return true;
+			}
+		};
+	}
+
+	/*
+		The id of a trace format, registering it. Called once per call site by EXLIB_TRACE, with the arguments of the first call
+		giving the argument types.
+	*/
+	template<typename... T>
+	std::uint32_t trace_format_id(char const* format,T const&...)
+	{
+		return detail::trace_registry::instance().add(std::string{detail::trace_arg<T>::type...},format);
+	}
+
+	/*
+		Logger for hot paths that defers formatting: a trace call copies a format id, a timestamp and the raw bytes of its
+		arithmetic, enum or pointer arguments into the calling thread's ring, taking tens of nanoseconds.
+		Timestamps are time stamp counter ticks on x86, converted with a rate the background thread measures against steady_clock.
+		A background thread writes the records in batches, either as binary (decode it with exlib::decode_trace or the
+		trace_decode tool) or formatted as text. Binary output starts with a magic number and includes the format definitions,
+		so a file decodes on its own; open file outputs in binary mode.
+		Use through EXLIB_TRACE(logger,"format with {} for each argument",args...).
+		Records from one thread keep their order; each line names the thread by the order in which threads first traced.
+	*/
+	class TraceLogger:public detail::ring_logger<char> {
+	public:
+		enum class encoding {
+			binary,text
+		};
+	private:
+		using base=detail::ring_logger<char>;
+		std::ostream* _output;
+		encoding const _encoding;
+		std::chrono::steady_clock::time_point const _start;
+		std::uint64_t const _start_ticks;
+		//formats known to the background thread
+		detail::trace_decoder _decoder;
+		//clock and format definition records put ahead of a binary batch
+		std::string _prefix;
+		std::string _text;
+
+		//the clock, and the definitions of formats registered since the last batch, go ahead of the batch's records
+		void after_drain(std::string& batch) override
+		{
+			auto const ticks=detail::trace_ticks()-_start_ticks;
+			auto const ns=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-_start).count();
+			double const ns_per_tick=ticks!=0?static_cast<double>(ns)/static_cast<double>(ticks):1;
+			auto& formats=_decoder.formats();
+			auto const known=formats.size();
+			//copied after draining, so every drained record's format is registered by now
+			detail::trace_registry::instance().copy_new(formats);
+			if(_encoding!=encoding::binary)
+			{
+				_decoder.calibrate(_start_ticks,ns_per_tick);
+				return;
+			}
+			_prefix.clear();
+			char clock[sizeof(std::uint32_t)+sizeof(std::uint64_t)+sizeof(double)];
+			auto out=clock;
+			detail::trace_put(out,detail::trace_clock_id);
+			detail::trace_put(out,_start_ticks);
+			detail::trace_put(out,ns_per_tick);
+			_prefix.append(clock,out);
+			for(auto i=known;i<formats.size();++i)
+			{
+				auto const& format=formats[i];
+				char header[4*sizeof(std::uint32_t)];
+				out=header;
+				detail::trace_put(out,std::uint32_t(0));
+				detail::trace_put(out,static_cast<std::uint32_t>(i+1));
+				detail::trace_put(out,static_cast<std::uint32_t>(format.types.size()));
+				_prefix.append(header,out);
+				_prefix+=format.types;
+				out=header;
+				detail::trace_put(out,static_cast<std::uint32_t>(format.text.size()));
+				_prefix.append(header,out);
+				_prefix+=format.text;
+			}
+			batch.insert(0,_prefix);
+		}
+
+		void write_batch(std::string& batch) override
+		{
+			if(_encoding==encoding::binary)
+			{
+				detail::write_log(*_output,batch);
+				return;
+			}
+			std::ostringstream text;
+			char const* in=batch.data();
+			char const* const end=in+batch.size();
+			while(in!=end)
+			{
+				if(_decoder.decode(in,end,text))
+				{
+					continue;
+				}
+				//records carry no length, so one whose format is still unknown after refreshing cannot be stepped over
+				detail::trace_registry::instance().copy_new(_decoder.formats());
+				if(!_decoder.decode(in,end,text))
+				{
+					text<<"[trace: "<<(end-in)<<" bytes could not be decoded]\n";
+					break;
+				}
+			}
+			_text=text.str();
+			detail::write_log(*_output,_text);
+		}
+	public:
+		/*
+			ring_capacity is the number of bytes each tracing thread can have waiting, and must be a power of 2 of at least 1024.
+			Batches are written every flush_interval, when a blocked thread needs room, or on flush.
+		*/
+		explicit TraceLogger(std::ostream& out,encoding enc=encoding::binary,std::size_t ring_capacity=std::size_t(1)<<16,overflow policy=overflow::block,std::chrono::milliseconds flush_interval=std::chrono::milliseconds(10)):
+			base(ring_capacity,policy,flush_interval),_output(&out),_encoding(enc),_start(std::chrono::steady_clock::now()),_start_ticks(detail::trace_ticks())
+		{
+			assert(ring_capacity>=1024);
+			if(enc==encoding::binary)
+			{
+				out.write(detail::trace_magic,sizeof(detail::trace_magic));
+			}
+			this->start();
+		}
+
+		/*
+			Writes everything traced before it returns.
+		*/
+		~TraceLogger()
+		{
+			this->stop();
+		}
+
+		/*
+			Records an event with format_id, which must come from trace_format_id with the same argument types.
+			The format is only used for registration.
+		*/
+		template<typename... T>
+		void trace(std::uint32_t format_id,char const*,T const&... args)
+		{
+			static_assert(sizeof...(T)<=64,"too many trace arguments");
+			constexpr std::size_t size=detail::trace_header_size+(std::size_t(0)+...+sizeof(typename detail::trace_arg<T>::stored));
+			auto& r=this->this_thread_ring();
+			char record[size];
+			auto out=record;
+			detail::trace_put(out,format_id);
+			detail::trace_put(out,static_cast<std::uint32_t>(r.index));
+			detail::trace_put(out,detail::trace_ticks());
+			(detail::trace_put(out,detail::trace_store(args)),...);
+			this->publish(r,record,size);
+		}
+	};
+
+	/*
+		Decodes binary TraceLogger output from in into text on out. Returns false if the input is not a trace or is cut off.
+	*/
+	inline bool decode_trace(std::istream& in,std::ostream& out)
+	{
+		std::string data{std::istreambuf_iterator<char>(in),std::istreambuf_iterator<char>()};
+		if(data.size()<sizeof(detail::trace_magic)||std::memcmp(data.data(),detail::trace_magic,sizeof(detail::trace_magic))!=0)
+		{
+			return false;
+		}
+		detail::trace_decoder decoder;
+		char const* p=data.data()+sizeof(detail::trace_magic);
+		char const* const end=data.data()+data.size();
+		while(p!=end)
+		{
+			if(!decoder.decode(p,end,out))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
 }
+
+/*
+	Records a trace event on a TraceLogger: EXLIB_TRACE(logger,"format with {} for each argument",args...).
+	The format must be a string literal; it is registered once per call site.
+*/
+#define EXLIB_TRACE(logger,...) do{static std::uint32_t const exlib_trace_format_id=::exlib::trace_format_id(__VA_ARGS__);(logger).trace(exlib_trace_format_id,__VA_ARGS__);}while(0)
 #endif // !THREAD_POOL_H
@@ -16,8 +16,16 @@ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 namespace exlib {
 	namespace global_thread_pool {
 		namespace detail {
-			thread_pool& get_pool() {
+			//elastic so tasks that block inside a blocking_region don't starve CPU bound ones;
+			//it does not grow on a backlog, so CPU bound work alone never runs more threads than the core workers
+			static thread_pool& make_pool() {
 				static thread_pool pool;
+				auto const threads=pool.num_threads();
+				pool.elastic(threads,4*threads,std::chrono::milliseconds(1000),std::chrono::milliseconds(0));
+				return pool;
+			}
+			thread_pool& get_pool() {
+				static thread_pool& pool=make_pool();
 				return pool;
 			}
 		}
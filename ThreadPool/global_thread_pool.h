@@ -39,12 +39,57 @@ namespace exlib {
 		{
 			detail::get_pool().push_front(std::forward<Tasks>(tasks)...);
 		}
+		template<typename... Tasks>
+		void push_back_node(size_t node,Tasks&&... tasks)
+		{
+			detail::get_pool().push_back_node(node,std::forward<Tasks>(tasks)...);
+		}
+
+		/*
+			The number of core workers of the global pool, which elastic scaling adds to while tasks are inside a blocking_region.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD inline size_t num_threads()
+		{
+			return detail::get_pool().num_threads();
+		}
+
+		/*
+			See thread_pool_a::blocking_region
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD inline thread_pool::blocking_guard blocking_region()
+		{
+			return detail::get_pool().blocking_region();
+		}
 
 		template<typename Task>
 		_EXLIB_THREAD_POOL_NODISCARD auto async(Task&& task) -> decltype(detail::get_pool().async(std::forward<Task>(task)))
 		{
 			return detail::get_pool().async(std::forward<Task>(task));
 		}
+
+		template<typename Func,typename... Rest>
+		void parallel_invoke(Func&& func,Rest&&... rest)
+		{
+			detail::get_pool().parallel_invoke(std::forward<Func>(func),std::forward<Rest>(rest)...);
+		}
+
+		template<typename Index,typename Func>
+		void parallel_for(Index begin,Index end,size_t grain,Func&& f)
+		{
+			detail::get_pool().parallel_for(begin,end,grain,std::forward<Func>(f));
+		}
+
+		template<typename Index,typename T,typename RangeReduce,typename Combine>
+		T parallel_reduce(Index first,Index last,size_t grain,T identity,RangeReduce range_reduce,Combine combine)
+		{
+			return detail::get_pool().parallel_reduce(first,last,grain,std::move(identity),std::move(range_reduce),std::move(combine));
+		}
+
+		template<typename Index,typename T,typename Reduce,typename Transform>
+		T parallel_transform_reduce(Index first,Index last,size_t grain,T identity,Reduce reduce,Transform transform)
+		{
+			return detail::get_pool().parallel_transform_reduce(first,last,grain,std::move(identity),std::move(reduce),std::move(transform));
+		}
 	}
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,651 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXLIB_POOL_FUTURE_H
+#define EXLIB_POOL_FUTURE_H
+#include "thread_pool.h"
+#include <vector>
+namespace exlib {
+
+	template<typename T>
+	class pool_future;
+
+	template<typename T>
+	class pool_promise;
+
+	/*
+		The result of when_any: the futures passed in, and the index of the first one that became ready
+		(or -1 if there were none).
+	*/
+	template<typename Sequence>
+	struct when_any_result {
+		std::size_t index;
+		Sequence futures;
+	};
+
+	namespace pool_future_detail {
+
+		class state_base;
+
+		//run with the completed state; stored in place in the state if it fits
+		using continuation=thread_pool_detail::small_task<void(state_base&),EXLIB_THREAD_POOL_JOB_SIZE>;
+
+		/*
+			Type erased handle to the pool continuations are scheduled on.
+			Continuations of a state without a pool run on the thread that completes it.
+		*/
+		struct executor {
+			void* pool;
+			void(*submit)(void*,std::shared_ptr<state_base>&&);
+		};
+
+		class state_base:public std::enable_shared_from_this<state_base> {
+		public:
+			explicit state_base(executor exec) noexcept:_exec(exec)
+			{}
+
+			virtual ~state_base()=default;
+
+			executor get_executor() const noexcept
+			{
+				return _exec;
+			}
+
+			bool ready() const
+			{
+				std::lock_guard<std::mutex> lock{_mtx};
+				return _ready;
+			}
+
+			void wait() const
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				_ready_cv.wait(lock,[this]
+					{
+						return _ready;
+					});
+			}
+
+			void set_exception(std::exception_ptr e)
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				check_unsatisfied();
+				_error=std::move(e);
+				complete(lock);
+			}
+
+			//sets the exception unless a result was already set
+			void fail(std::exception_ptr e) noexcept
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				if(!_ready)
+				{
+					_error=std::move(e);
+					complete(lock);
+				}
+			}
+
+			/*
+				Sets the function run once the state is ready, replacing any previous one.
+				If run_inline, it runs on the completing thread instead of being scheduled on the pool,
+				so it must be short.
+			*/
+			void attach(continuation&& c,bool run_inline)
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				_continuation=std::move(c);
+				_inline=run_inline;
+				if(_ready)
+				{
+					lock.unlock();
+					schedule(run_inline);
+				}
+			}
+
+			void run_continuation() noexcept
+			{
+				continuation c;
+				{
+					std::lock_guard<std::mutex> lock{_mtx};
+					c=std::move(_continuation);
+				}
+				if(c)
+				{
+					c(*this);
+				}
+			}
+		protected:
+			void check_unsatisfied() const
+			{
+				if(_ready)
+				{
+					throw std::future_error(std::future_errc::promise_already_satisfied);
+				}
+			}
+
+			void rethrow_if_error() const
+			{
+				if(_error)
+				{
+					std::rethrow_exception(_error);
+				}
+			}
+
+			//marks the state ready after its result was stored under the lock
+			void complete(std::unique_lock<std::mutex>& lock)
+			{
+				_ready=true;
+				bool const has_continuation=static_cast<bool>(_continuation);
+				bool const run_inline=_inline;
+				lock.unlock();
+				_ready_cv.notify_all();
+				if(has_continuation)
+				{
+					schedule(run_inline);
+				}
+			}
+
+			bool has_value() const noexcept
+			{
+				return _ready&&!_error;
+			}
+
+			mutable std::mutex _mtx;
+		private:
+			void schedule(bool run_inline)
+			{
+				if(run_inline||!_exec.pool)
+				{
+					run_continuation();
+				}
+				else
+				{
+					_exec.submit(_exec.pool,shared_from_this());
+				}
+			}
+
+			mutable std::condition_variable _ready_cv;
+			bool _ready=false;
+			bool _inline=false;
+			std::exception_ptr _error;
+			continuation _continuation;
+			executor _exec;
+		};
+
+		template<typename T>
+		class future_state:public state_base {
+			static_assert(!std::is_reference<T>::value,"Use std::reference_wrapper for references.");
+			alignas(T) unsigned char _storage[sizeof(T)];
+			T& value() noexcept
+			{
+				return *reinterpret_cast<T*>(&_storage);
+			}
+		public:
+			using state_base::state_base;
+
+			template<typename... U>
+			void set_value(U&& ... args)
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				check_unsatisfied();
+				new (&_storage) T(std::forward<U>(args)...);
+				complete(lock);
+			}
+
+			//waits for the result and moves it out
+			T take()
+			{
+				wait();
+				rethrow_if_error();
+				return std::move(value());
+			}
+
+			~future_state()
+			{
+				if(has_value())
+				{
+					value().~T();
+				}
+			}
+		};
+
+		template<>
+		class future_state<void>:public state_base {
+		public:
+			using state_base::state_base;
+
+			void set_value()
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				check_unsatisfied();
+				complete(lock);
+			}
+
+			void take()
+			{
+				wait();
+				rethrow_if_error();
+			}
+		};
+
+		//runs the continuations of a state on a pool's thread; the state is kept alive until then
+		struct continuation_job {
+			std::shared_ptr<state_base> state;
+			template<typename... Ignored>
+			void operator()(Ignored&&...) noexcept
+			{
+				state->run_continuation();
+			}
+		};
+
+		template<typename Pool>
+		void submit_to(void* pool,std::shared_ptr<state_base>&& state)
+		{
+			static_cast<Pool*>(pool)->push_back(continuation_job{std::move(state)});
+		}
+
+		template<typename Pool>
+		executor make_executor(Pool& pool) noexcept
+		{
+			return executor{&pool,&submit_to<Pool>};
+		}
+
+		template<typename T,typename Func>
+		struct then_result {
+			using type=decltype(std::declval<Func&>()(std::declval<T>()));
+		};
+
+		template<typename Func>
+		struct then_result<void,Func> {
+			using type=decltype(std::declval<Func&>()());
+		};
+
+		template<typename R>
+		struct fulfill {
+			template<typename Func,typename... V>
+			static void run(future_state<R>& next,Func& f,V&& ... v)
+			{
+				next.set_value(f(std::forward<V>(v)...));
+			}
+		};
+
+		template<>
+		struct fulfill<void> {
+			template<typename Func,typename... V>
+			static void run(future_state<void>& next,Func& f,V&& ... v)
+			{
+				f(std::forward<V>(v)...);
+				next.set_value();
+			}
+		};
+
+		template<typename T>
+		struct forward_result {
+			template<typename R,typename Func>
+			static void run(future_state<T>& self,future_state<R>& next,Func& f)
+			{
+				fulfill<R>::run(next,f,self.take());
+			}
+		};
+
+		template<>
+		struct forward_result<void> {
+			template<typename R,typename Func>
+			static void run(future_state<void>& self,future_state<R>& next,Func& f)
+			{
+				self.take();
+				fulfill<R>::run(next,f);
+			}
+		};
+
+		template<typename T,typename Func,typename R>
+		struct then_continuation {
+			Func f;
+			std::shared_ptr<future_state<R>> next;
+			void operator()(state_base& self) noexcept
+			{
+				try
+				{
+					forward_result<T>::run(static_cast<future_state<T>&>(self),*next,f);
+				}
+				catch(...)
+				{
+					next->fail(std::current_exception());
+				}
+			}
+		};
+
+		template<typename Task,typename R>
+		struct async_job {
+			Task task;
+			std::shared_ptr<future_state<R>> state;
+			template<typename... Ignored>
+			void operator()(Ignored&&...) noexcept
+			{
+				try
+				{
+					fulfill<R>::run(*state,task);
+				}
+				catch(...)
+				{
+					state->fail(std::current_exception());
+				}
+			}
+		};
+
+		struct access {
+			template<typename T>
+			static std::shared_ptr<state_base> state(pool_future<T> const& f)
+			{
+				if(!f._state)
+				{
+					throw std::future_error(std::future_errc::no_state);
+				}
+				return f._state;
+			}
+			template<typename T>
+			static pool_future<T> make_future(std::shared_ptr<future_state<T>> state) noexcept
+			{
+				return pool_future<T>(std::move(state));
+			}
+		};
+
+		template<typename Sequence>
+		struct when_all_state {
+			std::atomic<std::size_t> remaining;
+			Sequence futures;
+			std::shared_ptr<future_state<Sequence>> result;
+			void arrive()
+			{
+				if(--remaining==0)
+				{
+					result->set_value(std::move(futures));
+				}
+			}
+		};
+
+		template<typename Sequence>
+		struct when_all_hook {
+			std::shared_ptr<when_all_state<Sequence>> shared;
+			void operator()(state_base&) noexcept
+			{
+				shared->arrive();
+			}
+		};
+
+		template<typename Sequence>
+		struct when_any_state {
+			std::atomic<bool> done{false};
+			Sequence futures;
+			std::shared_ptr<future_state<when_any_result<Sequence>>> result;
+		};
+
+		template<typename Sequence>
+		struct when_any_hook {
+			std::shared_ptr<when_any_state<Sequence>> shared;
+			std::size_t index;
+			void operator()(state_base&) noexcept
+			{
+				if(!shared->done.exchange(true))
+				{
+					shared->result->set_value(when_any_result<Sequence>{index,std::move(shared->futures)});
+				}
+			}
+		};
+
+		inline executor first_executor(std::vector<std::shared_ptr<state_base>> const& states) noexcept
+		{
+			return states.empty()?executor{nullptr,nullptr}:states.front()->get_executor();
+		}
+
+		/*
+			States are collected before the futures are moved into the shared state,
+			since a ready input completes the result while the rest are still being attached to.
+		*/
+		template<typename Sequence>
+		pool_future<Sequence> when_all(Sequence&& futures,std::vector<std::shared_ptr<state_base>> const& states)
+		{
+			auto result=std::make_shared<future_state<Sequence>>(first_executor(states));
+			auto shared=std::make_shared<when_all_state<Sequence>>();
+			shared->remaining=states.size()+1;
+			shared->futures=std::move(futures);
+			shared->result=result;
+			for(auto const& state:states)
+			{
+				state->attach(continuation(when_all_hook<Sequence>{shared}),true);
+			}
+			shared->arrive();
+			return access::make_future(std::move(result));
+		}
+
+		template<typename Sequence>
+		pool_future<when_any_result<Sequence>> when_any(Sequence&& futures,std::vector<std::shared_ptr<state_base>> const& states)
+		{
+			auto result=std::make_shared<future_state<when_any_result<Sequence>>>(first_executor(states));
+			auto shared=std::make_shared<when_any_state<Sequence>>();
+			shared->futures=std::move(futures);
+			shared->result=result;
+			if(states.empty())
+			{
+				shared->done=true;
+				result->set_value(when_any_result<Sequence>{static_cast<std::size_t>(-1),std::move(shared->futures)});
+			}
+			for(std::size_t i=0;i<states.size();++i)
+			{
+				states[i]->attach(continuation(when_any_hook<Sequence>{shared,i}),true);
+			}
+			return access::make_future(std::move(result));
+		}
+	}
+
+	/*
+		Future whose continuations are scheduled on the thread pool its promise was made with.
+		Continuations that fit in EXLIB_THREAD_POOL_JOB_SIZE bytes are stored in place in the shared state.
+		Only one continuation can be attached; then() consumes the future.
+		Avoid get() and wait() on the pool's own threads, as a blocked worker cannot run the task it waits on.
+	*/
+	template<typename T>
+	class pool_future {
+		friend struct pool_future_detail::access;
+		friend class pool_promise<T>;
+		using state_type=pool_future_detail::future_state<T>;
+		std::shared_ptr<state_type> _state;
+		explicit pool_future(std::shared_ptr<state_type> state) noexcept:_state(std::move(state))
+		{}
+	public:
+		pool_future() noexcept=default;
+
+		/*
+			Whether this refers to a shared state.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD bool valid() const noexcept
+		{
+			return static_cast<bool>(_state);
+		}
+
+		/*
+			Whether the result is available. Does not block.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD bool ready() const
+		{
+			return _state->ready();
+		}
+
+		/*
+			Blocks until the result is available.
+		*/
+		void wait() const
+		{
+			_state->wait();
+		}
+
+		/*
+			Blocks until the result is available and returns it, or rethrows the stored exception.
+			Invalidates the future.
+		*/
+		T get()
+		{
+			auto state=std::move(_state);
+			return state->take();
+		}
+
+		/*
+			Schedules f to run on the pool once the result is available, with the result as argument (no argument for void).
+			Returns a future for what f returns. If this future holds an exception, f is skipped and the exception is forwarded.
+			Invalidates this future.
+		*/
+		template<typename Func>
+		auto then(Func&& f) -> pool_future<typename pool_future_detail::then_result<T,typename std::decay<Func>::type>::type>
+		{
+			using func_type=typename std::decay<Func>::type;
+			using result_type=typename pool_future_detail::then_result<T,func_type>::type;
+			using continuation_type=pool_future_detail::then_continuation<T,func_type,result_type>;
+			auto state=std::move(_state);
+			auto next=std::make_shared<pool_future_detail::future_state<result_type>>(state->get_executor());
+			state->attach(pool_future_detail::continuation(continuation_type{std::forward<Func>(f),next}),false);
+			return pool_future_detail::access::make_future(std::move(next));
+		}
+	};
+
+	/*
+		Promise for a pool_future. If destroyed without a result, the future receives a broken_promise future_error.
+	*/
+	template<typename T>
+	class pool_promise {
+		using state_type=pool_future_detail::future_state<T>;
+		std::shared_ptr<state_type> _state;
+		bool _retrieved=false;
+	public:
+		/*
+			Continuations of the future run on the thread that sets the result.
+		*/
+		pool_promise():_state(std::make_shared<state_type>(pool_future_detail::executor{nullptr,nullptr}))
+		{}
+
+		/*
+			Continuations of the future are scheduled on the given pool, which must outlive the promise and its futures.
+		*/
+		template<typename Pool>
+		explicit pool_promise(Pool& pool):_state(std::make_shared<state_type>(pool_future_detail::make_executor(pool)))
+		{}
+
+		pool_promise(pool_promise&&) noexcept=default;
+
+		pool_promise& operator=(pool_promise&& o) noexcept
+		{
+			abandon();
+			_state=std::move(o._state);
+			_retrieved=o._retrieved;
+			return *this;
+		}
+
+		~pool_promise() noexcept
+		{
+			abandon();
+		}
+
+		/*
+			Returns the future for this promise. Can only be called once.
+		*/
+		pool_future<T> get_future()
+		{
+			if(_retrieved)
+			{
+				throw std::future_error(std::future_errc::future_already_retrieved);
+			}
+			_retrieved=true;
+			return pool_future<T>(_state);
+		}
+
+		template<typename... U>
+		void set_value(U&& ... value)
+		{
+			_state->set_value(std::forward<U>(value)...);
+		}
+
+		void set_exception(std::exception_ptr e)
+		{
+			_state->set_exception(std::move(e));
+		}
+	private:
+		void abandon() noexcept
+		{
+			if(_state)
+			{
+				_state->fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+				_state.reset();
+			}
+		}
+	};
+
+	/*
+		Runs task() on the pool and returns a pool_future for its result.
+	*/
+	template<typename Pool,typename Task>
+	_EXLIB_THREAD_POOL_NODISCARD auto pool_async(Pool& pool,Task&& task) -> pool_future<decltype(std::declval<typename std::decay<Task>::type&>()())>
+	{
+		using result_type=decltype(std::declval<typename std::decay<Task>::type&>()());
+		auto state=std::make_shared<pool_future_detail::future_state<result_type>>(pool_future_detail::make_executor(pool));
+		pool.push_back(pool_future_detail::async_job<typename std::decay<Task>::type,result_type>{std::forward<Task>(task),state});
+		return pool_future_detail::access::make_future(std::move(state));
+	}
+
+	/*
+		Returns a future that becomes ready with the given futures once all of them are ready.
+		Its continuations run on the pool of the first future.
+	*/
+	template<typename... T>
+	_EXLIB_THREAD_POOL_NODISCARD pool_future<std::tuple<pool_future<T>...>> when_all(pool_future<T>... futures)
+	{
+		std::vector<std::shared_ptr<pool_future_detail::state_base>> states{pool_future_detail::access::state(futures)...};
+		return pool_future_detail::when_all(std::make_tuple(std::move(futures)...),states);
+	}
+
+	template<typename Iter>
+	_EXLIB_THREAD_POOL_NODISCARD auto when_all(Iter begin,Iter end) -> pool_future<std::vector<typename std::iterator_traits<Iter>::value_type>>
+	{
+		std::vector<typename std::iterator_traits<Iter>::value_type> futures;
+		std::vector<std::shared_ptr<pool_future_detail::state_base>> states;
+		for(;begin!=end;++begin)
+		{
+			states.push_back(pool_future_detail::access::state(*begin));
+			futures.push_back(std::move(*begin));
+		}
+		return pool_future_detail::when_all(std::move(futures),states);
+	}
+
+	/*
+		Returns a future that becomes ready with the given futures once any of them is ready.
+		Its continuations run on the pool of the first future.
+	*/
+	template<typename... T>
+	_EXLIB_THREAD_POOL_NODISCARD pool_future<when_any_result<std::tuple<pool_future<T>...>>> when_any(pool_future<T>... futures)
+	{
+		std::vector<std::shared_ptr<pool_future_detail::state_base>> states{pool_future_detail::access::state(futures)...};
+		return pool_future_detail::when_any(std::make_tuple(std::move(futures)...),states);
+	}
+
+	template<typename Iter>
+	_EXLIB_THREAD_POOL_NODISCARD auto when_any(Iter begin,Iter end) -> pool_future<when_any_result<std::vector<typename std::iterator_traits<Iter>::value_type>>>
+	{
+		std::vector<typename std::iterator_traits<Iter>::value_type> futures;
+		std::vector<std::shared_ptr<pool_future_detail::state_base>> states;
+		for(;begin!=end;++begin)
+		{
+			states.push_back(pool_future_detail::access::state(*begin));
+			futures.push_back(std::move(*begin));
+		}
+		return pool_future_detail::when_any(std::move(futures),states);
+	}
+}
+#endif
@@ -0,0 +1,320 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXLIB_POOL_TASK_H
+#define EXLIB_POOL_TASK_H
+#include "thread_pool.h"
+#if !_EXLIB_THREAD_POOL_HAS_COROUTINES
+#error "pool_task.h requires C++20 coroutines"
+#endif
+#include <coroutine>
+#include <optional>
+#include <utility>
+namespace exlib {
+
+	template<typename T=void>
+	class task;
+
+	namespace pool_task_detail {
+
+		//transfers control to the awaiting coroutine, if any, without growing the stack
+		struct final_awaiter {
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+			template<typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+			{
+				auto const continuation=finished.promise().continuation;
+				if(continuation)
+				{
+					return continuation;
+				}
+				return std::noop_coroutine();
+			}
+			void await_resume() const noexcept
+			{}
+		};
+
+		class promise_base {
+		public:
+			std::suspend_always initial_suspend() const noexcept
+			{
+				return {};
+			}
+			final_awaiter final_suspend() const noexcept
+			{
+				return {};
+			}
+			void unhandled_exception() noexcept
+			{
+				_error=std::current_exception();
+			}
+			std::coroutine_handle<> continuation;
+		protected:
+			void rethrow_if_error() const
+			{
+				if(_error)
+				{
+					std::rethrow_exception(_error);
+				}
+			}
+		private:
+			std::exception_ptr _error;
+		};
+
+		template<typename T>
+		class task_promise:public promise_base {
+			std::optional<T> _value;
+		public:
+			task<T> get_return_object() noexcept;
+			template<typename U=T>
+			void return_value(U&& value)
+			{
+				_value.emplace(std::forward<U>(value));
+			}
+			T result()
+			{
+				rethrow_if_error();
+				return std::move(*_value);
+			}
+		};
+
+		template<>
+		class task_promise<void>:public promise_base {
+		public:
+			task<void> get_return_object() noexcept;
+			void return_void() const noexcept
+			{}
+			void result() const
+			{
+				rethrow_if_error();
+			}
+		};
+
+		class sync_wait_event {
+			std::mutex _mtx;
+			std::condition_variable _cv;
+			bool _done=false;
+		public:
+			//notifies under the lock, as the waiter destroys the event as soon as it sees _done
+			void set() noexcept
+			{
+				std::lock_guard<std::mutex> lock{_mtx};
+				_done=true;
+				_cv.notify_all();
+			}
+			void wait()
+			{
+				std::unique_lock<std::mutex> lock{_mtx};
+				_cv.wait(lock,[this]
+					{
+						return _done;
+					});
+			}
+		};
+
+		//coroutine that awaits a task and signals an event from a plain function
+		class sync_wait_runner {
+		public:
+			struct promise_type {
+				sync_wait_event* event=nullptr;
+				sync_wait_runner get_return_object() noexcept
+				{
+					return sync_wait_runner{std::coroutine_handle<promise_type>::from_promise(*this)};
+				}
+				std::suspend_always initial_suspend() const noexcept
+				{
+					return {};
+				}
+				auto final_suspend() const noexcept
+				{
+					struct notifier {
+						bool await_ready() const noexcept
+						{
+							return false;
+						}
+						void await_suspend(std::coroutine_handle<promise_type> finished) const noexcept
+						{
+							finished.promise().event->set();
+						}
+						void await_resume() const noexcept
+						{}
+					};
+					return notifier{};
+				}
+				void return_void() const noexcept
+				{}
+				void unhandled_exception() const noexcept
+				{
+					std::terminate();
+				}
+			};
+			sync_wait_runner(sync_wait_runner const&)=delete;
+			sync_wait_runner& operator=(sync_wait_runner const&)=delete;
+			~sync_wait_runner()
+			{
+				_handle.destroy();
+			}
+			void start(sync_wait_event& event)
+			{
+				_handle.promise().event=&event;
+				_handle.resume();
+			}
+		private:
+			explicit sync_wait_runner(std::coroutine_handle<promise_type> handle) noexcept:_handle(handle)
+			{}
+			std::coroutine_handle<promise_type> _handle;
+		};
+
+		template<typename Task>
+		sync_wait_runner wait_until_ready(Task& t)
+		{
+			co_await t.when_ready();
+		}
+	}
+
+	/*
+		A lazily started coroutine producing a T. It runs when co_awaited, on the awaiting thread,
+		until it suspends; co_await pool.schedule() moves it onto a thread_pool_a.
+		Finishing resumes the awaiting coroutine by symmetric transfer, so long co_await chains
+		that complete synchronously do not grow the stack.
+		A task can only be awaited once.
+	*/
+	template<typename T>
+	class task {
+	public:
+		using promise_type=pool_task_detail::task_promise<T>;
+	private:
+		using handle_type=std::coroutine_handle<promise_type>;
+		friend promise_type;
+		template<typename U>
+		friend U sync_wait(task<U>);
+
+		handle_type _handle;
+
+		explicit task(handle_type handle) noexcept:_handle(handle)
+		{}
+
+		template<bool get_result>
+		class awaiter {
+			handle_type _handle;
+		public:
+			explicit awaiter(handle_type handle) noexcept:_handle(handle)
+			{}
+			bool await_ready() const noexcept
+			{
+				return !_handle||_handle.done();
+			}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				_handle.promise().continuation=awaiting;
+				return _handle;
+			}
+			decltype(auto) await_resume()
+			{
+				if constexpr(get_result)
+				{
+					return _handle.promise().result();
+				}
+			}
+		};
+	public:
+		task() noexcept=default;
+
+		task(task&& o) noexcept:_handle(std::exchange(o._handle,nullptr))
+		{}
+
+		task& operator=(task&& o) noexcept
+		{
+			if(this!=&o)
+			{
+				if(_handle)
+				{
+					_handle.destroy();
+				}
+				_handle=std::exchange(o._handle,nullptr);
+			}
+			return *this;
+		}
+
+		~task()
+		{
+			if(_handle)
+			{
+				_handle.destroy();
+			}
+		}
+
+		/*
+			Whether this refers to a coroutine.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD bool valid() const noexcept
+		{
+			return static_cast<bool>(_handle);
+		}
+
+		/*
+			Whether the coroutine has finished.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD bool ready() const noexcept
+		{
+			return !_handle||_handle.done();
+		}
+
+		/*
+			Runs the task and results in its return value, or rethrows its exception.
+		*/
+		awaiter<true> operator co_await() const noexcept
+		{
+			return awaiter<true>{_handle};
+		}
+
+		/*
+			Runs the task and resumes once it is finished, without retrieving or rethrowing the result.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD awaiter<false> when_ready() const noexcept
+		{
+			return awaiter<false>{_handle};
+		}
+	};
+
+	namespace pool_task_detail {
+		template<typename T>
+		task<T> task_promise<T>::get_return_object() noexcept
+		{
+			return task<T>{std::coroutine_handle<task_promise>::from_promise(*this)};
+		}
+
+		inline task<void> task_promise<void>::get_return_object() noexcept
+		{
+			return task<void>{std::coroutine_handle<task_promise>::from_promise(*this)};
+		}
+	}
+
+	/*
+		Runs the task and blocks the calling thread until it finishes, then returns its result or rethrows its exception.
+		Do not call from a thread of the pool the task runs on if the pool could run out of threads.
+	*/
+	template<typename T>
+	T sync_wait(task<T> t)
+	{
+		pool_task_detail::sync_wait_event event;
+		auto runner=pool_task_detail::wait_until_ready(t);
+		runner.start(event);
+		event.wait();
+		return t._handle.promise().result();
+	}
+}
+#endif
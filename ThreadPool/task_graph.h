@@ -0,0 +1,303 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXLIB_TASK_GRAPH_H
+#define EXLIB_TASK_GRAPH_H
+#include "thread_pool.h"
+#include <deque>
+#include <stdexcept>
+#include <vector>
+namespace exlib {
+
+	/*
+		A dependency graph of tasks, declared once with emplace and precede and then run any number of times on a thread_pool_a<Args...>.
+		Each node counts its unfinished predecessors atomically; the task finishing a node's last predecessor
+		pushes that node onto the pool with parent_ref::push_back, or runs it itself if it is the last node it made ready,
+		so ready nodes reach the pool without a lock of the graph's own (in work stealing mode they go to the worker's deque).
+		Running does not allocate, except that the first run after the graph is changed sorts it and stores its roots.
+		Nodes are callables taking no arguments. The first exception a node throws is rethrown by wait;
+		its successors still run. The graph must not be changed or destroyed while running.
+	*/
+	template<typename... Args>
+	class task_graph_a {
+	public:
+		using pool_type=thread_pool_a<Args...>;
+		using parent_ref=typename pool_type::parent_ref;
+		using node_id=std::size_t;
+	private:
+		//calls the node's callable, recording what it throws in the graph
+		template<typename Func>
+		struct guarded_work {
+			Func f;
+			void operator()(task_graph_a& graph) noexcept
+			{
+				try
+				{
+					f();
+				}
+				catch(...)
+				{
+					graph.fail(std::current_exception());
+				}
+			}
+		};
+
+		struct node {
+			thread_pool_detail::small_task<void(task_graph_a&),EXLIB_THREAD_POOL_JOB_SIZE> work;
+			std::vector<node*> successors;
+			std::size_t predecessors=0;
+			std::atomic<std::size_t> pending{0};
+			template<typename Func>
+			explicit node(Func&& f):work(guarded_work<typename std::decay<Func>::type>{std::forward<Func>(f)})
+			{}
+		};
+
+		//the pool task running a node, and then any successor it alone made ready
+		struct runner {
+			task_graph_a* graph;
+			node* target;
+			template<typename... Input>
+			void operator()(parent_ref parent,Input const&...) noexcept
+			{
+				auto current=target;
+				while(true)
+				{
+					current->work(*graph);
+					node* next=nullptr;
+					for(auto const successor:current->successors)
+					{
+						if(successor->pending.fetch_sub(1,std::memory_order_acq_rel)==1)
+						{
+							if(next)
+							{
+								parent.push_back(runner{graph,next});
+							}
+							next=successor;
+						}
+					}
+					//the graph may be destroyed as soon as the last node finishes
+					graph->finish_node();
+					if(!next)
+					{
+						return;
+					}
+					current=next;
+				}
+			}
+		};
+
+		std::deque<node> _nodes;
+		std::vector<runner> _roots;
+		bool _sorted=true;
+		std::atomic<std::size_t> _remaining{0};
+		std::mutex mutable _mtx;
+		std::condition_variable _done_cv;
+		bool _done=true;
+		std::exception_ptr _error;
+
+		void fail(std::exception_ptr e) noexcept
+		{
+			std::lock_guard<std::mutex> lock{_mtx};
+			if(!_error)
+			{
+				_error=std::move(e);
+			}
+		}
+
+		void finish_node() noexcept
+		{
+			if(_remaining.fetch_sub(1,std::memory_order_acq_rel)==1)
+			{
+				//notifies under the lock, as the waiter may destroy the graph as soon as it sees _done
+				std::lock_guard<std::mutex> lock{_mtx};
+				_done=true;
+				_done_cv.notify_all();
+			}
+		}
+
+		//finds the roots, and checks for cycles by sorting topologically
+		void sort()
+		{
+			if(_sorted)
+			{
+				return;
+			}
+			_roots.clear();
+			std::vector<node*> order;
+			order.reserve(_nodes.size());
+			for(auto& n:_nodes)
+			{
+				n.pending.store(n.predecessors,std::memory_order_relaxed);
+				if(n.predecessors==0)
+				{
+					_roots.push_back(runner{this,&n});
+					order.push_back(&n);
+				}
+			}
+			for(std::size_t i=0;i<order.size();++i)
+			{
+				for(auto const successor:order[i]->successors)
+				{
+					if(successor->pending.fetch_sub(1,std::memory_order_relaxed)==1)
+					{
+						order.push_back(successor);
+					}
+				}
+			}
+			if(order.size()!=_nodes.size())
+			{
+				_roots.clear();
+				throw std::logic_error("task_graph has a cycle");
+			}
+			_sorted=true;
+		}
+
+		template<typename Submitter>
+		void start(Submitter& submitter)
+		{
+			{
+				std::lock_guard<std::mutex> lock{_mtx};
+				assert(_done&&"task_graph is already running");
+				sort();
+				if(_nodes.empty())
+				{
+					return;
+				}
+				_done=false;
+				_error=nullptr;
+			}
+			for(auto& n:_nodes)
+			{
+				n.pending.store(n.predecessors,std::memory_order_relaxed);
+			}
+			_remaining.store(_nodes.size(),std::memory_order_relaxed);
+			//pushing releases the stores above to the workers
+			submitter.append(_roots.begin(),_roots.end());
+		}
+	public:
+		task_graph_a()=default;
+		task_graph_a(task_graph_a const&)=delete;
+		task_graph_a& operator=(task_graph_a const&)=delete;
+
+		/*
+			Waits for a run in progress to finish.
+		*/
+		~task_graph_a()
+		{
+			std::unique_lock<std::mutex> lock{_mtx};
+			_done_cv.wait(lock,[this]
+				{
+					return _done;
+				});
+		}
+
+		/*
+			Adds a node that calls f, and returns its id.
+		*/
+		template<typename Func>
+		node_id emplace(Func&& f)
+		{
+			_nodes.emplace_back(std::forward<Func>(f));
+			_sorted=false;
+			return _nodes.size()-1;
+		}
+
+		/*
+			Makes after wait for before to finish.
+		*/
+		void precede(node_id before,node_id after)
+		{
+			assert(before<_nodes.size()&&after<_nodes.size());
+			_nodes[before].successors.push_back(&_nodes[after]);
+			++_nodes[after].predecessors;
+			_sorted=false;
+		}
+
+		/*
+			Removes all nodes.
+		*/
+		void clear() noexcept
+		{
+			_nodes.clear();
+			_roots.clear();
+			_sorted=true;
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD std::size_t size() const noexcept
+		{
+			return _nodes.size();
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD bool empty() const noexcept
+		{
+			return _nodes.empty();
+		}
+
+		/*
+			Starts running the graph on pool and returns immediately. Throws std::logic_error if the graph has a cycle.
+		*/
+		void run(pool_type& pool)
+		{
+			start(pool);
+		}
+
+		/*
+			Starts running the graph on the pool of a running task and returns immediately.
+			Throws std::logic_error if the graph has a cycle.
+		*/
+		void run(parent_ref parent)
+		{
+			start(parent);
+		}
+
+		/*
+			Whether the last run has finished.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD bool done() const
+		{
+			std::lock_guard<std::mutex> lock{_mtx};
+			return _done;
+		}
+
+		/*
+			Waits for the last run to finish, then rethrows the first exception a node threw, if any.
+			Blocks the calling thread, so calling it from a task can starve the pool.
+		*/
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock{_mtx};
+			_done_cv.wait(lock,[this]
+				{
+					return _done;
+				});
+			if(_error)
+			{
+				auto error=std::move(_error);
+				_error=nullptr;
+				std::rethrow_exception(error);
+			}
+		}
+
+		/*
+			Runs the graph on pool and waits for it to finish.
+		*/
+		void run_and_wait(pool_type& pool)
+		{
+			run(pool);
+			wait();
+		}
+	};
+
+	using task_graph=task_graph_a<>;
+}
+#endif
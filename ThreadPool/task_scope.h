@@ -0,0 +1,287 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXLIB_TASK_SCOPE_H
+#define EXLIB_TASK_SCOPE_H
+#include "thread_pool.h"
+namespace exlib {
+
+	namespace task_scope_detail {
+		struct cancellation_state {
+			std::atomic<bool> flag{false};
+			cancellation_state const* parent;
+			explicit cancellation_state(cancellation_state const* p) noexcept:parent(p)
+			{}
+			bool cancelled() const noexcept
+			{
+				for(auto state=this;state;state=state->parent)
+				{
+					if(state->flag.load(std::memory_order_acquire))
+					{
+						return true;
+					}
+				}
+				return false;
+			}
+		};
+	}
+
+	/*
+		Tells whether some work was cancelled, for tasks to check as they go. Cheap to copy.
+		Only valid while the cancellation_source or task_scope it came from exists; a default constructed token is never cancelled.
+	*/
+	class cancellation_token {
+		task_scope_detail::cancellation_state const* _state=nullptr;
+		friend class cancellation_source;
+		explicit cancellation_token(task_scope_detail::cancellation_state const* state) noexcept:_state(state)
+		{}
+	public:
+		cancellation_token() noexcept=default;
+
+		_EXLIB_THREAD_POOL_NODISCARD bool cancelled() const noexcept
+		{
+			return _state&&_state->cancelled();
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return cancelled();
+		}
+	};
+
+	/*
+		Cancels the tokens it hands out. If made with a parent token, it is also cancelled when the parent is.
+	*/
+	class cancellation_source {
+		task_scope_detail::cancellation_state _state;
+	public:
+		cancellation_source() noexcept:_state(nullptr)
+		{}
+		explicit cancellation_source(cancellation_token parent) noexcept:_state(parent._state)
+		{}
+		cancellation_source(cancellation_source const&)=delete;
+		cancellation_source& operator=(cancellation_source const&)=delete;
+
+		void cancel() noexcept
+		{
+			_state.flag.store(true,std::memory_order_release);
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD bool cancelled() const noexcept
+		{
+			return _state.cancelled();
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD cancellation_token token() const noexcept
+		{
+			return cancellation_token{&_state};
+		}
+	};
+
+	/*
+		A group of tasks on a thread_pool_a<Args...> that is waited on or cancelled as a unit, without touching the pool's other tasks.
+		Tasks are pushed onto the pool with push_back and take the same arguments as the pool's tasks, but may throw:
+		the first exception cancels the scope and is rethrown by wait.
+		Once the scope is cancelled, by cancel, an exception or its parent token, its tasks still queued are dropped without running
+		when a worker reaches them; running tasks can check token() to stop early.
+		The destructor waits for the scope's tasks, so tasks can refer to the scope and to what outlives it.
+	*/
+	template<typename... Args>
+	class task_scope_a {
+	public:
+		using pool_type=thread_pool_a<Args...>;
+		using parent_ref=typename pool_type::parent_ref;
+	private:
+		pool_type& _pool;
+		cancellation_source _source;
+		//tasks pushed and not finished
+		std::atomic<std::size_t> _pending{0};
+		std::mutex mutable _mtx;
+		std::condition_variable _done_cv;
+		std::exception_ptr _error;
+
+		template<typename Task,typename... Input>
+		static auto call(int,Task& task,parent_ref parent,Input&&... input) -> decltype(task(parent,std::forward<Input>(input)...))
+		{
+			return task(parent,std::forward<Input>(input)...);
+		}
+		template<typename Task,typename... Input>
+		static auto call(long,Task& task,parent_ref,Input&&... input) -> decltype(task(std::forward<Input>(input)...))
+		{
+			return task(std::forward<Input>(input)...);
+		}
+
+		template<typename Task>
+		struct scoped_task {
+			task_scope_a* scope;
+			Task task;
+			template<typename... Input>
+			void operator()(parent_ref parent,Input&&... input) noexcept
+			{
+				{
+					//destroyed before finishing, as the scope may be gone after
+					Task run(std::move(task));
+					if(!scope->cancelled())
+					{
+						try
+						{
+							call(0,run,parent,std::forward<Input>(input)...);
+						}
+						catch(...)
+						{
+							scope->fail(std::current_exception());
+						}
+					}
+				}
+				scope->finish();
+			}
+		};
+
+		void fail(std::exception_ptr e) noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock{_mtx};
+				if(!_error)
+				{
+					_error=std::move(e);
+				}
+			}
+			_source.cancel();
+		}
+
+		//the last task to finish decrements under the lock, so a waiter that sees no pending tasks may destroy the scope
+		void finish() noexcept
+		{
+			auto pending=_pending.load(std::memory_order_relaxed);
+			while(true)
+			{
+				if(pending==1)
+				{
+					std::lock_guard<std::mutex> lock{_mtx};
+					if(_pending.fetch_sub(1,std::memory_order_acq_rel)==1)
+					{
+						_done_cv.notify_all();
+					}
+					return;
+				}
+				if(_pending.compare_exchange_weak(pending,pending-1,std::memory_order_acq_rel,std::memory_order_relaxed))
+				{
+					return;
+				}
+			}
+		}
+
+		void wait_for_tasks()
+		{
+			std::unique_lock<std::mutex> lock{_mtx};
+			_done_cv.wait(lock,[this]
+				{
+					return _pending.load(std::memory_order_acquire)==0;
+				});
+		}
+	public:
+		explicit task_scope_a(pool_type& pool) noexcept:_pool(pool)
+		{}
+
+		/*
+			A scope that is also cancelled when parent is, such as the token of an enclosing scope.
+		*/
+		task_scope_a(pool_type& pool,cancellation_token parent) noexcept:_pool(pool),_source(parent)
+		{}
+
+		task_scope_a(task_scope_a const&)=delete;
+		task_scope_a& operator=(task_scope_a const&)=delete;
+
+		/*
+			Waits for the scope's tasks, discarding any exception.
+		*/
+		~task_scope_a()
+		{
+			wait_for_tasks();
+		}
+
+		/*
+			Pushes task(s) onto the pool as part of this scope. Safe to call from the scope's own tasks.
+		*/
+		template<typename Task>
+		void push_back(Task&& task)
+		{
+			using stored=scoped_task<typename std::decay<Task>::type>;
+			_pending.fetch_add(1,std::memory_order_relaxed);
+			try
+			{
+				_pool.push_back(stored{this,std::forward<Task>(task)});
+			}
+			catch(...)
+			{
+				finish();
+				throw;
+			}
+		}
+
+		template<typename FirstTask,typename SecondTask,typename... Rest>
+		void push_back(FirstTask&& first,SecondTask&& second,Rest&&... rest)
+		{
+			push_back(std::forward<FirstTask>(first));
+			push_back(std::forward<SecondTask>(second),std::forward<Rest>(rest)...);
+		}
+
+		/*
+			Drops the scope's queued tasks as workers reach them, and cancels token().
+		*/
+		void cancel() noexcept
+		{
+			_source.cancel();
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD bool cancelled() const noexcept
+		{
+			return _source.cancelled();
+		}
+
+		/*
+			A token cancelled along with the scope, for running tasks to check or to parent nested scopes.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD cancellation_token token() const noexcept
+		{
+			return _source.token();
+		}
+
+		/*
+			The number of the scope's tasks that have not finished, including dropped tasks not yet reached.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD std::size_t pending() const noexcept
+		{
+			return _pending.load(std::memory_order_relaxed);
+		}
+
+		/*
+			Waits for the scope's tasks to finish or be dropped, then rethrows the first exception one threw, if any.
+			Blocks the calling thread, so calling it from a task can starve the pool.
+		*/
+		void wait()
+		{
+			wait_for_tasks();
+			std::lock_guard<std::mutex> lock{_mtx};
+			if(_error)
+			{
+				auto error=std::move(_error);
+				_error=nullptr;
+				std::rethrow_exception(error);
+			}
+		}
+	};
+
+	using task_scope=task_scope_a<>;
+}
+#endif
@@ -19,11 +19,43 @@ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 #include <mutex>
 #include <tuple>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <type_traits>
 #include <thread>
 #include <assert.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <exception>
+#include <iterator>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <array>
+#include <limits>
+#if defined(__linux__)
+#include <sched.h>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#define _EXLIB_THREAD_POOL_UNDEF_NOMINMAX
+#endif
+#include <Windows.h>
+#ifdef _EXLIB_THREAD_POOL_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef _EXLIB_THREAD_POOL_UNDEF_NOMINMAX
+#endif
+#endif
 #ifdef _MSVC_LANG
 #define _EXLIB_THREAD_POOL_HAS_CPP_20 (_MSVC_LANG>=202000L)
 #define _EXLIB_THREAD_POOL_HAS_CPP_17 (_MSVC_LANG>=201700L)
@@ -38,7 +70,17 @@ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 #else
 #define _EXLIB_THREAD_POOL_NODISCARD 
 #endif
+#if _EXLIB_THREAD_POOL_HAS_CPP_20&&defined(__cpp_impl_coroutine)
+#define _EXLIB_THREAD_POOL_HAS_COROUTINES 1
+#include <coroutine>
+#else
+#define _EXLIB_THREAD_POOL_HAS_COROUTINES 0
+#endif
 #include <future>
+#ifdef EXLIB_THREAD_POOL_MPMC
+#include "../Utils/exmpmc.h"
+#endif
+#include "timer_wheel.h"
 namespace exlib {
 
 	namespace thread_pool_detail {
@@ -154,13 +196,15 @@ namespace exlib {
 #endif
 
 #if _EXLIB_THREAD_POOL_HAS_CPP_20
-		template<typename T>
 		using std::remove_cvref_t;
 #else
 		template<typename T>
 		using remove_cvref_t=typename std::remove_cv<typename std::remove_reference<T>::type>::type;
 #endif
 
+		//used to keep data written by different workers off of the same cache line
+		constexpr std::size_t cache_line_size=64;
+
 		class joining_thread:public std::thread {
 		public:
 			using std::thread::thread;
@@ -176,6 +220,551 @@ namespace exlib {
 			}
 		};
 
+#ifndef EXLIB_THREAD_POOL_JOB_SIZE
+#define EXLIB_THREAD_POOL_JOB_SIZE 64
+#endif
+
+		constexpr std::size_t job_alignment=alignof(std::max_align_t);
+
+		/*
+			A move-only type-erased noexcept callable stored in place when it fits in Size bytes (vtable pointer included),
+			similar to unique_function with an object_size_tag. Callables that do not fit are heap allocated.
+			Callables that are trivially copyable, or heap allocated, are relocated with memcpy.
+		*/
+		template<typename Signature,std::size_t Size>
+		class small_task;
+
+		template<typename... Params,std::size_t Size>
+		class small_task<void(Params...),Size> {
+		public:
+			static constexpr std::size_t buffer_size=Size-(sizeof(void*)>job_alignment?sizeof(void*):job_alignment);
+
+			template<typename Func>
+			struct fits:std::integral_constant<bool,
+				(sizeof(Func)<=buffer_size)&&(alignof(Func)<=job_alignment)&&std::is_nothrow_move_constructible<Func>::value> {};
+		private:
+			struct vtable {
+				void(*invoke)(void*,Params...);
+				//nullptr if the buffer can be memcpy'd
+				void(*relocate)(void*,void*);
+				//nullptr if trivially destructible
+				void(*destroy)(void*);
+			};
+
+			template<typename Func,bool in_place=fits<Func>::value>
+			struct impl {
+				static void invoke(void* data,Params... params)
+				{
+					(*static_cast<Func*>(data))(std::forward<Params>(params)...);
+				}
+				static void relocate(void* dst,void* src)
+				{
+					auto& from=*static_cast<Func*>(src);
+					new (dst) Func(std::move(from));
+					from.~Func();
+				}
+				static void destroy(void* data)
+				{
+					static_cast<Func*>(data)->~Func();
+				}
+				template<typename F>
+				static void construct(void* data,F&& f)
+				{
+					new (data) Func(std::forward<F>(f));
+				}
+				static vtable const* get_vtable() noexcept
+				{
+					static constexpr vtable table{&invoke,
+						std::is_trivially_copyable<Func>::value?nullptr:&relocate,
+						std::is_trivially_destructible<Func>::value?nullptr:&destroy};
+					return &table;
+				}
+			};
+
+			template<typename Func>
+			struct impl<Func,false> {
+				static void invoke(void* data,Params... params)
+				{
+					(**static_cast<Func**>(data))(std::forward<Params>(params)...);
+				}
+				static void destroy(void* data)
+				{
+					delete *static_cast<Func**>(data);
+				}
+				template<typename F>
+				static void construct(void* data,F&& f)
+				{
+					*static_cast<Func**>(data)=new Func(std::forward<F>(f));
+				}
+				static vtable const* get_vtable() noexcept
+				{
+					static constexpr vtable table{&invoke,nullptr,&destroy};
+					return &table;
+				}
+			};
+
+			vtable const* _vtable;
+			typename std::aligned_storage<buffer_size,job_alignment>::type _buffer;
+
+			void take(small_task& o) noexcept
+			{
+				_vtable=o._vtable;
+				if(_vtable)
+				{
+					if(_vtable->relocate)
+					{
+						_vtable->relocate(&_buffer,&o._buffer);
+					}
+					else
+					{
+						std::memcpy(&_buffer,&o._buffer,buffer_size);
+					}
+					o._vtable=nullptr;
+				}
+			}
+		public:
+			small_task() noexcept:_vtable(nullptr)
+			{}
+
+			template<typename Func,typename Decayed=typename std::decay<Func>::type,typename=typename std::enable_if<!std::is_same<Decayed,small_task>::value>::type>
+			small_task(Func&& f):_vtable(impl<Decayed>::get_vtable())
+			{
+				impl<Decayed>::construct(&_buffer,std::forward<Func>(f));
+			}
+
+			small_task(small_task&& o) noexcept
+			{
+				take(o);
+			}
+
+			small_task& operator=(small_task&& o) noexcept
+			{
+				if(this!=&o)
+				{
+					reset();
+					take(o);
+				}
+				return *this;
+			}
+
+			void reset() noexcept
+			{
+				if(_vtable)
+				{
+					if(_vtable->destroy)
+					{
+						_vtable->destroy(&_buffer);
+					}
+					_vtable=nullptr;
+				}
+			}
+
+			~small_task() noexcept
+			{
+				reset();
+			}
+
+			explicit operator bool() const noexcept
+			{
+				return _vtable!=nullptr;
+			}
+
+			void operator()(Params... params) noexcept
+			{
+				assert(_vtable);
+				_vtable->invoke(&_buffer,std::forward<Params>(params)...);
+			}
+		};
+
+		/*
+			A double ended queue in a circular buffer that only grows, so that once it has reached
+			its high water mark pushing and popping do not allocate.
+		*/
+		template<typename T>
+		class job_ring {
+			T* _data;
+			//capacity is always 0 or a power of 2
+			std::size_t _capacity;
+			std::size_t _head;
+			std::size_t _size;
+
+			T* slot(std::size_t i) const noexcept
+			{
+				return _data+((_head+i)&(_capacity-1));
+			}
+
+			void grow(std::size_t min_capacity)
+			{
+				std::size_t new_capacity=_capacity?_capacity:16;
+				while(new_capacity<min_capacity)
+				{
+					new_capacity*=2;
+				}
+				auto const new_data=static_cast<T*>(::operator new(new_capacity*sizeof(T)));
+				for(std::size_t i=0;i<_size;++i)
+				{
+					auto const old=slot(i);
+					new (new_data+i) T(std::move(*old));
+					old->~T();
+				}
+				::operator delete(_data);
+				_data=new_data;
+				_capacity=new_capacity;
+				_head=0;
+			}
+		public:
+			job_ring() noexcept:_data(nullptr),_capacity(0),_head(0),_size(0)
+			{}
+			job_ring(job_ring&& o) noexcept:_data(o._data),_capacity(o._capacity),_head(o._head),_size(o._size)
+			{
+				o._data=nullptr;
+				o._capacity=0;
+				o._head=0;
+				o._size=0;
+			}
+			job_ring(job_ring const&)=delete;
+			job_ring& operator=(job_ring const&)=delete;
+			~job_ring() noexcept
+			{
+				clear();
+				::operator delete(_data);
+			}
+			std::size_t size() const noexcept
+			{
+				return _size;
+			}
+			bool empty() const noexcept
+			{
+				return _size==0;
+			}
+			std::size_t capacity() const noexcept
+			{
+				return _capacity;
+			}
+			void reserve(std::size_t n)
+			{
+				if(n>_capacity)
+				{
+					grow(n);
+				}
+			}
+			T& front() noexcept
+			{
+				return *slot(0);
+			}
+			T& back() noexcept
+			{
+				return *slot(_size-1);
+			}
+			void push_back(T&& val)
+			{
+				reserve(_size+1);
+				new (slot(_size)) T(std::move(val));
+				++_size;
+			}
+			void push_front(T&& val)
+			{
+				reserve(_size+1);
+				_head=(_head-1)&(_capacity-1);
+				new (slot(0)) T(std::move(val));
+				++_size;
+			}
+			T pop_front() noexcept
+			{
+				auto const first=slot(0);
+				T ret(std::move(*first));
+				first->~T();
+				_head=(_head+1)&(_capacity-1);
+				--_size;
+				return ret;
+			}
+			T pop_back() noexcept
+			{
+				auto const last=slot(_size-1);
+				T ret(std::move(*last));
+				last->~T();
+				--_size;
+				return ret;
+			}
+			//moves up to n elements from the front of this to the back of other
+			std::size_t move_front_to(job_ring& other,std::size_t n)
+			{
+				n=std::min(n,_size);
+				other.reserve(other._size+n);
+				for(std::size_t i=0;i<n;++i)
+				{
+					other.push_back(pop_front());
+				}
+				return n;
+			}
+			void clear() noexcept
+			{
+				for(std::size_t i=0;i<_size;++i)
+				{
+					slot(i)->~T();
+				}
+				_head=0;
+				_size=0;
+			}
+		};
+
+		//consecutive times a non-empty lane can be passed over before it is served ahead of higher lanes
+		constexpr std::size_t default_aging_limit=16;
+
+		/*
+			The shared queue of a thread pool, split into priority lanes, lane 0 being the highest.
+			Each lane has a FIFO of jobs, and a heap of jobs with deadlines that run earliest deadline first, ahead of the FIFO.
+			A job is taken from the highest non-empty lane, except that a lane passed over aging_limit times in a row
+			is served next, so lower lanes always make progress.
+			The lowest lane's FIFO holds bulk work; everything else counts as urgent.
+		*/
+		template<typename T>
+		class job_lanes {
+		public:
+			using clock=std::chrono::steady_clock;
+		private:
+			struct deadline_job {
+				clock::time_point deadline;
+				std::uint64_t sequence;
+				T job;
+			};
+			struct later {
+				bool operator()(deadline_job const& a,deadline_job const& b) const noexcept
+				{
+					return a.deadline>b.deadline||(a.deadline==b.deadline&&a.sequence>b.sequence);
+				}
+			};
+			struct lane {
+				job_ring<T> fifo;
+				std::vector<deadline_job> deadlines;
+				std::size_t passed_over=0;
+				std::size_t size() const noexcept
+				{
+					return fifo.size()+deadlines.size();
+				}
+			};
+			std::vector<lane> _lanes;
+			std::size_t _size=0;
+			std::size_t _aging_limit=default_aging_limit;
+			std::uint64_t _sequence=0;
+			//read without the pool's lock by workers deciding whether to look at the shared queue first
+			std::atomic<std::size_t> _urgent{0};
+
+			void update_urgent() noexcept
+			{
+				_urgent.store(_size-_lanes.back().fifo.size(),std::memory_order_relaxed);
+			}
+			T pop_from(lane& from)
+			{
+				--_size;
+				from.passed_over=0;
+				if(from.deadlines.empty())
+				{
+					return from.fifo.pop_front();
+				}
+				std::pop_heap(from.deadlines.begin(),from.deadlines.end(),later{});
+				T ret(std::move(from.deadlines.back().job));
+				from.deadlines.pop_back();
+				return ret;
+			}
+		public:
+			job_lanes():_lanes(1)
+			{}
+
+			std::size_t size() const noexcept
+			{
+				return _size;
+			}
+			bool empty() const noexcept
+			{
+				return _size==0;
+			}
+			std::size_t urgent() const noexcept
+			{
+				return _urgent.load(std::memory_order_relaxed);
+			}
+			std::size_t lane_count() const noexcept
+			{
+				return _lanes.size();
+			}
+			/*
+				Changes the number of lanes. Jobs in lanes that no longer exist move to the new lowest lane, keeping their order.
+			*/
+			void lane_count(std::size_t count)
+			{
+				assert(count!=0);
+				while(_lanes.size()>count)
+				{
+					auto& from=_lanes.back();
+					auto& to=_lanes[_lanes.size()-2];
+					from.fifo.move_front_to(to.fifo,from.fifo.size());
+					for(auto& entry:from.deadlines)
+					{
+						to.deadlines.push_back(std::move(entry));
+						std::push_heap(to.deadlines.begin(),to.deadlines.end(),later{});
+					}
+					_lanes.pop_back();
+				}
+				_lanes.resize(count);
+				update_urgent();
+			}
+			std::size_t aging_limit() const noexcept
+			{
+				return _aging_limit;
+			}
+			//a limit of 0 would serve lower lanes ahead of higher ones, so it is raised to 1
+			void aging_limit(std::size_t limit) noexcept
+			{
+				_aging_limit=limit==0?1:limit;
+			}
+			//reserves room in the lowest lane
+			void reserve(std::size_t count)
+			{
+				_lanes.back().fifo.reserve(count);
+			}
+			void push_back(T&& job)
+			{
+				_lanes.back().fifo.push_back(std::move(job));
+				++_size;
+			}
+			void push_back(std::size_t lane,T&& job)
+			{
+				_lanes[std::min(lane,_lanes.size()-1)].fifo.push_back(std::move(job));
+				++_size;
+				update_urgent();
+			}
+			void push_front(T&& job)
+			{
+				_lanes.front().fifo.push_front(std::move(job));
+				++_size;
+				update_urgent();
+			}
+			void push_deadline(std::size_t lane,clock::time_point deadline,T&& job)
+			{
+				auto& deadlines=_lanes[std::min(lane,_lanes.size()-1)].deadlines;
+				deadlines.push_back(deadline_job{deadline,_sequence++,std::move(job)});
+				std::push_heap(deadlines.begin(),deadlines.end(),later{});
+				++_size;
+				update_urgent();
+			}
+			/*
+				Takes the next job. bulk is set to whether it came from the lowest lane's FIFO.
+			*/
+			T pop_front(bool& bulk)
+			{
+				assert(!empty());
+				std::size_t highest=0;
+				while(_lanes[highest].size()==0)
+				{
+					++highest;
+				}
+				lane* chosen=&_lanes[highest];
+				for(std::size_t i=highest+1;i<_lanes.size();++i)
+				{
+					auto& other=_lanes[i];
+					if(other.size()!=0&&other.passed_over++>=_aging_limit&&chosen==&_lanes[highest])
+					{
+						chosen=&other;
+					}
+				}
+				bulk=chosen==&_lanes.back()&&chosen->deadlines.empty();
+				T ret=pop_from(*chosen);
+				update_urgent();
+				return ret;
+			}
+			T pop_front()
+			{
+				bool bulk;
+				return pop_front(bulk);
+			}
+			std::size_t bulk_size() const noexcept
+			{
+				return _lanes.back().fifo.size();
+			}
+			//moves up to n jobs from the front of the lowest lane's FIFO to other
+			std::size_t move_bulk_to(job_ring<T>& other,std::size_t n)
+			{
+				n=_lanes.back().fifo.move_front_to(other,n);
+				_size-=n;
+				return n;
+			}
+			void clear() noexcept
+			{
+				for(auto& l:_lanes)
+				{
+					l.fifo.clear();
+					l.deadlines.clear();
+					l.passed_over=0;
+				}
+				_size=0;
+				update_urgent();
+			}
+		};
+
+#ifdef __linux__
+		/*
+			Where idle workers wait for tasks, used like a condition_variable with the queue's mutex.
+			Threads sleep on a futex word that every notification increments, so a thread that read the word under the lock
+			cannot miss a notification made after it unlocked, and notify(n) wakes at most n sleepers with a single system call.
+		*/
+		class parking_lot {
+			std::atomic<std::uint32_t> _epoch{0};
+			static_assert(sizeof(std::atomic<std::uint32_t>)==sizeof(std::uint32_t),"futex word must be a plain 32 bit integer");
+
+			long futex(int op,std::uint32_t value,timespec const* timeout) noexcept
+			{
+				return syscall(SYS_futex,reinterpret_cast<std::uint32_t*>(&_epoch),op,value,timeout,nullptr,0);
+			}
+		public:
+			void wait(std::unique_lock<std::mutex>& lock)
+			{
+				auto const ticket=_epoch.load(std::memory_order_relaxed);
+				lock.unlock();
+				futex(FUTEX_WAIT_PRIVATE,ticket,nullptr);
+				lock.lock();
+			}
+			template<typename Rep,typename Period>
+			std::cv_status wait_for(std::unique_lock<std::mutex>& lock,std::chrono::duration<Rep,Period> timeout)
+			{
+				auto const ns=std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+				timespec const relative{static_cast<time_t>(ns/1000000000),static_cast<long>(ns%1000000000)};
+				auto const ticket=_epoch.load(std::memory_order_relaxed);
+				lock.unlock();
+				bool const timed_out=futex(FUTEX_WAIT_PRIVATE,ticket,&relative)!=0&&errno==ETIMEDOUT;
+				lock.lock();
+				return timed_out?std::cv_status::timeout:std::cv_status::no_timeout;
+			}
+			void notify(std::size_t count) noexcept
+			{
+				if(count!=0)
+				{
+					_epoch.fetch_add(1,std::memory_order_release);
+					futex(FUTEX_WAKE_PRIVATE,static_cast<std::uint32_t>(count<INT_MAX?count:INT_MAX),nullptr);
+				}
+			}
+			void notify_one() noexcept
+			{
+				notify(1);
+			}
+			void notify_all() noexcept
+			{
+				notify(INT_MAX);
+			}
+		};
+#else
+		//condition_variable with notify(count)
+		class parking_lot:public std::condition_variable {
+		public:
+			void notify(std::size_t count) noexcept
+			{
+				for(;count!=0;--count)
+				{
+					notify_one();
+				}
+			}
+		};
+#endif
+
 		/*
 			The base of the threadpool that does not depend on special arguments.
 		*/
@@ -259,16 +848,14 @@ namespace exlib {
 
 		protected:
 
+			/*
+				Wakes as many sleeping threads as there are new tasks, but no more than are sleeping.
+				Call after the tasks are visible to threads that lock _mtx.
+			*/
 			void notify_count(size_t count)
 			{
-				if(count==1)
-				{
-					_signal_start.notify_one();
-				}
-				else
-				{
-					_signal_start.notify_all();
-				}
+				size_t const sleeping=_sleeping;
+				_signal_start.notify(count<sleeping?count:sleeping);
 			}
 			void join_all()
 			{
@@ -290,13 +877,15 @@ namespace exlib {
 				this->_signal_start.notify_all();
 			}
 
-			thread_pool_base(size_t num_threads,bool start):_workers(num_threads),_running(start),_active(start)
+			thread_pool_base(size_t num_threads,bool start):_workers(num_threads),_sleeping(0),_running(start),_active(start)
 			{}
 			std::mutex mutable _mtx;
-			std::condition_variable _signal_start;
+			parking_lot _signal_start;
 			std::condition_variable _jobs_done;
 			std::vector<joining_thread> _workers;
 			std::atomic<std::size_t> _active_thread_count;
+			//number of threads waiting on _signal_start, only changed while holding _mtx
+			std::atomic<std::size_t> _sleeping;
 			//whether threads are running
 			std::atomic<bool> _running;
 			//whether threads are actively looking for jobs
@@ -457,12 +1046,216 @@ namespace exlib {
 			}
 		};
 
-	}
-
-	struct delay_start_t {};
-
-#if _EXLIB_THREAD_POOL_HAS_CPP_17
-	constexpr delay_start_t delay_start{};
+#if _EXLIB_THREAD_POOL_HAS_COROUTINES
+		//resumes a coroutine suspended on thread_pool_a::schedule
+		struct resume_job {
+			std::coroutine_handle<> handle;
+			template<typename... Ignored>
+			void operator()(Ignored&&...) noexcept
+			{
+				handle.resume();
+			}
+		};
+#endif
+
+		template<typename Index,bool=std::is_integral<Index>::value>
+		struct index_difference {
+			using type=Index;
+		};
+		template<typename Index>
+		struct index_difference<Index,false> {
+			using type=typename std::iterator_traits<Index>::difference_type;
+		};
+
+		/*
+			Shared state of a parallel loop over [first, first+count).
+			Participants claim chunks by advancing next; a chunk is a share of what remains, but no smaller than grain,
+			so chunks start large and shrink towards the end of the range to even out the load.
+			The loop is over once done reaches count; the first exception thrown cancels the unclaimed chunks.
+		*/
+		template<typename Index>
+		struct parallel_range {
+			using difference_type=typename index_difference<Index>::type;
+			Index first;
+			std::size_t count;
+			std::size_t grain;
+			std::size_t participants;
+			std::atomic<std::size_t> next{0};
+			std::atomic<std::size_t> done{0};
+			std::mutex mtx;
+			std::condition_variable finished;
+			std::exception_ptr error;
+
+			parallel_range(Index first,std::size_t count,std::size_t grain,std::size_t participants):
+				first(first),count(count),grain(grain),participants(participants)
+			{}
+
+			Index at(std::size_t i) const
+			{
+				return first+static_cast<difference_type>(i);
+			}
+
+			bool claim(std::size_t& begin,std::size_t& end) noexcept
+			{
+				auto current=next.load(std::memory_order_relaxed);
+				while(current<count)
+				{
+					auto const remaining=count-current;
+					auto const size=std::min(remaining,std::max(grain,remaining/(2*participants)));
+					if(next.compare_exchange_weak(current,current+size,std::memory_order_relaxed))
+					{
+						begin=current;
+						end=current+size;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void finish(std::size_t n) noexcept
+			{
+				if(n!=0&&done.fetch_add(n,std::memory_order_acq_rel)+n==count)
+				{
+					{
+						std::lock_guard<std::mutex> lock{mtx};
+					}
+					finished.notify_all();
+				}
+			}
+
+			void cancel(std::exception_ptr e) noexcept
+			{
+				{
+					std::lock_guard<std::mutex> lock{mtx};
+					if(!error)
+					{
+						error=std::move(e);
+					}
+				}
+				auto const claimed=next.exchange(count,std::memory_order_relaxed);
+				if(claimed<count)
+				{
+					finish(count-claimed);
+				}
+			}
+
+			void wait()
+			{
+				std::unique_lock<std::mutex> lock{mtx};
+				finished.wait(lock,[this]
+					{
+						return done.load(std::memory_order_acquire)==count;
+					});
+				if(error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+		};
+
+		template<typename Index,typename T>
+		struct parallel_reduce_range:parallel_range<Index> {
+			T identity;
+			T result;
+			parallel_reduce_range(Index first,std::size_t count,std::size_t grain,std::size_t participants,T const& identity):
+				parallel_range<Index>(first,count,grain,participants),identity(identity),result(identity)
+			{}
+		};
+
+		template<typename Index,typename Func>
+		void parallel_for_participate(parallel_range<Index>& range,Func& f) noexcept
+		{
+			std::size_t begin,end,processed=0;
+			while(range.claim(begin,end))
+			{
+				try
+				{
+					for(auto i=begin;i<end;++i)
+					{
+						f(range.at(i));
+					}
+				}
+				catch(...)
+				{
+					range.cancel(std::current_exception());
+				}
+				processed+=end-begin;
+			}
+			range.finish(processed);
+		}
+
+		template<typename Index,typename T,typename RangeReduce,typename Combine>
+		void parallel_reduce_participate(parallel_reduce_range<Index,T>& range,RangeReduce& range_reduce,Combine& combine) noexcept
+		{
+			std::size_t begin,end,processed=0;
+			try
+			{
+				T partial(range.identity);
+				while(range.claim(begin,end))
+				{
+					processed+=end-begin;
+					partial=range_reduce(range.at(begin),range.at(end),std::move(partial));
+				}
+				if(processed!=0)
+				{
+					std::lock_guard<std::mutex> lock{range.mtx};
+					range.result=combine(std::move(range.result),std::move(partial));
+				}
+			}
+			catch(...)
+			{
+				range.cancel(std::current_exception());
+			}
+			range.finish(processed);
+		}
+
+		//a task run by the pool's threads to help with a parallel_for; the caller outlives every claimed chunk
+		template<typename Index,typename Func>
+		struct parallel_for_helper {
+			std::shared_ptr<parallel_range<Index>> range;
+			Func* f;
+			template<typename... Ignored>
+			void operator()(Ignored&&...) noexcept
+			{
+				parallel_for_participate(*range,*f);
+			}
+		};
+
+		template<typename Index,typename T,typename RangeReduce,typename Combine>
+		struct parallel_reduce_helper {
+			std::shared_ptr<parallel_reduce_range<Index,T>> range;
+			RangeReduce* range_reduce;
+			Combine* combine;
+			template<typename... Ignored>
+			void operator()(Ignored&&...) noexcept
+			{
+				parallel_reduce_participate(*range,*range_reduce,*combine);
+			}
+		};
+
+		template<typename Index,typename T,typename Reduce,typename Transform>
+		struct transform_range_reduce {
+			Reduce* reduce;
+			Transform* transform;
+			T operator()(Index begin,Index end,T acc)
+			{
+				for(;begin!=end;++begin)
+				{
+					acc=(*reduce)(std::move(acc),(*transform)(begin));
+				}
+				return acc;
+			}
+		};
+
+	}
+
+	struct delay_start_t {};
+
+	struct work_stealing_t {};
+
+#if _EXLIB_THREAD_POOL_HAS_CPP_17
+	constexpr delay_start_t delay_start{};
+	constexpr work_stealing_t work_stealing{};
 #endif
 
 	/*
@@ -489,799 +1282,3140 @@ namespace exlib {
 		return std::forward<Func>(f)();
 	}
 
-	namespace thread_pool_impl {
+	namespace thread_pool_detail {
+
+		//parses a kernel cpu list such as "0-3,8,10-11"
+		inline std::vector<unsigned> parse_cpu_list(char const* str)
+		{
+			std::vector<unsigned> cpus;
+			while(true)
+			{
+				char* end;
+				auto const first=std::strtoul(str,&end,10);
+				if(end==str)
+				{
+					break;
+				}
+				auto last=first;
+				str=end;
+				if(*str=='-')
+				{
+					last=std::strtoul(str+1,&end,10);
+					str=end;
+				}
+				for(auto cpu=first;cpu<=last;++cpu)
+				{
+					cpus.push_back(static_cast<unsigned>(cpu));
+				}
+				if(*str!=',')
+				{
+					break;
+				}
+				++str;
+			}
+			return cpus;
+		}
+
+#if defined(__linux__)
+		inline bool read_cpu_list(char const* path,std::vector<unsigned>& cpus)
+		{
+			std::FILE* const file=std::fopen(path,"r");
+			if(!file)
+			{
+				return false;
+			}
+			char buffer[4096];
+			bool const read=std::fgets(buffer,sizeof(buffer),file)!=nullptr;
+			std::fclose(file);
+			if(read)
+			{
+				cpus=parse_cpu_list(buffer);
+			}
+			return read;
+		}
+#endif
+
 		/*
-			Thread pool where the threadpool stores the given arguments and each task is given those arguments.
-			There should only be one controlling thread.
-			No tasks added should throw.
-			Recommended using thread_pool if using a thread pool multiple times to avoid code bloat.
+			Restricts the calling thread to the given CPUs. Returns false if that is not supported or fails;
+			on Windows only the CPUs of the first processor group can be used.
 		*/
-		template<typename... Args>
-		class thread_pool_a:thread_pool_detail::thread_pool_base {
+		inline bool set_current_thread_affinity(std::vector<unsigned> const& cpus) noexcept
+		{
+#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for(auto const cpu:cpus)
+			{
+				if(cpu<CPU_SETSIZE)
+				{
+					CPU_SET(cpu,&set);
+				}
+			}
+			return sched_setaffinity(0,sizeof(set),&set)==0;
+#elif defined(_WIN32)
+			DWORD_PTR mask=0;
+			for(auto const cpu:cpus)
+			{
+				if(cpu<sizeof(DWORD_PTR)*8)
+				{
+					mask|=DWORD_PTR(1)<<cpu;
+				}
+			}
+			return mask!=0&&SetThreadAffinityMask(GetCurrentThread(),mask)!=0;
+#else
+			(void)cpus;
+			return false;
+#endif
+		}
+	}
+
+	/*
+		The CPUs of each NUMA node, read from /sys/devices/system/node on Linux or from the NUMA API on Windows (first processor group only).
+		Where those are unavailable, returns a single node with CPUs 0 to hardware_concurrency()-1.
+	*/
+	inline std::vector<std::vector<unsigned>> numa_topology()
+	{
+		std::vector<std::vector<unsigned>> nodes;
+#if defined(__linux__)
+		std::vector<unsigned> online;
+		if(thread_pool_detail::read_cpu_list("/sys/devices/system/node/online",online))
+		{
+			for(auto const node:online)
+			{
+				char path[64];
+				std::snprintf(path,sizeof(path),"/sys/devices/system/node/node%u/cpulist",node);
+				std::vector<unsigned> cpus;
+				if(thread_pool_detail::read_cpu_list(path,cpus)&&!cpus.empty())
+				{
+					nodes.push_back(std::move(cpus));
+				}
+			}
+		}
+#elif defined(_WIN32)
+		ULONG highest;
+		if(GetNumaHighestNodeNumber(&highest))
+		{
+			for(ULONG node=0;node<=highest;++node)
+			{
+				ULONGLONG mask;
+				if(GetNumaNodeProcessorMask(static_cast<UCHAR>(node),&mask)&&mask!=0)
+				{
+					std::vector<unsigned> cpus;
+					for(unsigned cpu=0;cpu<64;++cpu)
+					{
+						if((mask>>cpu)&1)
+						{
+							cpus.push_back(cpu);
+						}
+					}
+					nodes.push_back(std::move(cpus));
+				}
+			}
+		}
+#endif
+		if(nodes.empty())
+		{
+			std::vector<unsigned> cpus(hardware_concurrency_or(1));
+			for(size_t i=0;i<cpus.size();++i)
+			{
+				cpus[i]=static_cast<unsigned>(i);
+			}
+			nodes.push_back(std::move(cpus));
+		}
+		return nodes;
+	}
+
+	namespace thread_pool_detail {
+
+		constexpr std::size_t latency_bucket_count=24;
+
+		//bucket 0 holds latencies under 1us, bucket i latencies in [2^(i-1), 2^i) us, and the last bucket everything above
+		inline std::size_t latency_bucket(std::chrono::steady_clock::duration latency) noexcept
+		{
+			auto us=std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+			std::size_t bucket=0;
+			while(us>0&&bucket<latency_bucket_count-1)
+			{
+				us>>=1;
+				++bucket;
+			}
+			return bucket;
+		}
+
+		//a counter only written by one thread, so it can be read by others without read-modify-write operations
+		class worker_counter {
+			std::atomic<std::uint64_t> _value{0};
 		public:
-			static_assert(thread_pool_detail::no_rvalue_references<Args...>::value,"rvalue references not allowed as arguments");
-			static_assert(thread_pool_detail::all_nothrow_copyable<Args...>::value,"Arguments must be no-throw copyable (thread_pool_a has no exception handling mechanism).");
+			void add(std::uint64_t n) noexcept
+			{
+				_value.store(_value.load(std::memory_order_relaxed)+n,std::memory_order_relaxed);
+			}
+			std::uint64_t get() const noexcept
+			{
+				return _value.load(std::memory_order_relaxed);
+			}
+		};
 
-			friend class parent_ref;
-			/*
-				A reference to the parent that child tasks can accept. Should be passed by value.
-				Contains the methods safe to call by child threads.
-			*/
-			class parent_ref {
-				friend class thread_pool_a;
-				thread_pool_a& parent;
-				parent_ref(thread_pool_a& p) noexcept:parent(p)
-				{}
-			public:
-				/*
-					Signals threads to stop looking for tasks and will signal a waiting master thread.
-				*/
-				void stop()
+		struct worker_metrics {
+			worker_counter tasks_executed;
+			worker_counter steals;
+			worker_counter busy_ns;
+			worker_counter idle_ns;
+			worker_counter lock_wait_ns;
+			worker_counter latency[latency_bucket_count];
+			char padding[cache_line_size];
+		};
+
+		//calls a function every period on its own thread until destroyed
+		class periodic_caller {
+			std::mutex _mtx;
+			std::condition_variable _cv;
+			bool _stop=false;
+			std::thread _thread;
+		public:
+			template<typename Rep,typename Period>
+			periodic_caller(std::chrono::duration<Rep,Period> period,std::function<void()> f):
+				_thread([this,period,f]
+					{
+						std::unique_lock<std::mutex> lock{_mtx};
+						while(!_cv.wait_for(lock,period,[this]
+							{
+								return _stop;
+							}))
+						{
+							lock.unlock();
+							f();
+							lock.lock();
+						}
+					})
+			{}
+			periodic_caller(periodic_caller const&)=delete;
+			periodic_caller& operator=(periodic_caller const&)=delete;
+			~periodic_caller()
+			{
 				{
-					parent.signal_stop();
+					std::lock_guard<std::mutex> lock{_mtx};
+					_stop=true;
 				}
-				/*
-					See thread_pool_a::push_back
-				*/
-				template<typename... Tasks>
-				void push_back(Tasks&& ... tasks)
+				_cv.notify_all();
+				_thread.join();
+			}
+		};
+	}
+
+	/*
+		What one worker of a thread_pool_a has done since metrics were enabled.
+	*/
+	struct thread_pool_worker_stats {
+		std::uint64_t tasks_executed;
+		//tasks taken from another worker's deque or another NUMA node's queue
+		std::uint64_t steals;
+		//time spent running tasks
+		std::chrono::nanoseconds busy;
+		//time spent asleep waiting for tasks
+		std::chrono::nanoseconds idle;
+		//time spent waiting to lock the shared queue
+		std::chrono::nanoseconds lock_wait;
+	};
+
+	/*
+		A snapshot of a thread_pool_a, from thread_pool_a::stats().
+	*/
+	struct thread_pool_stats {
+		std::chrono::steady_clock::time_point time;
+		//tasks waiting to run
+		std::size_t queued;
+		//threads running a task
+		std::size_t active;
+		//extra workers started by elastic scaling
+		std::size_t extra_threads;
+		//empty if metrics are not enabled
+		std::vector<thread_pool_worker_stats> workers;
+		//how long tasks waited between being pushed and starting; bucket 0 counts waits under 1us, bucket i waits in [2^(i-1), 2^i) us
+		std::array<std::uint64_t,thread_pool_detail::latency_bucket_count> latency;
+
+		std::uint64_t tasks_executed() const noexcept
+		{
+			std::uint64_t total=0;
+			for(auto const& worker:workers)
+			{
+				total+=worker.tasks_executed;
+			}
+			return total;
+		}
+
+		std::uint64_t steals() const noexcept
+		{
+			std::uint64_t total=0;
+			for(auto const& worker:workers)
+			{
+				total+=worker.steals;
+			}
+			return total;
+		}
+
+		/*
+			An upper bound on the given quantile (0 to 1) of the enqueue-to-start latency, to within a factor of 2.
+			The last bucket has no upper bound, so its lower bound is returned.
+		*/
+		std::chrono::microseconds latency_quantile(double q) const noexcept
+		{
+			std::uint64_t total=0;
+			for(auto const count:latency)
+			{
+				total+=count;
+			}
+			if(total==0)
+			{
+				return std::chrono::microseconds(0);
+			}
+			auto const exact=q*static_cast<double>(total);
+			auto target=static_cast<std::uint64_t>(exact);
+			if(static_cast<double>(target)<exact||target==0)
+			{
+				++target;
+			}
+			std::uint64_t seen=0;
+			for(std::size_t i=0;i+1<latency.size();++i)
+			{
+				seen+=latency[i];
+				if(seen>=target)
 				{
-					parent.push_back(std::forward<Tasks>(tasks)...);
+					return std::chrono::microseconds(std::int64_t(1)<<i);
 				}
-				template<typename... Tasks>
-				void push_back_no_sync(Tasks&& ... tasks)
+			}
+			return std::chrono::microseconds(std::int64_t(1)<<(latency.size()-2));
+		}
+	};
+
+	/*
+		Bump allocator for scratch memory. Allocating moves a pointer through a list of chunks, deallocating does nothing,
+		and reset or rewinding to a mark frees everything allocated since at once, keeping the chunks for reuse.
+		Destructors of objects placed in it are not run. Not thread safe.
+		Each thread has one (see this_thread_arena); thread_pool_a resets a worker's after each task,
+		and tasks reach it with parent_ref::arena().
+	*/
+	class worker_arena {
+		struct chunk {
+			chunk* next;
+			std::size_t size;
+			char* data() noexcept
+			{
+				return reinterpret_cast<char*>(this+1);
+			}
+		};
+		static_assert(sizeof(chunk)%alignof(std::max_align_t)==0||alignof(std::max_align_t)%sizeof(chunk)==0,"chunk data must be aligned");
+		chunk* _head=nullptr;
+		chunk* _current=nullptr;
+		std::uintptr_t _pos=0;
+		std::uintptr_t _end=0;
+		std::size_t _chunk_size;
+
+		void enter(chunk* c) noexcept
+		{
+			_current=c;
+			_pos=reinterpret_cast<std::uintptr_t>(c->data());
+			_end=_pos+c->size;
+		}
+
+		//moves to the next chunk that fits, allocating one if there is none
+		void* allocate_slow(std::size_t size,std::size_t align)
+		{
+			auto const needed=size+align-1;
+			auto const next=_current?_current->next:_head;
+			if(next&&next->size>=needed)
+			{
+				enter(next);
+			}
+			else
+			{
+				auto const chunk_size=needed>_chunk_size?needed:_chunk_size;
+				auto const fresh=static_cast<chunk*>(::operator new(sizeof(chunk)+chunk_size));
+				fresh->size=chunk_size;
+				fresh->next=next;
+				if(_current)
+				{
+					_current->next=fresh;
+				}
+				else
+				{
+					_head=fresh;
+				}
+				enter(fresh);
+			}
+			auto const start=(_pos+align-1)&~(align-1);
+			_pos=start+size;
+			return reinterpret_cast<void*>(start);
+		}
+	public:
+		static constexpr std::size_t default_chunk_size=64*1024;
+
+		//a position to rewind to
+		struct mark {
+			chunk* current;
+			std::uintptr_t pos;
+		};
+
+		/*
+			Rewinds the arena to where it was when constructed.
+		*/
+		class scope {
+			worker_arena& _arena;
+			mark _mark;
+		public:
+			explicit scope(worker_arena& arena) noexcept:_arena(arena),_mark(arena.get_mark())
+			{}
+			scope(scope const&)=delete;
+			scope& operator=(scope const&)=delete;
+			~scope()
+			{
+				_arena.rewind(_mark);
+			}
+		};
+
+		explicit worker_arena(std::size_t chunk_size=default_chunk_size) noexcept:_chunk_size(chunk_size)
+		{}
+		worker_arena(worker_arena const&)=delete;
+		worker_arena& operator=(worker_arena const&)=delete;
+		~worker_arena()
+		{
+			release();
+		}
+
+		/*
+			Returns size bytes aligned to align, which must be a power of 2.
+		*/
+		void* allocate(std::size_t size,std::size_t align=alignof(std::max_align_t))
+		{
+			assert(align!=0&&(align&(align-1))==0);
+			auto const start=(_pos+align-1)&~(align-1);
+			if(_current&&start>=_pos&&start<=_end&&size<=_end-start)
+			{
+				_pos=start+size;
+				return reinterpret_cast<void*>(start);
+			}
+			return allocate_slow(size,align);
+		}
+
+		/*
+			Returns uninitialized storage for count Ts.
+		*/
+		template<typename T>
+		T* allocate(std::size_t count)
+		{
+			return static_cast<T*>(allocate(count*sizeof(T),alignof(T)));
+		}
+
+		_EXLIB_THREAD_POOL_NODISCARD mark get_mark() const noexcept
+		{
+			return mark{_current,_pos};
+		}
+
+		/*
+			Frees everything allocated after m was taken.
+		*/
+		void rewind(mark m) noexcept
+		{
+			if(m.current)
+			{
+				_current=m.current;
+				_pos=m.pos;
+				_end=reinterpret_cast<std::uintptr_t>(m.current->data())+m.current->size;
+			}
+			else
+			{
+				reset();
+			}
+		}
+
+		/*
+			Frees everything allocated, keeping the chunks.
+		*/
+		void reset() noexcept
+		{
+			if(_current!=_head||(_head&&_pos!=reinterpret_cast<std::uintptr_t>(_head->data())))
+			{
+				enter(_head);
+			}
+		}
+
+		/*
+			Frees everything allocated, and returns the chunks to the heap.
+		*/
+		void release() noexcept
+		{
+			for(auto c=_head;c;)
+			{
+				auto const next=c->next;
+				::operator delete(c);
+				c=next;
+			}
+			_head=nullptr;
+			_current=nullptr;
+			_pos=0;
+			_end=0;
+		}
+
+		/*
+			Bytes held in chunks.
+		*/
+		_EXLIB_THREAD_POOL_NODISCARD std::size_t capacity() const noexcept
+		{
+			std::size_t total=0;
+			for(auto c=_head;c;c=c->next)
+			{
+				total+=c->size;
+			}
+			return total;
+		}
+	};
+
+	/*
+		The calling thread's worker_arena.
+	*/
+	inline worker_arena& this_thread_arena() noexcept
+	{
+		static thread_local worker_arena arena;
+		return arena;
+	}
+
+	/*
+		Allocator that takes memory from a worker_arena and never frees it, for standard containers of scratch data.
+	*/
+	template<typename T>
+	class arena_allocator {
+		template<typename U>
+		friend class arena_allocator;
+		worker_arena* _arena;
+	public:
+		using value_type=T;
+		explicit arena_allocator(worker_arena& arena) noexcept:_arena(&arena)
+		{}
+		template<typename U>
+		arena_allocator(arena_allocator<U> const& o) noexcept:_arena(o._arena)
+		{}
+		T* allocate(std::size_t count)
+		{
+			return _arena->allocate<T>(count);
+		}
+		void deallocate(T*,std::size_t) noexcept
+		{}
+		template<typename U>
+		bool operator==(arena_allocator<U> const& o) const noexcept
+		{
+			return _arena==o._arena;
+		}
+		template<typename U>
+		bool operator!=(arena_allocator<U> const& o) const noexcept
+		{
+			return _arena!=o._arena;
+		}
+	};
+
+	namespace thread_pool_impl {
+		/*
+			Thread pool where the threadpool stores the given arguments and each task is given those arguments.
+			There should only be one controlling thread.
+			No tasks added should throw.
+			Recommended using thread_pool if using a thread pool multiple times to avoid code bloat.
+			In work stealing mode each worker additionally owns a deque. Tasks pushed back from inside a worker
+			go to that worker's deque, which the worker pops LIFO and other workers steal from FIFO.
+		*/
+		template<typename... Args>
+		class thread_pool_a:thread_pool_detail::thread_pool_base {
+		public:
+			static_assert(thread_pool_detail::no_rvalue_references<Args...>::value,"rvalue references not allowed as arguments");
+			static_assert(thread_pool_detail::all_nothrow_copyable<Args...>::value,"Arguments must be no-throw copyable (thread_pool_a has no exception handling mechanism).");
+
+		private:
+			using TaskInput=std::tuple<thread_pool_detail::wrap_reference_t<Args>...>;
+		public:
+			friend class parent_ref;
+#if _EXLIB_THREAD_POOL_HAS_COROUTINES
+			class schedule_awaiter;
+#endif
+			/*
+				Returned by blocking_region. Lets a compensating worker retire once destroyed.
+			*/
+			class blocking_guard {
+				friend class thread_pool_a;
+				thread_pool_a* _pool;
+				explicit blocking_guard(thread_pool_a* pool) noexcept:_pool(pool)
+				{}
+			public:
+				blocking_guard(blocking_guard&& o) noexcept:_pool(o._pool)
+				{
+					o._pool=nullptr;
+				}
+				blocking_guard(blocking_guard const&)=delete;
+				blocking_guard& operator=(blocking_guard const&)=delete;
+				blocking_guard& operator=(blocking_guard&&)=delete;
+				~blocking_guard()
+				{
+					if(_pool)
+					{
+						_pool->retire_elastic_worker();
+					}
+				}
+			};
+			/*
+				A reference to the parent that child tasks can accept. Should be passed by value.
+				Contains the methods safe to call by child threads.
+			*/
+			class fork_join;
+			class parent_ref {
+				friend class thread_pool_a;
+				friend class fork_join;
+				thread_pool_a& parent;
+				parent_ref(thread_pool_a& p) noexcept:parent(p)
+				{}
+			public:
+				/*
+					Signals threads to stop looking for tasks and will signal a waiting master thread.
+				*/
+				void stop()
+				{
+					parent.signal_stop();
+				}
+				/*
+					See thread_pool_a::push_back
+				*/
+				template<typename... Tasks>
+				void push_back(Tasks&& ... tasks)
+				{
+					parent.push_back(std::forward<Tasks>(tasks)...);
+				}
+				template<typename... Tasks>
+				void push_back_no_sync(Tasks&& ... tasks)
+				{
+					parent.push_back_no_sync(std::forward<Tasks>(tasks)...);
+				}
+				/*
+					See thread_pool_a::push_front
+				*/
+				template<typename... Tasks>
+				void push_front(Tasks&& ... tasks)
+				{
+					parent.push_front(std::forward<Tasks>(tasks)...);
+				}
+				template<typename... Tasks>
+				void push_front_no_sync(Tasks&& ... tasks)
+				{
+					parent.push_front_no_sync(std::forward<Tasks>(tasks)...);
+				}
+				/*
+					See thread_pool_a::push_back_priority
+				*/
+				template<typename... Tasks>
+				void push_back_priority(size_t lane,Tasks&& ... tasks)
+				{
+					parent.push_back_priority(lane,std::forward<Tasks>(tasks)...);
+				}
+				/*
+					See thread_pool_a::push_back_deadline
+				*/
+				template<typename... Tasks>
+				void push_back_deadline(size_t lane,std::chrono::steady_clock::time_point deadline,Tasks&& ... tasks)
+				{
+					parent.push_back_deadline(lane,deadline,std::forward<Tasks>(tasks)...);
+				}
+				/*
+					See thread_pool_a::push_back_node
+				*/
+				template<typename... Tasks>
+				void push_back_node(size_t node,Tasks&& ... tasks)
+				{
+					parent.push_back_node(node,std::forward<Tasks>(tasks)...);
+				}
+				/*
+					See thread_pool_a::parallel_invoke
+				*/
+				template<typename Func,typename... Rest>
+				void parallel_invoke(Func&& func,Rest&& ... rest)
+				{
+					parent.parallel_invoke(std::forward<Func>(func),std::forward<Rest>(rest)...);
+				}
+				/*
+					See thread_pool_a::schedule_after
+				*/
+				template<typename Rep,typename Period,typename Task>
+				timer_handle schedule_after(std::chrono::duration<Rep,Period> delay,Task&& task)
+				{
+					return parent.schedule_after(delay,std::forward<Task>(task));
+				}
+				/*
+					See thread_pool_a::schedule_every
+				*/
+				template<typename Rep,typename Period,typename Task>
+				timer_handle schedule_every(std::chrono::duration<Rep,Period> period,Task&& task)
+				{
+					return parent.schedule_every(period,std::forward<Task>(task));
+				}
+				/*
+					See thread_pool_a::cancel_timer
+				*/
+				bool cancel_timer(timer_handle handle)
+				{
+					return parent.cancel_timer(handle);
+				}
+				/*
+					Scratch memory of the thread running the task, freed when the task returns.
+					Do not keep allocations across co_await, as the coroutine may resume after the task returns.
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD worker_arena& arena() const noexcept
+				{
+					return this_thread_arena();
+				}
+				/*
+					See thread_pool_a::blocking_region
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD blocking_guard blocking_region()
+				{
+					return parent.blocking_region();
+				}
+				/*
+					The NUMA node of the worker running the task, or 0 if the pool is not NUMA aware.
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD size_t node() const noexcept
+				{
+					return parent.this_node();
+				}
+				/*
+					See thread_pool_a::append
+				*/
+				template<typename Iter>
+				size_t append(Iter begin,Iter end)
+				{
+					return parent.append(begin,end);
+				}
+				template<typename Iter>
+				size_t append_no_sync(Iter begin,Iter end)
+				{
+					return parent.append_no_sync(begin,end);
+				}
+				/*
+					See thread_pool_a::prepend
+				*/
+				template<typename Iter>
+				size_t prepend(Iter begin,Iter end)
+				{
+					return parent.prepend(begin,end);
+				}
+				template<typename Iter>
+				size_t prepend_no_sync(Iter begin,Iter end)
+				{
+					return parent.prepend_no_sync(begin,end);
+				}
+				/*
+					Clears tasks.
+				*/
+				void clear()
+				{
+					parent.clear();
+				}
+				void clear_no_sync()
+				{
+					parent.clear_no_sync();
+				}
+				/*
+					Signals the threads to end. Does not join them.
+				*/
+				void terminate()
+				{
+					parent.signal_terminate();
+				}
+				void lock()
+				{
+					parent.lock();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD bool try_lock()
+				{
+					return parent.try_lock();
+				}
+				void unlock()
+				{
+					return parent.unlock();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD bool empty() const
+				{
+					return parent.empty();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD bool empty_no_sync() const
+				{
+					return parent.empty_no_sync();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs() const
+				{
+					return parent.num_jobs();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs_no_sync() const
+				{
+					return parent.num_jobs_no_sync();
+				}
+				_EXLIB_THREAD_POOL_NODISCARD size_t num_threads() const
+				{
+					return parent.num_threads();
+				}
+				/*
+					The arguments the pool passes to its tasks, as a tuple.
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD TaskInput const& input() const noexcept
+				{
+					return parent._input;
+				}
+#if _EXLIB_THREAD_POOL_HAS_COROUTINES
+				/*
+					See thread_pool_a::schedule
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD schedule_awaiter schedule() noexcept
+				{
+					return parent.schedule();
+				}
+#endif
+			};
+
+			/*
+				Joins tasks forked from one thread, running other queued tasks of the pool while they finish instead of sleeping,
+				so a task can wait on its children without taking a worker away from them.
+				When there is nothing to help with it spins briefly, then sleeps, looking for tasks again every millisecond.
+				Forked callables take no arguments and may throw: join rethrows the first exception once every fork has finished.
+				Helping runs other tasks on the joining thread's stack, so deep recursion nests deeply.
+				The destructor joins, discarding any exception.
+			*/
+			class fork_join {
+				template<typename Func>
+				struct branch {
+					fork_join* join;
+					Func func;
+					template<typename... Input>
+					void operator()(parent_ref,Input const&...) noexcept
+					{
+						try
+						{
+							func();
+						}
+						catch(...)
+						{
+							join->fail(std::current_exception());
+						}
+						join->finish();
+					}
+				};
+
+				thread_pool_a& _pool;
+				//forks pushed and not finished
+				std::atomic<size_t> _pending{0};
+				std::mutex _mtx;
+				std::condition_variable _done_cv;
+				std::exception_ptr _error;
+
+				void fail(std::exception_ptr e) noexcept
+				{
+					std::lock_guard<std::mutex> lock{_mtx};
+					if(!_error)
+					{
+						_error=std::move(e);
+					}
+				}
+
+				//the last fork to finish decrements under the lock, so a joiner that sees no pending forks may destroy the fork_join
+				void finish() noexcept
+				{
+					auto pending=_pending.load(std::memory_order_relaxed);
+					while(true)
+					{
+						if(pending==1)
+						{
+							std::lock_guard<std::mutex> lock{_mtx};
+							if(_pending.fetch_sub(1,std::memory_order_acq_rel)==1)
+							{
+								_done_cv.notify_all();
+							}
+							return;
+						}
+						if(_pending.compare_exchange_weak(pending,pending-1,std::memory_order_acq_rel,std::memory_order_relaxed))
+						{
+							return;
+						}
+					}
+				}
+
+				void wait_for_forks()
+				{
+					unsigned idle=0;
+					while(_pending.load(std::memory_order_acquire)!=0)
+					{
+						if(_pool.run_queued_job())
+						{
+							idle=0;
+							continue;
+						}
+						if(++idle<=16)
+						{
+							std::this_thread::yield();
+							continue;
+						}
+						std::unique_lock<std::mutex> lock{_mtx};
+						_done_cv.wait_for(lock,std::chrono::milliseconds(1),[this]
+							{
+								return _pending.load(std::memory_order_acquire)==0;
+							});
+					}
+					//waits for the last fork to let go of the lock
+					std::lock_guard<std::mutex> lock{_mtx};
+				}
+			public:
+				explicit fork_join(thread_pool_a& pool) noexcept:_pool(pool)
+				{}
+				explicit fork_join(parent_ref parent) noexcept:_pool(parent.parent)
+				{}
+				fork_join(fork_join const&)=delete;
+				fork_join& operator=(fork_join const&)=delete;
+
+				~fork_join()
+				{
+					wait_for_forks();
+				}
+
+				/*
+					Pushes a task calling func onto the pool, to be joined by join.
+				*/
+				template<typename Func>
+				void fork(Func&& func)
+				{
+					_pending.fetch_add(1,std::memory_order_relaxed);
+					try
+					{
+						_pool.push_back(branch<typename std::decay<Func>::type>{this,std::forward<Func>(func)});
+					}
+					catch(...)
+					{
+						finish();
+						throw;
+					}
+				}
+
+				/*
+					The number of forks that have not finished.
+				*/
+				_EXLIB_THREAD_POOL_NODISCARD size_t pending() const noexcept
+				{
+					return _pending.load(std::memory_order_relaxed);
+				}
+
+				/*
+					Runs queued tasks until every fork has finished, then rethrows the first exception one threw, if any.
+				*/
+				void join()
+				{
+					wait_for_forks();
+					if(_error)
+					{
+						auto error=std::move(_error);
+						_error=nullptr;
+						std::rethrow_exception(error);
+					}
+				}
+			};
+
+#if _EXLIB_THREAD_POOL_HAS_COROUTINES
+			/*
+				Awaitable that suspends the coroutine and resumes it as a task on the pool.
+				Results in a parent_ref, so the coroutine can read the pool's arguments with input().
+			*/
+			class schedule_awaiter {
+				friend class thread_pool_a;
+				thread_pool_a& _pool;
+				explicit schedule_awaiter(thread_pool_a& pool) noexcept:_pool(pool)
+				{}
+			public:
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+				void await_suspend(std::coroutine_handle<> awaiting)
+				{
+					_pool.push_back(thread_pool_detail::resume_job{awaiting});
+				}
+				parent_ref await_resume() const noexcept
+				{
+					return parent_ref{_pool};
+				}
+			};
+#endif
+
+			using const_parent_ref=parent_ref const;
+			using thread_pool_base::reactivate;
+			using thread_pool_base::active;
+			using thread_pool_base::stop;
+			using thread_pool_base::running;
+			using thread_pool_base::lock;
+			using thread_pool_base::unlock;
+			using thread_pool_base::try_lock;
+			using thread_pool_base::signal_stop;
+			using thread_pool_base::signal_terminate;
+
+			/*
+				Starts the threadpool with a certain number of threads and arguments initialized to the given arguments.
+			*/
+			template<typename... T>
+			explicit thread_pool_a(size_t num_threads,T&& ... args):thread_pool_base(num_threads,true),_input(std::forward<T>(args)...)
+			{
+				create_threads();
+			}
+
+			/*
+				Initializes the threadpool with a certain number of threads and arguments initialized to the given arguments.
+				Threads are not started.
+			*/
+			template<typename... T>
+			explicit thread_pool_a(size_t num_threads,delay_start_t,T&& ... args):thread_pool_base(num_threads,false),_input(std::forward<T>(args)...)
+			{}
+
+			/*
+				Starts the threadpool in work stealing mode with a certain number of threads and arguments initialized to the given arguments.
+			*/
+			template<typename... T>
+			explicit thread_pool_a(size_t num_threads,work_stealing_t,T&& ... args):thread_pool_base(num_threads,true),_input(std::forward<T>(args)...),_work_stealing(true)
+			{
+				reset_worker_data();
+				create_threads();
+			}
+
+			/*
+				Initializes the threadpool in work stealing mode with a certain number of threads and arguments initialized to the given arguments.
+				Threads are not started.
+			*/
+			template<typename... T>
+			explicit thread_pool_a(size_t num_threads,delay_start_t,work_stealing_t,T&& ... args):thread_pool_base(num_threads,false),_input(std::forward<T>(args)...),_work_stealing(true)
+			{
+				reset_worker_data();
+			}
+
+			/*
+				Starts the threadpool with number of threads equal to the hardware concurrency.
+			*/
+			thread_pool_a():thread_pool_a(hardware_concurrency_or(1))
+			{}
+
+			/*
+				Initializes the threadpool with number of threads equal to the hardware concurrency.
+				Threads not started.
+			*/
+			explicit thread_pool_a(delay_start_t t):thread_pool_a(hardware_concurrency_or(1),t)
+			{}
+
+			/*
+				Set the args passed to the threads. Unsynchronized as you should not be modifying args that are actively being read from.
+			*/
+			template<typename... TplArgs>
+			void set_args(TplArgs&& ... args)
+			{
+				_input=TaskInput(std::forward<TplArgs>(args)...);
+			}
+
+			/*
+				Starts threads.
+			*/
+			void start()
+			{
+				if(!this->_running)
+				{
+					{
+						std::lock_guard<std::mutex> lock(_timer_mtx);
+						_timers_closed=false;
+					}
+					this->_running=true;
+					this->_active=true;
+					create_threads();
+				}
+			}
+
+			/*
+				Makes threads look for tasks. Useful after stop() has been called to reactivate job search.
+				Resets the args passed to the threads.
+			*/
+			template<typename... TupleArgs>
+			void reactivate(TupleArgs&& ... args)
+			{
+				set_args(std::forward<TupleArgs>(args)...);
+				this->reactivate();
+			}
+
+			/*
+				Waits for all jobs to be finished or for it to be stop()ed (be inactivated).
+				Threads keep running (if they already were), but tasks can be added without synchronization.
+			*/
+			void wait()
+			{
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				this->_jobs_done.wait(lock,[this]
+					{
+						return this->idle();
+					});
+			}
+
+			/*
+				Waits for all threads to become inactive.
+				Threads keep running (if they already were), but tasks can be added without synchronization.
+			*/
+			void wait_inactive()
+			{
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				this->_jobs_done.wait(lock,[this]
+					{
+						return this->inactive();
+					});
+			}
+
+			enum wait_state:bool {
+				wait_no_timeout=true,wait_timeout=false
+			};
+
+			/*
+				Waits for all jobs to be finished or to be stop()ed.
+				Returns false if timeout expired, otherwise true.
+			*/
+			template<typename Rep,typename Period>
+			wait_state wait_for(std::chrono::duration<Rep,Period> const& rel_time)
+			{
+				auto absolute_time=std::chrono::steady_clock::now()+rel_time;
+				return wait_until(absolute_time);
+			}
+
+			/*
+				Waits for all jobs to be finished or to be stop()ed.
+				Returns false if timeout expired, otherwise true.
+			*/
+			template<typename Clock,typename Duration>
+			wait_state wait_until(std::chrono::time_point<Clock,Duration> const& rel_time)
+			{
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				return this->_jobs_done.wait_until(lock,rel_time,[this]
+					{
+						return this->idle();
+					});
+			}
+
+			/*
+				Waits for all threads to become inactive or to be stop()ed.
+				Returns false if timeout expired, otherwise true.
+			*/
+			template<typename Rep,typename Period>
+			wait_state wait_inactive_for(std::chrono::duration<Rep,Period> const& rel_time)
+			{
+				auto absolute_time=std::chrono::steady_clock::now()+rel_time;
+				return wait_inactive_until(absolute_time);
+			}
+
+			/*
+				Waits for all jobs to be finished or to be stop()ed.
+				Returns false if timeout expired, otherwise true.
+			*/
+			template<typename Clock,typename Duration>
+			wait_state wait_inactive_until(std::chrono::time_point<Clock,Duration> const& rel_time)
+			{
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				return this->_jobs_done.wait_until(lock,rel_time,[this]
+					{
+						return this->inactive();
+					});
+			}
+
+			/*
+				Makes threads stop looking for jobs and ends threads.
+				Timers keep running; the tasks they push wait in the queue until the pool is started again.
+			*/
+			void terminate()
+			{
+				_supervisor.reset();
+				this->stop_running();
+				this->join_all();
+				join_elastic();
+			}
+
+			/*
+				Waits for all jobs to finish and ends threads. Waiting timers are dropped, and no timers can be added until start().
+			*/
+			void join()
+			{
+				close_timers();
+				_supervisor.reset();
+				join_base();
+				this->join_all();
+				join_elastic();
+			}
+
+			/*
+				calls join() and then does normal destruction
+			*/
+			~thread_pool_a() noexcept //if join errors, something's wrong with the threads and program should crash
+			{
+				close_timers();
+				_supervisor.reset();
+				join_base();
+				this->join_all();
+				join_elastic();
+			}
+
+			/*
+				Adds a task to the thread pool without synchronization.
+				Task must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename Task>
+			void push_back_no_sync(Task&& task)
+			{
+				this->_jobs.push_back(make_job(std::forward<Task>(task)));
+			}
+
+			/*
+				Adds a task to the front of thread pool without synchronization.
+				Task must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename Task>
+			void push_front_no_sync(Task&& task)
+			{
+				this->_jobs.push_front(make_job(std::forward<Task>(task)));
+			}
+
+			/*
+				Adds tasks to the thread pool without synchronization.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename FirstTask,typename... Rest>
+			void push_back_no_sync(FirstTask&& first,Rest&& ... rest)
+			{
+				push_back_no_sync(std::forward<FirstTask>(first));
+				push_back_no_sync(std::forward<Rest>(rest)...);
+			}
+
+			/*
+				Adds tasks to the front of the thread pool without synchronization.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename FirstTask,typename... Rest>
+			void push_front_no_sync(FirstTask&& first,Rest&& ... rest)
+			{
+				push_front_no_sync(std::forward<FirstTask>(first));
+				push_front_no_sync(std::forward<Rest>(rest)...);
+			}
+
+			/*
+				Adds task(s) to the thread pool with synchronization and wakes an appropriate number of threads.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename... Tasks>
+			void push_back(Tasks&& ... tasks)
+			{
+				if(auto const local=this_worker_data())
+				{
+					{
+						std::lock_guard<std::mutex> guard(local->mtx);
+						push_back_local(local->jobs,std::forward<Tasks>(tasks)...);
+						this->_local_jobs+=sizeof...(Tasks);
+					}
+					this->notify_local(sizeof...(Tasks));
+					return;
+				}
+#ifdef EXLIB_THREAD_POOL_MPMC
+				if(_lock_free)
+				{
+					push_back_lock_free(std::forward<Tasks>(tasks)...);
+					this->notify_local(sizeof...(Tasks));
+					return;
+				}
+#endif
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					push_back_no_sync(std::forward<Tasks>(tasks)...);
+				}
+				this->notify_count(sizeof...(Tasks));
+			}
+
+			/*
+				Adds task(s) to the front of the thread pool with synchronization and wakes an appropriate number of threads.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename... Tasks>
+			void push_front(Tasks&& ... tasks)
+			{
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					push_front_no_sync(std::forward<Tasks>(tasks)...);
+				}
+				this->notify_count(sizeof...(Tasks));
+			}
+
+			/*
+				Adds task(s) to the back of the given priority lane with synchronization and wakes an appropriate number of threads.
+				Lane 0 is the highest priority; lanes past the last are clamped to the last, which is where push_back puts tasks.
+				Always uses the shared queue, even from a worker in work stealing mode.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename... Tasks>
+			void push_back_priority(size_t lane,Tasks&& ... tasks)
+			{
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					push_back_lane(lane,std::forward<Tasks>(tasks)...);
+				}
+				this->notify_count(sizeof...(Tasks));
+			}
+
+			/*
+				Adds task(s) with a deadline to the given priority lane with synchronization and wakes an appropriate number of threads.
+				Within a lane, tasks with deadlines run earliest deadline first, before tasks without one.
+				Missing a deadline does not drop the task.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename... Tasks>
+			void push_back_deadline(size_t lane,std::chrono::steady_clock::time_point deadline,Tasks&& ... tasks)
+			{
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					push_deadline_lane(lane,deadline,std::forward<Tasks>(tasks)...);
+				}
+				this->notify_count(sizeof...(Tasks));
+			}
+
+			/*
+				Adds task(s) to the queue of the given NUMA node with synchronization and wakes an appropriate number of threads.
+				The node's workers take tasks from its queue before any other; other workers take them only once their own node's queue is empty.
+				Nodes past the last wrap around. If the pool is not NUMA aware, this is push_back.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename... Tasks>
+			void push_back_node(size_t node,Tasks&& ... tasks)
+			{
+				if(_node_cpus.empty())
+				{
+					push_back(std::forward<Tasks>(tasks)...);
+					return;
+				}
+				auto& data=_node_data[node%_node_cpus.size()];
+				{
+					std::lock_guard<std::mutex> guard(data.mtx);
+					push_back_local(data.jobs,std::forward<Tasks>(tasks)...);
+					this->_node_jobs+=sizeof...(Tasks);
+				}
+				this->notify_local(sizeof...(Tasks));
+			}
+
+			/*
+				Pushes task onto the pool with push_back at time, rounded up to the timer resolution, instead of a worker sleeping until then.
+				Timers are kept in a hierarchical timer wheel driven by a timer thread started by the first timer,
+				so adding and cancelling take constant time however many timers are waiting.
+				Timers still waiting when the pool is joined or destroyed are dropped, and timers added while it is being joined or destroyed,
+				or after it was joined and before start(), are refused with an empty handle.
+				Task must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+			*/
+			template<typename Clock,typename Duration,typename Task>
+			timer_handle schedule_at(std::chrono::time_point<Clock,Duration> const& time,Task&& task)
+			{
+				return schedule_timer(std::chrono::steady_clock::now()+(time-Clock::now()),timer_once<typename std::decay<Task>::type>{std::forward<Task>(task)},0);
+			}
+
+			/*
+				Pushes task onto the pool with push_back once delay has passed. See schedule_at.
+			*/
+			template<typename Rep,typename Period,typename Task>
+			timer_handle schedule_after(std::chrono::duration<Rep,Period> delay,Task&& task)
+			{
+				return schedule_timer(std::chrono::steady_clock::now()+delay,timer_once<typename std::decay<Task>::type>{std::forward<Task>(task)},0);
+			}
+
+			/*
+				Pushes a copy of task onto the pool with push_back every period, starting one period from now, until cancelled.
+				Periods missed because the timer thread fell behind are skipped rather than run in a burst.
+				Task must be copyable. See schedule_at.
+			*/
+			template<typename Rep,typename Period,typename Task>
+			timer_handle schedule_every(std::chrono::duration<Rep,Period> period,Task&& task)
+			{
+				using decayed=typename std::decay<Task>::type;
+				auto const ticks=to_timer_ticks(period);
+				return schedule_timer(std::chrono::steady_clock::now()+period,timer_repeat<decayed>{std::forward<Task>(task)},ticks==0?1:ticks);
+			}
+
+			/*
+				Stops a timer from pushing its task again. Returns false if it was a one time timer that already fired,
+				or was already cancelled. Tasks the timer already pushed are not affected.
+			*/
+			bool cancel_timer(timer_handle handle)
+			{
+				std::lock_guard<std::mutex> lock(_timer_mtx);
+				return _timers.cancel(handle);
+			}
+
+			/*
+				The number of timers waiting to fire.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t pending_timers() const
+			{
+				std::lock_guard<std::mutex> lock(_timer_mtx);
+				return _timers.size();
+			}
+
+			/*
+				Adds task(s) to the thread pool without synchronization reading	from the given iterators.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+				Returns the number of tasks added.
+			*/
+			template<typename Iter>
+			size_t append_no_sync(Iter begin,Iter end)
+			{
+				using category=typename std::iterator_traits<Iter>::iterator_category;
+				return append_to(this->_jobs,begin,end,category{});
+			}
+
+			/*
+				Adds task(s) to the front of the thread pool without synchronization reading from the given iterators.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+				Returns the number of tasks added.
+			*/
+			template<typename Iter>
+			size_t prepend_no_sync(Iter begin,Iter end)
+			{
+				using category=typename std::iterator_traits<Iter>::iterator_category;
+				return prepend_no_sync(begin,end,category{});
+			}
+
+			/*
+				Adds task(s) to the thread pool with synchronization and wakes an appropriate number of threads reading
+				from the given iterators.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+				Returns the number of tasks added.
+			*/
+			template<typename Iter>
+			size_t append(Iter begin,Iter end)
+			{
+				size_t count;
+				if(auto const local=this_worker_data())
+				{
+					{
+						using category=typename std::iterator_traits<Iter>::iterator_category;
+						std::lock_guard<std::mutex> guard(local->mtx);
+						count=append_to(local->jobs,begin,end,category{});
+						this->_local_jobs+=count;
+					}
+					this->notify_local(count);
+					return count;
+				}
+#ifdef EXLIB_THREAD_POOL_MPMC
+				if(_lock_free)
+				{
+					count=append_lock_free(begin,end);
+					this->notify_local(count);
+					return count;
+				}
+#endif
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					count=append_no_sync(begin,end);
+				}
+				this->notify_count(count);
+				return count;
+			}
+
+			/*
+				Adds task(s) to the front of the thread pool with synchronization and wakes an appropriate number of threads reading
+				from the given iterators.
+				Tasks must define operator() that can take in Args...
+				or optionally parent_ref as a first argument and then Args...
+				Returns the number of tasks added.
+			*/
+			template<typename Iter>
+			size_t prepend(Iter begin,Iter end)
+			{
+				size_t count;
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					count=prepend_no_sync(begin,end);
+				}
+				this->notify_count(count);
+				return count;
+			}
+
+			/*
+				Clears the jobs handled by this threadpool without synchronization.
+			*/
+			void clear_no_sync() noexcept
+			{
+				this->_jobs.clear();
+				for(size_t i=0;i<_worker_data_count;++i)
+				{
+					auto& data=_worker_data[i];
+					std::lock_guard<std::mutex> guard(data.mtx);
+					this->_local_jobs-=data.jobs.size();
+					data.jobs.clear();
+				}
+				for(size_t i=0;i<_node_cpus.size();++i)
+				{
+					auto& data=_node_data[i];
+					std::lock_guard<std::mutex> guard(data.mtx);
+					this->_node_jobs-=data.jobs.size();
+					data.jobs.clear();
+				}
+#ifdef EXLIB_THREAD_POOL_MPMC
+				if(_lock_free)
+				{
+					job discarded;
+					while(_lock_free->try_pop(discarded))
+					{
+						discarded.reset();
+						--this->_lock_free_jobs;
+					}
+				}
+#endif
+			}
+
+			/*
+				Clears the jobs handled by this threadpool.
+			*/
+			void clear()
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				this->clear_no_sync();
+			}
+
+			/*
+				Makes room in the shared queue for count jobs, so that pushing that many does not allocate.
+				Jobs are stored in place if they fit in EXLIB_THREAD_POOL_JOB_SIZE bytes, and the queues reuse their storage,
+				so a pool that has reached its high water mark does not allocate when small tasks are pushed.
+			*/
+			void reserve(size_t count)
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				this->_jobs.reserve(count);
+			}
+
+			/*
+				Sets the number of priority lanes. Tasks in removed lanes move to the new lowest lane.
+				push_front adds to the front of lane 0, push_back and append to the back of the last lane.
+			*/
+			void priority_lanes(size_t count)
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				this->_jobs.lane_count(count);
+			}
+
+			/*
+				The number of priority lanes.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t priority_lanes() const
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				return this->_jobs.lane_count();
+			}
+
+			/*
+				Sets how many times in a row a lane with tasks can be passed over for higher lanes before it is served.
+				The limit is at least 1, so a limit of 0 is treated as 1; with a limit of 1 every other task comes from a lower lane.
+			*/
+			void aging_limit(size_t limit)
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				this->_jobs.aging_limit(limit);
+			}
+
+			_EXLIB_THREAD_POOL_NODISCARD size_t aging_limit() const
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				return this->_jobs.aging_limit();
+			}
+
+			/*
+				Changes the number of threads.
+			*/
+			void num_threads(size_t size)
+			{
+				assert(size!=0);
+				if(size==num_threads())
+				{
+					return;
+				}
+				if(this->_running)
+				{
+					if(size>this->_workers.size()&&!this->_work_stealing&&_node_cpus.empty()&&!metrics()&&_max_threads==0)
+					{
+						this->_workers.reserve(size);
+						for(size_t i=this->_workers.size();i<size;++i)
+						{
+							this->_workers.emplace_back(&thread_pool_a::task_loop,this,i);
+						}
+					}
+					else
+					{
+						this->terminate();
+						this->_workers.resize(size);
+						reset_worker_data();
+						this->start();
+					}
+				}
+				else
+				{
+					this->_workers.resize(size);
+					reset_worker_data();
+				}
+			}
+
+			/*
+				Turns work stealing mode on or off. Running threads are restarted.
+				Tasks in the workers' deques are moved to the shared queue.
+			*/
+			void work_stealing(bool enable)
+			{
+				if(enable==this->_work_stealing)
+				{
+					return;
+				}
+				bool const was_running=this->_running;
+				if(was_running)
+				{
+					this->terminate();
+				}
+				this->_work_stealing=enable;
+				reset_worker_data();
+				if(was_running)
+				{
+					this->start();
+				}
+			}
+
+			/*
+				Whether the pool is in work stealing mode.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD bool work_stealing() const noexcept
+			{
+				return this->_work_stealing;
+			}
+
+			/*
+				Pins worker i to the CPUs in cpu_sets[i%cpu_sets.size()]; an empty cpu_sets unpins them.
+				Pinning is best effort, and skipped where the platform does not support it.
+				Turns off NUMA awareness. Running threads are restarted; a stopped pool stays stopped.
+			*/
+			void pin_workers(std::vector<std::vector<unsigned>> cpu_sets)
+			{
+				reconfigure([this,&cpu_sets]
+					{
+						move_node_jobs_to_shared();
+						_node_cpus.clear();
+						_node_data.reset();
+						_cpu_sets=std::move(cpu_sets);
+					});
+			}
+
+			/*
+				Splits the workers into one contiguous block per NUMA node reported by numa_topology(), pins each block to its node's CPUs,
+				and gives each node a queue for push_back_node. Turning it off unpins the workers and moves hinted tasks to the shared queue.
+				Running threads are restarted; a stopped pool stays stopped.
+			*/
+			void numa_aware(bool enable)
+			{
+				numa_aware(enable?numa_topology():std::vector<std::vector<unsigned>>());
+			}
+
+			/*
+				Like numa_aware(true), with the CPUs of each node given.
+			*/
+			void numa_aware(std::vector<std::vector<unsigned>> nodes)
+			{
+				reconfigure([this,&nodes]
+					{
+						move_node_jobs_to_shared();
+						_cpu_sets.clear();
+						_node_cpus=std::move(nodes);
+						_node_data.reset(_node_cpus.empty()?nullptr:new node_data[_node_cpus.size()]);
+					});
+			}
+
+			/*
+				The number of NUMA nodes the workers are split into, or 0 if the pool is not NUMA aware.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t numa_nodes() const noexcept
+			{
+				return _node_cpus.size();
+			}
+
+			/*
+				Turns on elastic scaling. The pool keeps min_threads core workers, and starts extra workers, up to max_threads in all,
+				when tasks have waited through two checks in a row, check_interval apart, without any worker free,
+				or when a task enters a blocking_region. Extra workers exit after idle_timeout without work.
+				They take tasks from every queue but own no deque in work stealing mode, and are not counted in metrics.
+				A check_interval of 0 turns off growing on a backlog, so only blocking_region starts extra workers;
+				a backlog of CPU bound tasks then does not oversubscribe the CPUs.
+				max_threads<=min_threads turns it off. Running threads are restarted; a stopped pool stays stopped.
+			*/
+			void elastic(size_t min_threads,size_t max_threads,std::chrono::milliseconds idle_timeout=std::chrono::milliseconds(1000),std::chrono::milliseconds check_interval=std::chrono::milliseconds(10))
+			{
+				assert(min_threads!=0);
+				reconfigure([&]
+					{
+						if(min_threads!=num_threads())
+						{
+							this->_workers.resize(min_threads);
+							reset_worker_data();
+						}
+						_max_threads=max_threads>min_threads?max_threads:0;
+						_idle_timeout=idle_timeout;
+						_check_interval=check_interval;
+					});
+			}
+
+			/*
+				The most threads the pool runs at once: num_threads() unless elastic scaling is on.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t max_threads() const noexcept
+			{
+				return _max_threads!=0?_max_threads:num_threads();
+			}
+
+			/*
+				The number of extra workers started by elastic scaling that are running.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t elastic_threads() const
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				return _elastic_count;
+			}
+
+			/*
+				Tells the pool that the calling task is about to block, e.g. on I/O, until the returned guard is destroyed.
+				If elastic scaling is on and no worker is free, a compensating worker is started right away, within max_threads(),
+				and retires once the guard is destroyed and it has no work. Otherwise this does nothing.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD blocking_guard blocking_region()
+			{
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				if(_max_threads!=0&&this->_sleeping==0&&spawn_elastic())
+				{
+					return blocking_guard{this};
+				}
+				return blocking_guard{nullptr};
+			}
+
+			/*
+				Turns collecting metrics for stats() on or off. Each worker counts into its own counters, which are summed when read;
+				while off, the only cost is checking whether they are on.
+				Turning them on, or changing the number of threads or the work stealing mode while they are on, resets the counters,
+				and only tasks pushed while they are on have their enqueue-to-start latency recorded.
+				Turning them off stops the metrics_callback. Running threads are restarted; a stopped pool stays stopped.
+			*/
+			void metrics(bool enable)
+			{
+				if(enable==metrics())
+				{
+					return;
+				}
+				if(!enable)
+				{
+					_reporter.reset();
+				}
+				reconfigure([this,enable]
+					{
+						std::lock_guard<std::mutex> guard(_metrics_mtx);
+						_metrics.reset(enable?new thread_pool_detail::worker_metrics[this->_workers.size()]:nullptr);
+						_metrics_count=enable?this->_workers.size():0;
+						_metrics_on.store(enable,std::memory_order_relaxed);
+					});
+			}
+
+			/*
+				Whether metrics are being collected.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD bool metrics() const noexcept
+			{
+				return _metrics_on.load(std::memory_order_relaxed);
+			}
+
+			/*
+				Calls callback with stats() every period on a separate thread, until called with an empty callback or the pool is destroyed.
+				Turns on metrics if they are off.
+			*/
+			template<typename Rep,typename Period>
+			void metrics_callback(std::chrono::duration<Rep,Period> period,std::function<void(thread_pool_stats const&)> callback)
+			{
+				_reporter.reset();
+				if(callback)
+				{
+					if(!metrics())
+					{
+						metrics(true);
+					}
+					_reporter.reset(new thread_pool_detail::periodic_caller(period,[this,callback]
+						{
+							callback(stats());
+						}));
+				}
+			}
+
+			/*
+				A snapshot of the queue depth and, if metrics are enabled, of each worker's counters and the enqueue-to-start latency histogram.
+				The counters are read without stopping the workers, so they may be slightly out of step with each other.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD thread_pool_stats stats() const
+			{
+				thread_pool_stats result;
+				result.time=std::chrono::steady_clock::now();
+				result.queued=num_jobs();
+				result.active=this->_active_thread_count;
+				result.extra_threads=elastic_threads();
+				result.latency.fill(0);
+				std::lock_guard<std::mutex> guard(_metrics_mtx);
+				if(_metrics)
+				{
+					//not num_threads(), which changes before _metrics is replaced
+					result.workers.resize(_metrics_count);
+					for(size_t i=0;i<result.workers.size();++i)
+					{
+						auto const& metrics=_metrics[i];
+						auto& worker=result.workers[i];
+						worker.tasks_executed=metrics.tasks_executed.get();
+						worker.steals=metrics.steals.get();
+						worker.busy=std::chrono::nanoseconds(metrics.busy_ns.get());
+						worker.idle=std::chrono::nanoseconds(metrics.idle_ns.get());
+						worker.lock_wait=std::chrono::nanoseconds(metrics.lock_wait_ns.get());
+						for(size_t b=0;b<result.latency.size();++b)
+						{
+							result.latency[b]+=metrics.latency[b].get();
+						}
+					}
+				}
+				return result;
+			}
+
+#ifdef EXLIB_THREAD_POOL_MPMC
+			/*
+				Gives the pool a bounded lock-free queue (exlib::mpmc_queue) holding at least capacity jobs.
+				push_back, append and async from threads outside the pool then push to it instead of locking the shared queue,
+				falling back to the shared queue when it is full, and workers pop from it without locking.
+				Tasks outside the lowest priority lane of the shared queue still run first.
+				A capacity of 0 removes it, moving its tasks to the shared queue. Running threads are restarted; a stopped pool stays stopped.
+				Only available if EXLIB_THREAD_POOL_MPMC is defined, which requires C++14.
+			*/
+			void lock_free_queue(size_t capacity)
+			{
+				reconfigure([this,capacity]
+					{
+						if(_lock_free)
+						{
+							job task;
+							while(_lock_free->try_pop(task))
+							{
+								this->_jobs.push_back(std::move(task));
+							}
+							this->_lock_free_jobs=0;
+						}
+						_lock_free.reset(capacity==0?nullptr:new lock_free_queue_type(capacity));
+					});
+			}
+
+			/*
+				The capacity of the lock-free queue, or 0 if there is none.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t lock_free_queue() const noexcept
+			{
+				return _lock_free?_lock_free->capacity():0;
+			}
+#endif
+
+			/*
+				The number of threads.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t num_threads() const noexcept
+			{
+				return this->_workers.size();
+			}
+
+			/*
+				The number of jobs left.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs() const
+			{
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				return num_jobs_no_sync();
+			}
+
+			/*
+				The number of jobs left read unsynchronized from the job queue.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs_no_sync() const noexcept
+			{
+				return this->_jobs.size()+unshared_jobs();
+			}
+
+			/*
+				Whether job queue is empty.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD bool empty() const
+			{
+				return num_jobs()==0;
+			}
+
+			/*
+				Whether job queue is empty read unsynchronized from the job queue.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD bool empty_no_sync() const noexcept
+			{
+				return num_jobs()==0;
+			}
+
+			/*
+				Returns a future representing the result of running the given task asynchronously.
+			*/
+			template<typename Task>
+			_EXLIB_THREAD_POOL_NODISCARD auto async(Task&& task) -> std::future<decltype(thread_pool_detail::fake_invoke<parent_ref,Args...>(std::forward<Task>(task)))>
+			{
+				thread_pool_detail::TaskDoer<Task,parent_ref,Args...> doer{std::forward<Task>(task)};
+				auto future=doer.promise.get_future();
+				push_back(std::move(doer));
+				return future;
+			}
+
+			/*
+				Returns a future representing the result of running the given task asynchronously.
+			*/
+			template<typename Task,typename... Extra>
+			_EXLIB_THREAD_POOL_NODISCARD auto async(Task&& task,Extra...) -> std::future<decltype(thread_pool_detail::fake_invoke<Args...>(std::forward<Task>(task)))>
+			{
+				static_assert(sizeof...(Extra)==0,"These arguments are only for SFINAE. Use lambda capture/bind if you want to arguments passed to a functor.");
+				thread_pool_detail::TaskDoer<Task,Args...> doer{std::forward<Task>(task)};
+				auto future=doer.promise.get_future();
+				push_back(std::move(doer));
+				return future;
+			}
+
+			/*
+				Calls every function, running func on the calling thread and pushing the rest onto the pool,
+				then helps run the pool's tasks until the rest have finished (see fork_join), for divide and conquer.
+				The functions are called by reference and take no arguments.
+				If one throws, the first exception is rethrown once all have finished.
+			*/
+			template<typename Func,typename... Rest>
+			void parallel_invoke(Func&& func,Rest&& ... rest)
+			{
+				fork_join join{*this};
+				using expand=int[];
+				(void)expand{0,(join.fork(std::ref(rest)),0)...};
+				func();
+				join.join();
+			}
+
+			/*
+				Calls f(i) for every i in [begin, end), where Index is an integer or random access iterator.
+				The range is split into chunks of at least grain iterations, claimed dynamically by the pool's threads and the calling thread.
+				Returns once every iteration is done; does not wait on other tasks in the pool, so independent loops can share it.
+				If f throws, the remaining chunks are skipped and the first exception is rethrown here.
+			*/
+			template<typename Index,typename Func>
+			void parallel_for(Index begin,Index end,size_t grain,Func&& f)
+			{
+				using range_type=thread_pool_detail::parallel_range<Index>;
+				size_t const count=static_cast<size_t>(end-begin);
+				if(count==0)
+				{
+					return;
+				}
+				grain=grain==0?1:grain;
+				size_t const helpers=parallel_helper_count(count,grain);
+				auto range=std::make_shared<range_type>(begin,count,grain,helpers+1);
+				push_back_copies(thread_pool_detail::parallel_for_helper<Index,typename std::remove_reference<Func>::type>{range,&f},helpers);
+				thread_pool_detail::parallel_for_participate(*range,f);
+				range->wait();
+			}
+
+			/*
+				Reduces [first, last) in parallel. range_reduce(chunk_first, chunk_last, acc) folds a chunk into acc and returns it,
+				and combine(a, b) merges two partial results. Each participant starts from a copy of identity,
+				so combine must be associative and identity its identity element; the order partial results are combined in is unspecified.
+				Chunking and exceptions are as in parallel_for.
+			*/
+			template<typename Index,typename T,typename RangeReduce,typename Combine>
+			T parallel_reduce(Index first,Index last,size_t grain,T identity,RangeReduce range_reduce,Combine combine)
+			{
+				using range_type=thread_pool_detail::parallel_reduce_range<Index,T>;
+				size_t const count=static_cast<size_t>(last-first);
+				if(count==0)
+				{
+					return identity;
+				}
+				grain=grain==0?1:grain;
+				size_t const helpers=parallel_helper_count(count,grain);
+				auto range=std::make_shared<range_type>(first,count,grain,helpers+1,identity);
+				push_back_copies(thread_pool_detail::parallel_reduce_helper<Index,T,RangeReduce,Combine>{range,&range_reduce,&combine},helpers);
+				thread_pool_detail::parallel_reduce_participate(*range,range_reduce,combine);
+				range->wait();
+				return std::move(range->result);
+			}
+
+			/*
+				Reduces transform(i) for every i in [first, last) in parallel with reduce(acc, value).
+				reduce must be associative and identity its identity element. See parallel_reduce.
+			*/
+			template<typename Index,typename T,typename Reduce,typename Transform>
+			T parallel_transform_reduce(Index first,Index last,size_t grain,T identity,Reduce reduce,Transform transform)
+			{
+				using range_reduce=thread_pool_detail::transform_range_reduce<Index,T,Reduce,Transform>;
+				return parallel_reduce(first,last,grain,std::move(identity),range_reduce{&reduce,&transform},reduce);
+			}
+
+#if _EXLIB_THREAD_POOL_HAS_COROUTINES
+			/*
+				co_await pool.schedule() continues the coroutine as a task on one of the pool's threads.
+				See pool_task.h for a coroutine type to use it with.
+			*/
+			_EXLIB_THREAD_POOL_NODISCARD schedule_awaiter schedule() noexcept
+			{
+				return schedule_awaiter{*this};
+			}
+#endif
+
+		private:
+
+			//number of pool tasks worth waking to help the calling thread with a loop of count iterations
+			size_t parallel_helper_count(size_t count,size_t grain) const noexcept
+			{
+				size_t const chunks=count/grain+(count%grain!=0);
+				return std::min(num_threads(),chunks-1);
+			}
+
+			//pushes n copies of task with one lock
+			template<typename Task>
+			void push_back_copies(Task const& task,size_t n)
+			{
+				if(n==0)
 				{
-					parent.push_back_no_sync(std::forward<Tasks>(tasks)...);
+					return;
 				}
-				/*
-					See thread_pool_a::push_front
-				*/
-				template<typename... Tasks>
-				void push_front(Tasks&& ... tasks)
+				if(auto const local=this_worker_data())
 				{
-					parent.push_front(std::forward<Tasks>(tasks)...);
+					{
+						std::lock_guard<std::mutex> guard(local->mtx);
+						local->jobs.reserve(local->jobs.size()+n);
+						for(size_t i=0;i<n;++i)
+						{
+							local->jobs.push_back(make_job(task));
+						}
+						this->_local_jobs+=n;
+					}
+					this->notify_local(n);
+					return;
 				}
-				template<typename... Tasks>
-				void push_front_no_sync(Tasks&& ... tasks)
+#ifdef EXLIB_THREAD_POOL_MPMC
+				if(_lock_free)
 				{
-					parent.push_front_no_sync(std::forward<Tasks>(tasks)...);
+					for(size_t i=0;i<n;++i)
+					{
+						push_back_lock_free(task);
+					}
+					this->notify_local(n);
+					return;
 				}
-				/*
-					See thread_pool_a::append
-				*/
-				template<typename Iter>
-				size_t append(Iter begin,Iter end)
+#endif
 				{
-					return parent.append(begin,end);
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					this->_jobs.reserve(this->_jobs.size()+n);
+					for(size_t i=0;i<n;++i)
+					{
+						this->_jobs.push_back(make_job(task));
+					}
 				}
-				template<typename Iter>
-				size_t append_no_sync(Iter begin,Iter end)
+				this->notify_count(n);
+			}
+
+			//a timer is pushed onto the pool as a timer_job by the timer thread
+			using timer_job=thread_pool_detail::small_task<void(thread_pool_a&),EXLIB_THREAD_POOL_JOB_SIZE>;
+			using timer_tick=typename timer_wheel<timer_job>::tick_type;
+
+			template<typename Task>
+			struct timer_once {
+				Task task;
+				void operator()(thread_pool_a& pool) noexcept
 				{
-					return parent.append_no_sync(begin,end);
+					pool.push_back(std::move(task));
 				}
-				/*
-					See thread_pool_a::prepend
-				*/
-				template<typename Iter>
-				size_t prepend(Iter begin,Iter end)
+			};
+
+			template<typename Task>
+			struct timer_repeat {
+				Task task;
+				void operator()(thread_pool_a& pool) noexcept
 				{
-					return parent.prepend(begin,end);
+					pool.push_back(task);
 				}
-				template<typename Iter>
-				size_t prepend_no_sync(Iter begin,Iter end)
+			};
+
+			static std::chrono::milliseconds timer_resolution() noexcept
+			{
+				return std::chrono::milliseconds(1);
+			}
+
+			//rounded up, so timers never fire early
+			template<typename Rep,typename Period>
+			static timer_tick to_timer_ticks(std::chrono::duration<Rep,Period> d)
+			{
+				auto const ns=std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+				auto const per_tick=std::chrono::duration_cast<std::chrono::nanoseconds>(timer_resolution()).count();
+				return ns<=0?0:static_cast<timer_tick>((ns+per_tick-1)/per_tick);
+			}
+
+			timer_handle schedule_timer(std::chrono::steady_clock::time_point due,timer_job entry,timer_tick period)
+			{
+				std::lock_guard<std::mutex> lock(_timer_mtx);
+				if(_timers_closed)
 				{
-					return parent.prepend_no_sync(begin,end);
+					return timer_handle{};
 				}
-				/*
-					Clears tasks.
-				*/
-				void clear()
+				if(!_timer_thread.joinable())
 				{
-					parent.clear();
+					_timers.clear();
+					_timer_start=std::chrono::steady_clock::now();
+					_timer_wake=std::numeric_limits<timer_tick>::max();
+					_timer_thread=thread_pool_detail::joining_thread(&thread_pool_a::timer_loop,this);
 				}
-				void clear_no_sync()
+				auto const expiry=to_timer_ticks(due-_timer_start);
+				auto const handle=_timers.insert(expiry,std::move(entry),period);
+				if(expiry<_timer_wake)
 				{
-					parent.clear_no_sync();
+					_timer_wake=expiry;
+					_timer_cv.notify_one();
 				}
-				/*
-					Signals the threads to end. Does not join them.
-				*/
-				void terminate()
+				return handle;
+			}
+
+			//advances the wheel to the current tick, then sleeps until the next tick at which a timer fires or moves
+			void timer_loop()
+			{
+				auto const resolution=timer_resolution();
+				std::unique_lock<std::mutex> lock(_timer_mtx);
+				while(!_timer_stop)
 				{
-					parent.signal_terminate();
+					auto const now=static_cast<timer_tick>((std::chrono::steady_clock::now()-_timer_start)/resolution);
+					_timers.advance(now,[this](timer_job& entry)
+						{
+							entry(*this);
+						});
+					auto const wait=_timers.ticks_to_next();
+					if(wait==std::numeric_limits<timer_tick>::max())
+					{
+						_timer_wake=wait;
+						_timer_cv.wait(lock);
+					}
+					else
+					{
+						_timer_wake=_timers.now()+wait;
+						_timer_cv.wait_until(lock,_timer_start+resolution*_timer_wake);
+					}
 				}
-				void lock()
+			}
+
+			//refuses new timers, so tasks still running cannot restart the timer thread, then stops it and drops waiting timers
+			void close_timers()
+			{
 				{
-					parent.lock();
+					std::lock_guard<std::mutex> lock(_timer_mtx);
+					_timers_closed=true;
+					if(!_timer_thread.joinable())
+					{
+						return;
+					}
+					_timer_stop=true;
 				}
-				_EXLIB_THREAD_POOL_NODISCARD bool try_lock()
+				_timer_cv.notify_all();
+				_timer_thread.join();
+				std::lock_guard<std::mutex> lock(_timer_mtx);
+				_timers.clear();
+				_timer_stop=false;
+			}
+
+			void join_base()
+			{
+				wait();
+				this->_active=false;
+				this->_running=false;
+				this->_signal_start.notify_all();
+			}
+
+			template<typename Queue,typename Iter>
+			size_t append_to(Queue& queue,Iter begin,Iter end,std::random_access_iterator_tag)
+			{
+				size_t const count=end-begin;
+				queue.reserve(queue.size()+count);
+				for(;begin!=end;++begin)
 				{
-					return parent.try_lock();
+					queue.push_back(make_job(*begin));
 				}
-				void unlock()
+				return count;
+			}
+			template<typename Queue,typename Iter>
+			size_t append_to(Queue& queue,Iter begin,Iter end,std::input_iterator_tag)
+			{
+				size_t count=0;
+				using input_type=typename std::iterator_traits<Iter>::reference;
+				std::for_each(begin,end,[this,&queue,&count](input_type task)
+					{
+						queue.push_back(this->make_job(std::forward<input_type>(task)));
+						++count;
+					});
+				return count;
+			}
+			template<typename Iter>
+			size_t prepend_no_sync(Iter begin,Iter end,std::random_access_iterator_tag)
+			{
+				size_t const count=end-begin;
+				while(end!=begin)
 				{
-					return parent.unlock();
+					--end;
+					this->_jobs.push_front(make_job(*end));
 				}
-				_EXLIB_THREAD_POOL_NODISCARD bool empty() const
+				return count;
+			}
+			template<typename Iter>
+			size_t prepend_no_sync(Iter begin,Iter end,std::input_iterator_tag)
+			{
+				size_t count=0;
+				using input_type=typename std::iterator_traits<Iter>::reference;
+				std::for_each(begin,end,[this,&count](input_type task)
+					{
+						this->push_front_no_sync(std::forward<input_type>(task));
+						++count;
+					});
+				return count;
+			}
+			//number of tasks queued outside the shared queue
+			size_t unshared_jobs() const noexcept
+			{
+				return this->_local_jobs+this->_lock_free_jobs+this->_node_jobs;
+			}
+			bool idle() const noexcept
+			{
+				return !this->_active||(this->_jobs.empty()&&unshared_jobs()==0&&this->_active_thread_count==0);
+			}
+			bool inactive() const noexcept
+			{
+				return (this->_active_thread_count==0)&&(!this->_active||(this->_jobs.empty()&&unshared_jobs()==0));
+			}
+			void create_threads()
+			{
+				assert(num_threads()!=0);
+				this->_active_thread_count=0;
+				for(size_t i=0;i<this->_workers.size();++i)
 				{
-					return parent.empty();
+					this->_workers[i]=thread_pool_detail::joining_thread(&thread_pool_a::task_loop,this,i);
 				}
-				_EXLIB_THREAD_POOL_NODISCARD bool empty_no_sync() const
+				if(_max_threads!=0&&_check_interval.count()!=0)
 				{
-					return parent.empty_no_sync();
+					_backlogged=false;
+					_supervisor.reset(new thread_pool_detail::periodic_caller(_check_interval,[this]
+						{
+							supervise();
+						}));
 				}
-				_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs() const
+			}
+			using job=thread_pool_detail::small_task<void(parent_ref,TaskInput const&),EXLIB_THREAD_POOL_JOB_SIZE>;
+			template<typename BaseFunc>
+			struct job_impl {
+				BaseFunc task;
+				void operator()(parent_ref,TaskInput const& input) noexcept
 				{
-					return parent.num_jobs();
+					thread_pool_detail::apply(task,input);
 				}
-				_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs_no_sync() const
+			};
+			template<typename BaseFunc>
+			struct job_impl_accept_parent {
+				BaseFunc task;
+				void operator()(parent_ref tp,TaskInput const& input) noexcept
 				{
-					return parent.num_jobs_no_sync();
+					thread_pool_detail::apply_fa(task,tp,input);
 				}
-				_EXLIB_THREAD_POOL_NODISCARD size_t num_threads() const
+			};
+
+			//records how long the job waited to start when metrics are enabled
+			template<typename Impl>
+			struct timed_job_impl {
+				Impl impl;
+				std::chrono::steady_clock::time_point enqueued;
+				void operator()(parent_ref tp,TaskInput const& input) noexcept
 				{
-					return parent.num_threads();
+					tp.parent.record_latency(enqueued);
+					impl(tp,input);
 				}
 			};
 
-			using const_parent_ref=parent_ref const;
-			using thread_pool_base::reactivate;
-			using thread_pool_base::active;
-			using thread_pool_base::stop;
-			using thread_pool_base::running;
-			using thread_pool_base::lock;
-			using thread_pool_base::unlock;
-			using thread_pool_base::try_lock;
-			using thread_pool_base::signal_stop;
-			using thread_pool_base::signal_terminate;
-
-			/*
-				Starts the threadpool with a certain number of threads and arguments initialized to the given arguments.
-			*/
-			template<typename... T>
-			explicit thread_pool_a(size_t num_threads,T&& ... args):thread_pool_base(num_threads,true),_input(std::forward<T>(args)...)
+			template<typename Task,typename... Extra>
+			static job_impl<thread_pool_detail::remove_cvref_t<Task>> wrap_job2(Task&& the_task,Extra...)
 			{
-				create_threads();
+				static_assert(!std::is_same<Task,Task>::value,"Task fails to accepts proper arguments; must accept (parent_ref, Args...), or (Args...)");
 			}
 
-			/*
-				Initializes the threadpool with a certain number of threads and arguments initialized to the given arguments.
-				Threads are not started.
-			*/
-			template<typename... T>
-			explicit thread_pool_a(size_t num_threads,delay_start_t,T&& ... args):thread_pool_base(num_threads,false),_input(std::forward<T>(args)...)
-			{}
-
-			/*
-				Starts the threadpool with number of threads equal to the hardware concurrency.
-			*/
-			thread_pool_a():thread_pool_a(hardware_concurrency_or(1))
-			{}
+			template<typename Task>
+			static auto wrap_job2(Task&& the_task) -> typename std::remove_reference<decltype(thread_pool_detail::fake_invoke<Args...>(std::forward<Task>(the_task)),std::declval<job_impl<thread_pool_detail::remove_cvref_t<Task>>>())>::type
+			{
+				using decayed=typename std::decay<Task>::type;
+				static_assert(noexcept(std::declval<decayed&>()(std::declval<Args>()...)),"Tasks cannot throw (thread_pool_a has no exception handling mechanism); use async/promise if you need errors.");
+				return job_impl<thread_pool_detail::remove_cvref_t<Task>>{std::forward<Task>(the_task)};
+			}
 
-			/*
-				Initializes the threadpool with number of threads equal to the hardware concurrency.
-				Threads not started.
-			*/
-			explicit thread_pool_a(delay_start_t t):thread_pool_a(hardware_concurrency_or(1),t)
-			{}
+			//overload to try to fit to pass arguments without parent
+			template<typename Task,typename... Extra>
+			static auto wrap_job(Task&& the_task,Extra...) -> decltype(wrap_job2(std::forward<Task>(the_task)))
+			{
+				return wrap_job2(std::forward<Task>(the_task));
+			}
 
-			/*
-				Set the args passed to the threads. Unsynchronized as you should not be modifying args that are actively being read from.
-			*/
-			template<typename... TplArgs>
-			void set_args(TplArgs&& ... args)
+			//overload to try to fit to pass arguments with parent
+			template<typename Task>
+			static auto wrap_job(Task&& the_task) -> typename std::remove_reference<decltype(thread_pool_detail::fake_invoke<parent_ref,Args...>(std::forward<Task>(the_task)),std::declval<job_impl_accept_parent<thread_pool_detail::remove_cvref_t<Task>>>())>::type
 			{
-				_input=TaskInput(std::forward<TplArgs>(args)...);
+				using decayed=typename std::decay<Task>::type;
+				static_assert(noexcept(std::declval<decayed&>()(std::declval<parent_ref>(),std::declval<Args>()...)),"Tasks cannot throw (thread_pool_a has no exception handling mechanism); use async/promise if you need errors.");
+				return job_impl_accept_parent<thread_pool_detail::remove_cvref_t<Task>>{std::forward<Task>(the_task)};
 			}
 
-			/*
-				Starts threads.
-			*/
-			void start()
+			template<typename Task>
+			job make_job(Task&& the_task) const
 			{
-				if(!this->_running)
+				if(metrics())
 				{
-					this->_running=true;
-					this->_active=true;
-					create_threads();
+					using impl=decltype(wrap_job(std::forward<Task>(the_task)));
+					return job(timed_job_impl<impl>{wrap_job(std::forward<Task>(the_task)),std::chrono::steady_clock::now()});
 				}
+				return job(wrap_job(std::forward<Task>(the_task)));
 			}
 
-			/*
-				Makes threads look for tasks. Useful after stop() has been called to reactivate job search.
-				Resets the args passed to the threads.
-			*/
-			template<typename... TupleArgs>
-			void reactivate(TupleArgs&& ... args)
-			{
-				set_args(std::forward<TupleArgs>(args)...);
-				this->reactivate();
-			}
+			using job_queue=thread_pool_detail::job_ring<job>;
 
-			/*
-				Waits for all jobs to be finished or for it to be stop()ed (be inactivated).
-				Threads keep running (if they already were), but tasks can be added without synchronization.
-			*/
-			void wait()
+			//most tasks a worker moves from the shared queue to its own deque at once
+			static constexpr size_t shared_batch_limit=32;
+			//index of extra workers started by elastic scaling, which have no deque or metrics of their own
+			static constexpr size_t elastic_id=static_cast<size_t>(-1);
+
+			//the deque owned by a worker in work stealing mode
+			struct worker_data {
+				std::mutex mtx;
+				job_queue jobs;
+				char padding[thread_pool_detail::cache_line_size];
+			};
+
+			//the queue of tasks hinted to a NUMA node
+			struct node_data {
+				std::mutex mtx;
+				job_queue jobs;
+				char padding[thread_pool_detail::cache_line_size];
+			};
+
+			//identifies the pool, index and NUMA node of the worker running on this thread, if any
+			struct worker_id {
+				thread_pool_a const* pool;
+				size_t index;
+				size_t node;
+			};
+
+			static worker_id& this_worker() noexcept
 			{
-				std::unique_lock<std::mutex> lock(this->_mtx);
-				this->_jobs_done.wait(lock,[this]
-					{
-						return this->idle();
-					});
+				static thread_local worker_id id{nullptr,0,0};
+				return id;
 			}
 
-			/*
-				Waits for all threads to become inactive.
-				Threads keep running (if they already were), but tasks can be added without synchronization.
-			*/
-			void wait_inactive()
+			//the deque of the calling thread if it is a worker of this pool in work stealing mode
+			worker_data* this_worker_data() const noexcept
 			{
-				std::unique_lock<std::mutex> lock(this->_mtx);
-				this->_jobs_done.wait(lock,[this]
-					{
-						return this->inactive();
-					});
+				auto const& id=this_worker();
+				if(id.pool==this&&id.index<_worker_data_count)
+				{
+					return &_worker_data[id.index];
+				}
+				return nullptr;
 			}
 
-			enum wait_state:bool {
-				wait_no_timeout=true,wait_timeout=false
-			};
-
-			/*
-				Waits for all jobs to be finished or to be stop()ed.
-				Returns false if timeout expired, otherwise true.
-			*/
-			template<typename Rep,typename Period>
-			wait_state wait_for(std::chrono::duration<Rep,Period> const& rel_time)
+			//the NUMA node of the calling thread if it is a worker of this pool, else 0
+			size_t this_node() const noexcept
 			{
-				auto absolute_time=std::chrono::steady_clock::now()+rel_time;
-				return wait_until(absolute_time);
+				auto const& id=this_worker();
+				return id.pool==this?id.node:0;
 			}
 
-			/*
-				Waits for all jobs to be finished or to be stop()ed.
-				Returns false if timeout expired, otherwise true.
-			*/
-			template<typename Clock,typename Duration>
-			wait_state wait_until(std::chrono::time_point<Clock,Duration> const& rel_time)
+			//the index of the calling thread if it is a core worker of this pool, else elastic_id
+			size_t this_index() const noexcept
 			{
-				std::unique_lock<std::mutex> lock(this->_mtx);
-				return this->_jobs_done.wait_until(lock,rel_time,[this]
-					{
-						return this->idle();
-					});
+				auto const& id=this_worker();
+				return id.pool==this?id.index:elastic_id;
 			}
 
-			/*
-				Waits for all threads to become inactive or to be stop()ed.
-				Returns false if timeout expired, otherwise true.
-			*/
-			template<typename Rep,typename Period>
-			wait_state wait_inactive_for(std::chrono::duration<Rep,Period> const& rel_time)
+			//stops running threads, calls change, then restarts them with the pool as active as before
+			template<typename Change>
+			void reconfigure(Change change)
 			{
-				auto absolute_time=std::chrono::steady_clock::now()+rel_time;
-				return wait_inactive_until(absolute_time);
+				bool const was_running=this->_running;
+				bool const was_active=this->_active;
+				if(was_running)
+				{
+					this->terminate();
+				}
+				change();
+				if(was_running)
+				{
+					this->_running=true;
+					this->_active=was_active;
+					create_threads();
+				}
 			}
 
-			/*
-				Waits for all jobs to be finished or to be stop()ed.
-				Returns false if timeout expired, otherwise true.
-			*/
-			template<typename Clock,typename Duration>
-			wait_state wait_inactive_until(std::chrono::time_point<Clock,Duration> const& rel_time)
+			//threads must not be running
+			void move_node_jobs_to_shared()
 			{
-				std::unique_lock<std::mutex> lock(this->_mtx);
-				return this->_jobs_done.wait_until(lock,rel_time,[this]
+				for(size_t i=0;i<_node_cpus.size();++i)
+				{
+					auto& hinted=_node_data[i].jobs;
+					while(!hinted.empty())
 					{
-						return this->inactive();
-					});
+						this->_jobs.push_back(hinted.pop_front());
+					}
+				}
+				this->_node_jobs=0;
 			}
 
-			/*
-				Makes threads stop looking for jobs and ends threads.
-			*/
-			void terminate()
+			//pins the calling worker as configured and returns its NUMA node
+			size_t place_worker(size_t id) noexcept
 			{
-				this->stop_running();
-				this->join_all();
+				if(!_node_cpus.empty())
+				{
+					size_t const node=id*_node_cpus.size()/num_threads();
+					thread_pool_detail::set_current_thread_affinity(_node_cpus[node]);
+					return node;
+				}
+				if(!_cpu_sets.empty())
+				{
+					thread_pool_detail::set_current_thread_affinity(_cpu_sets[id%_cpu_sets.size()]);
+				}
+				return 0;
 			}
 
 			/*
-				Waits for all jobs to finish and ends threads.
+				Tries to take a task from the queue of the worker's NUMA node, or else from another node's.
+				_active is checked under the node's lock, so tasks hinted after stop() returns are not taken.
+				On success the task is counted as active before it stops being counted as queued.
 			*/
-			void join()
+			bool find_node_job(job& task) noexcept
 			{
-				join_base();
-				this->join_all();
+				size_t const count=_node_cpus.size();
+				size_t const own=this_worker().node;
+				for(size_t i=0;i<count&&this->_node_jobs!=0;++i)
+				{
+					auto& data=_node_data[(own+i)%count];
+					std::unique_lock<std::mutex> guard(data.mtx,std::defer_lock);
+					if(i==0)
+					{
+						guard.lock();
+					}
+					else if(!guard.try_lock())
+					{
+						continue;
+					}
+					if(this->_active&&!data.jobs.empty())
+					{
+						task=data.jobs.pop_front();
+						++this->_active_thread_count;
+						--this->_node_jobs;
+						if(i!=0)
+						{
+							count_steal(this_index());
+						}
+						return true;
+					}
+				}
+				return false;
 			}
 
-			/*
-				calls join() and then does normal destruction
-			*/
-			~thread_pool_a() noexcept //if join errors, something's wrong with the threads and program should crash
+			template<typename Task>
+			void push_back_lane(size_t lane,Task&& task)
 			{
-				join_base();
+				this->_jobs.push_back(lane,make_job(std::forward<Task>(task)));
 			}
 
-			/*
-				Adds a task to the thread pool without synchronization.
-				Task must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
-			template<typename Task>
-			void push_back_no_sync(Task&& task)
+			template<typename FirstTask,typename... Rest>
+			void push_back_lane(size_t lane,FirstTask&& first,Rest&& ... rest)
 			{
-				this->_jobs.push_back(make_job(std::forward<Task>(task)));
+				push_back_lane(lane,std::forward<FirstTask>(first));
+				push_back_lane(lane,std::forward<Rest>(rest)...);
 			}
 
-			/*
-				Adds a task to the front of thread pool without synchronization.
-				Task must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
 			template<typename Task>
-			void push_front_no_sync(Task&& task)
+			void push_deadline_lane(size_t lane,std::chrono::steady_clock::time_point deadline,Task&& task)
 			{
-				this->_jobs.push_front(make_job(std::forward<Task>(task)));
+				this->_jobs.push_deadline(lane,deadline,make_job(std::forward<Task>(task)));
 			}
 
-			/*
-				Adds tasks to the thread pool without synchronization.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
 			template<typename FirstTask,typename... Rest>
-			void push_back_no_sync(FirstTask&& first,Rest&& ... rest)
+			void push_deadline_lane(size_t lane,std::chrono::steady_clock::time_point deadline,FirstTask&& first,Rest&& ... rest)
 			{
-				push_back_no_sync(std::forward<FirstTask>(first));
-				push_back_no_sync(std::forward<Rest>(rest)...);
+				push_deadline_lane(lane,deadline,std::forward<FirstTask>(first));
+				push_deadline_lane(lane,deadline,std::forward<Rest>(rest)...);
 			}
 
-			/*
-				Adds tasks to the front of the thread pool without synchronization.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
-			template<typename FirstTask,typename... Rest>
-			void push_front_no_sync(FirstTask&& first,Rest&& ... rest)
+			template<typename Task>
+			void push_back_local(job_queue& queue,Task&& task)
 			{
-				push_front_no_sync(std::forward<FirstTask>(first));
-				push_front_no_sync(std::forward<Rest>(rest)...);
+				queue.push_back(make_job(std::forward<Task>(task)));
 			}
 
-			/*
-				Adds task(s) to the thread pool with synchronization and wakes an appropriate number of threads.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
-			template<typename... Tasks>
-			void push_back(Tasks&& ... tasks)
+			template<typename FirstTask,typename... Rest>
+			void push_back_local(job_queue& queue,FirstTask&& first,Rest&& ... rest)
 			{
-				{
-					std::lock_guard<std::mutex> guard(this->_mtx);
-					push_back_no_sync(std::forward<Tasks>(tasks)...);
-				}
-				this->notify_count(sizeof...(Tasks));
+				push_back_local(queue,std::forward<FirstTask>(first));
+				push_back_local(queue,std::forward<Rest>(rest)...);
 			}
 
-			/*
-				Adds task(s) to the front of the thread pool with synchronization and wakes an appropriate number of threads.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-			*/
-			template<typename... Tasks>
-			void push_front(Tasks&& ... tasks)
+#ifdef EXLIB_THREAD_POOL_MPMC
+			//counts the job before it is pushed, so the pool is never seen as idle while it is queued
+			template<typename Task>
+			void push_back_lock_free(Task&& task)
 			{
+				job pushed=make_job(std::forward<Task>(task));
+				++this->_lock_free_jobs;
+				if(!_lock_free->try_push(std::move(pushed)))
 				{
+					--this->_lock_free_jobs;
 					std::lock_guard<std::mutex> guard(this->_mtx);
-					push_front_no_sync(std::forward<Tasks>(tasks)...);
+					this->_jobs.push_back(std::move(pushed));
 				}
-				this->notify_count(sizeof...(Tasks));
-			}
-
-			/*
-				Adds task(s) to the thread pool without synchronization reading	from the given iterators.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-				Returns the number of tasks added.
-			*/
-			template<typename Iter>
-			size_t append_no_sync(Iter begin,Iter end)
-			{
-				using category=typename std::iterator_traits<Iter>::iterator_category;
-				return append_no_sync(begin,end,category{});
 			}
 
-			/*
-				Adds task(s) to the front of the thread pool without synchronization reading from the given iterators.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-				Returns the number of tasks added.
-			*/
-			template<typename Iter>
-			size_t prepend_no_sync(Iter begin,Iter end)
+			template<typename FirstTask,typename... Rest>
+			void push_back_lock_free(FirstTask&& first,Rest&& ... rest)
 			{
-				using category=typename std::iterator_traits<Iter>::iterator_category;
-				return prepend_no_sync(begin,end,category{});
+				push_back_lock_free(std::forward<FirstTask>(first));
+				push_back_lock_free(std::forward<Rest>(rest)...);
 			}
 
-			/*
-				Adds task(s) to the thread pool with synchronization and wakes an appropriate number of threads reading
-				from the given iterators.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-				Returns the number of tasks added.
-			*/
+			//pushes batches of up to shared_batch_limit jobs, each claiming its slots in the lock-free queue at once
 			template<typename Iter>
-			size_t append(Iter begin,Iter end)
+			size_t append_lock_free(Iter begin,Iter end)
 			{
-				size_t count;
+				size_t count=0;
+				job staged[shared_batch_limit];
+				while(begin!=end)
 				{
-					std::lock_guard<std::mutex> guard(this->_mtx);
-					count=append_no_sync(begin,end);
+					size_t n=0;
+					for(;n<shared_batch_limit&&begin!=end;++n,++begin)
+					{
+						staged[n]=make_job(*begin);
+					}
+					this->_lock_free_jobs+=n;
+					auto const pushed=_lock_free->try_push_n(std::make_move_iterator(staged),n);
+					if(pushed!=n)
+					{
+						this->_lock_free_jobs-=n-pushed;
+						std::lock_guard<std::mutex> guard(this->_mtx);
+						for(size_t i=pushed;i<n;++i)
+						{
+							this->_jobs.push_back(std::move(staged[i]));
+						}
+					}
+					count+=n;
 				}
-				this->notify_count(count);
 				return count;
 			}
+#endif
 
 			/*
-				Adds task(s) to the front of the thread pool with synchronization and wakes an appropriate number of threads reading
-				from the given iterators.
-				Tasks must define operator() that can take in Args...
-				or optionally parent_ref as a first argument and then Args...
-				Returns the number of tasks added.
+				Takes a task from the lock-free queue, if there is one.
+				On success the task is counted as active before it stops being counted as queued.
+				A task popped after the pool was stopped goes to the shared queue, so tasks pushed after stop() returns do not run.
 			*/
-			template<typename Iter>
-			size_t prepend(Iter begin,Iter end)
+			bool pop_lock_free(job& task) noexcept
 			{
-				size_t count;
+#ifdef EXLIB_THREAD_POOL_MPMC
+				if(this->_lock_free_jobs!=0&&_lock_free->try_pop(task))
 				{
-					std::lock_guard<std::mutex> guard(this->_mtx);
-					count=prepend_no_sync(begin,end);
+					if(!this->_active)
+					{
+						{
+							std::lock_guard<std::mutex> guard(this->_mtx);
+							this->_jobs.push_back(std::move(task));
+						}
+						--this->_lock_free_jobs;
+						return false;
+					}
+					++this->_active_thread_count;
+					--this->_lock_free_jobs;
+					return true;
 				}
-				this->notify_count(count);
-				return count;
-			}
-
-			/*
-				Clears the jobs handled by this threadpool without synchronization.
-			*/
-			void clear_no_sync() noexcept
-			{
-				this->_jobs.clear();
+#else
+				(void)task;
+#endif
+				return false;
 			}
 
 			/*
-				Clears the jobs handled by this threadpool.
+				Wakes sleeping threads after count tasks were pushed onto a worker's deque, a node's queue, or the lock-free queue.
+				The queue is pushed to and its count (see unshared_jobs) incremented before _sleeping is read,
+				while sleepers increment _sleeping before reading those counts, so one of the two sees the other.
 			*/
-			void clear()
+			void notify_local(size_t count)
 			{
-				std::lock_guard<std::mutex> guard(this->_mtx);
-				this->clear_no_sync();
+				if(this->_sleeping!=0)
+				{
+					{
+						std::lock_guard<std::mutex> lock{this->_mtx};
+					}
+					this->notify_count(count);
+				}
 			}
 
 			/*
-				Changes the number of threads.
+				Moves any tasks left in the workers' deques to the shared queue and
+				allocates new deques if in work stealing mode. Threads must not be running.
 			*/
-			void num_threads(size_t size)
+			void reset_worker_data()
 			{
-				assert(size!=0);
-				if(size==num_threads())
-				{
-					return;
-				}
-				if(this->_running)
-				{
-					if(size>this->_workers.size())
-					{
-						make_worker_t maker{this};
-						struct count_iter {
-							using iterator_category=std::random_access_iterator_tag;
-							using difference_type=std::ptrdiff_t;
-							using value_type=size_t;
-							using reference=value_type;
-							using pointer=value_type const*;
-							size_t _count;
-							size_t operator*() const
-							{
-								return _count;
-							}
-							pointer operator->() const
-							{
-								return &_count;
-							}
-							std::ptrdiff_t operator-(count_iter o) const
-							{
-								return _count-o._count;
-							}
-							count_iter& operator++()
-							{
-								++_count;
-								return *this;
-							}
-							count_iter operator--()
-							{
-								auto copy{*this};
-								++_count;
-								return *this;
-							}
-							bool operator==(count_iter o) const
-							{
-								return _count==o._count;
-							}
-							bool operator!=(count_iter o) const
-							{
-								return _count!=o._count;
-							}
-						};
-						auto begin=thread_pool_detail::make_transform_iterator(count_iter{0},maker);
-						decltype(begin) end{count_iter{this->_workers.size()}};
-						_workers.insert(_workers.end(),begin,end);
+				for(size_t i=0;i<_worker_data_count;++i)
+				{
+					auto& local=_worker_data[i].jobs;
+					while(!local.empty())
+					{
+						this->_jobs.push_back(local.pop_front());
 					}
-					else
+				}
+				this->_local_jobs=0;
+				_worker_data.reset();
+				_worker_data_count=0;
+				if(this->_work_stealing)
+				{
+					_worker_data.reset(new worker_data[this->_workers.size()]);
+					_worker_data_count=this->_workers.size();
+					for(size_t i=0;i<_worker_data_count;++i)
 					{
-						this->terminate();
-						this->_workers.resize(size);
-						this->start();
+						_worker_data[i].jobs.reserve(2*shared_batch_limit);
 					}
 				}
-				else
+				if(_metrics)
 				{
-					this->_workers.resize(size);
+					std::lock_guard<std::mutex> guard(_metrics_mtx);
+					_metrics.reset(new thread_pool_detail::worker_metrics[this->_workers.size()]);
+					_metrics_count=this->_workers.size();
 				}
 			}
 
 			/*
-				The number of threads.
+				Tries to take a task from the worker's own deque, or else steal one from another worker.
+				On success the task is counted as active before it stops being counted as queued.
 			*/
-			_EXLIB_THREAD_POOL_NODISCARD size_t num_threads() const noexcept
+			bool find_local_job(size_t id,job& task) noexcept
 			{
-				return this->_workers.size();
+				{
+					auto& own=_worker_data[id];
+					std::lock_guard<std::mutex> guard(own.mtx);
+					if(!own.jobs.empty())
+					{
+						task=own.jobs.pop_back();
+						++this->_active_thread_count;
+						--this->_local_jobs;
+						return true;
+					}
+				}
+				return steal_local_job(id,id+1,task);
 			}
 
-			/*
-				The number of jobs left.
-			*/
-			_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs() const
+			//steals the oldest task from the first uncontended deque, starting from start and skipping the deque of worker id
+			bool steal_local_job(size_t id,size_t start,job& task) noexcept
 			{
-				std::unique_lock<std::mutex> lock(this->_mtx);
-				return num_jobs_no_sync();
+				for(size_t i=0;i<_worker_data_count&&this->_local_jobs!=0;++i)
+				{
+					auto const index=(start+i)%_worker_data_count;
+					if(index==id)
+					{
+						continue;
+					}
+					auto& victim=_worker_data[index];
+					std::unique_lock<std::mutex> guard(victim.mtx,std::try_to_lock);
+					if(guard.owns_lock()&&!victim.jobs.empty())
+					{
+						task=victim.jobs.pop_front();
+						++this->_active_thread_count;
+						--this->_local_jobs;
+						count_steal(id);
+						return true;
+					}
+				}
+				return false;
 			}
 
 			/*
-				The number of jobs left read unsynchronized from the job queue.
+				Takes a task from the shared queue, moving a share of the rest into the worker's deque
+				so that a large batch pushed from outside the pool gets spread without contending on _mtx.
+				Only bulk jobs are moved, as prioritized jobs would wait behind the worker's current task.
+				Must hold _mtx.
 			*/
-			_EXLIB_THREAD_POOL_NODISCARD size_t num_jobs_no_sync() const noexcept
+			void take_shared_jobs(size_t id,job& task)
 			{
-				return this->_jobs.size();
+				bool bulk;
+				task=this->_jobs.pop_front(bulk);
+				++this->_active_thread_count;
+				auto const batch=bulk?std::min(this->_jobs.bulk_size()/_worker_data_count,size_t{shared_batch_limit}):0;
+				if(batch!=0)
+				{
+					auto& own=_worker_data[id];
+					{
+						std::lock_guard<std::mutex> guard(own.mtx);
+						this->_jobs.move_bulk_to(own.jobs,batch);
+						this->_local_jobs+=batch;
+					}
+					if(this->_sleeping!=0)
+					{
+						this->notify_count(batch);
+					}
+				}
 			}
 
-			/*
-				Whether job queue is empty.
-			*/
-			_EXLIB_THREAD_POOL_NODISCARD bool empty() const
+			static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) noexcept
 			{
-				return num_jobs()==0;
+				return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count());
 			}
 
-			/*
-				Whether job queue is empty read unsynchronized from the job queue.
-			*/
-			_EXLIB_THREAD_POOL_NODISCARD bool empty_no_sync() const noexcept
+			std::unique_lock<std::mutex> lock_jobs(size_t id)
 			{
-				return num_jobs()==0;
+				if(id==elastic_id||!_metrics)
+				{
+					return std::unique_lock<std::mutex>(this->_mtx);
+				}
+				auto const start=std::chrono::steady_clock::now();
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				_metrics[id].lock_wait_ns.add(elapsed_ns(start));
+				return lock;
 			}
 
-			/*
-				Returns a future representing the result of running the given task asynchronously.
-			*/
-			template<typename Task>
-			_EXLIB_THREAD_POOL_NODISCARD auto async(Task&& task) -> std::future<decltype(thread_pool_detail::fake_invoke<parent_ref,Args...>(std::forward<Task>(task)))>
+			void wait_for_jobs(size_t id,std::unique_lock<std::mutex>& lock)
 			{
-				thread_pool_detail::TaskDoer<Task,parent_ref,Args...> doer{std::forward<Task>(task)};
-				auto future=doer.promise.get_future();
-				push_back(std::move(doer));
-				return future;
+				if(!_metrics)
+				{
+					this->_signal_start.wait(lock);
+					return;
+				}
+				auto const start=std::chrono::steady_clock::now();
+				this->_signal_start.wait(lock);
+				_metrics[id].idle_ns.add(elapsed_ns(start));
 			}
 
-			/*
-				Returns a future representing the result of running the given task asynchronously.
-			*/
-			template<typename Task,typename... Extra>
-			_EXLIB_THREAD_POOL_NODISCARD auto async(Task&& task,Extra...) -> std::future<decltype(thread_pool_detail::fake_invoke<Args...>(std::forward<Task>(task)))>
+			//true if woken before the timeout
+			bool wait_for_jobs(std::unique_lock<std::mutex>& lock,std::chrono::milliseconds timeout)
 			{
-				static_assert(sizeof...(Extra)==0,"These arguments are only for SFINAE. Use lambda capture/bind if you want to arguments passed to a functor.");
-				thread_pool_detail::TaskDoer<Task,Args...> doer{std::forward<Task>(task)};
-				auto future=doer.promise.get_future();
-				push_back(std::move(doer));
-				return future;
+				return this->_signal_start.wait_for(lock,timeout)==std::cv_status::no_timeout;
 			}
 
-		private:
-
-			void join_base()
+			void count_steal(size_t id) noexcept
 			{
-				wait();
-				this->_active=false;
-				this->_running=false;
-				this->_signal_start.notify_all();
+				if(id!=elastic_id&&_metrics)
+				{
+					_metrics[id].steals.add(1);
+				}
 			}
 
-			friend struct make_worker_t;
-			struct make_worker_t {
-				thread_pool_a* parent;
-				thread_pool_detail::joining_thread operator()(size_t const&) const
+			void record_latency(std::chrono::steady_clock::time_point enqueued) noexcept
+			{
+				auto const id=this_index();
+				if(id!=elastic_id&&_metrics)
 				{
-					return thread_pool_detail::joining_thread(&thread_pool_a::task_loop,parent);
+					auto const bucket=thread_pool_detail::latency_bucket(std::chrono::steady_clock::now()-enqueued);
+					_metrics[id].latency[bucket].add(1);
 				}
-			};
+			}
 
-			friend struct make_job_functor_t;
-			template<typename Iter>
-			size_t append_no_sync(Iter begin,Iter end,std::random_access_iterator_tag)
+			void run_job(size_t id,job& task) noexcept
 			{
-				auto gbegin=thread_pool_detail::make_transform_iterator(begin,make_job_functor_t{});
-				auto gend=thread_pool_detail::make_transform_iterator(end,make_job_functor_t{});
-				this->_jobs.insert(this->_jobs.end(),gbegin,gend);
-				return end-begin;
+				execute_job(id,task);
+				this_thread_arena().reset();
+				finish_job();
 			}
-			template<typename Iter>
-			size_t append_no_sync(Iter begin,Iter end,std::input_iterator_tag)
+
+			//runs a job inside another task on the same thread, which may still be using the arena
+			void run_nested_job(size_t id,job& task) noexcept
 			{
-				size_t count=0;
-				using input_type=typename std::iterator_traits<Iter>::reference;
-				std::for_each(begin,end,[this,&count](input_type task)
-					{
-						this->push_back_no_sync(std::forward<input_type>(task));
-						++count;
-					});
-				return count;
+				worker_arena::scope const arena_scope{this_thread_arena()};
+				execute_job(id,task);
+				finish_job();
 			}
-			template<typename Iter>
-			size_t prepend_no_sync(Iter begin,Iter end,std::random_access_iterator_tag)
+
+			void execute_job(size_t id,job& task) noexcept
 			{
-				auto gbegin=thread_pool_detail::make_transform_iterator(begin,make_job_functor_t{});
-				auto gend=thread_pool_detail::make_transform_iterator(end,make_job_functor_t{});
-				this->_jobs.insert(_jobs.begin(),gbegin,gend);
-				return end-begin;
+				if(id!=elastic_id&&_metrics)
+				{
+					auto const start=std::chrono::steady_clock::now();
+					task(parent_ref{*this},this->_input);
+					auto& metrics=_metrics[id];
+					metrics.busy_ns.add(elapsed_ns(start));
+					metrics.tasks_executed.add(1);
+				}
+				else
+				{
+					task(parent_ref{*this},this->_input);
+				}
+				task.reset();
 			}
-			template<typename Iter>
-			size_t prepend_no_sync(Iter begin,Iter end,std::input_iterator_tag)
+
+			void finish_job() noexcept
 			{
-				size_t count=0;
-				using input_type=typename std::iterator_traits<Iter>::reference;
-				std::for_each(begin,end,[this,&count](input_type task)
+				auto const active=--this->_active_thread_count;
+				if(active==0)
+				{
 					{
-						this->push_front_no_sync(std::forward<input_type>(task));
-						++count;
-					});
-				return count;
-			}
-			bool idle() const noexcept
-			{
-				return !this->_active||(this->_jobs.empty()&&this->_active_thread_count==0);
+						std::lock_guard<std::mutex> lock{this->_mtx};
+					}
+					this->_jobs_done.notify_all();
+				}
 			}
-			bool inactive() const noexcept
+
+			/*
+				Runs one queued job on the calling thread, for a thread waiting on other tasks to help instead of sleeping.
+				Looks where the calling thread would as a worker, so a worker in work stealing mode takes the newest task of its own deque first.
+				Returns false if no job was found.
+			*/
+			bool run_queued_job()
 			{
-				return (this->_active_thread_count==0)&&(!this->_active||this->_jobs.empty());
+				size_t const id=this_index();
+				job task;
+				if(!this->_active)
+				{
+					return false;
+				}
+				if(this->_jobs.urgent()==0)
+				{
+					bool const found=(id<_worker_data_count?find_local_job(id,task):steal_local_job(elastic_id,0,task))
+						||find_node_job(task)||pop_lock_free(task);
+					if(found)
+					{
+						run_nested_job(id,task);
+						return true;
+					}
+				}
+				{
+					std::lock_guard<std::mutex> lock(this->_mtx);
+					if(this->_jobs.empty())
+					{
+						return false;
+					}
+					task=this->_jobs.pop_front();
+					++this->_active_thread_count;
+				}
+				run_nested_job(id,task);
+				return true;
 			}
-			void create_threads()
+
+			void task_loop(size_t id) noexcept
 			{
-				assert(num_threads()!=0);
-				this->_active_thread_count=0;
-				for(auto& worker:this->_workers)
+				this_worker()=worker_id{this,id,place_worker(id)};
+				if(this->_work_stealing)
 				{
-					worker=thread_pool_detail::joining_thread(&thread_pool_a::task_loop,this);
+					stealing_task_loop(id);
 				}
-			}
-			using TaskInput=std::tuple<thread_pool_detail::wrap_reference_t<Args>...>;
-			struct job {
-				virtual void operator()(parent_ref,TaskInput const& input) noexcept=0;
-				virtual ~job()=default;
-			};
-			template<typename BaseFunc>
-			struct job_impl:job {
-				BaseFunc task;
-				template<typename F>
-				job_impl(F&& f):task(std::forward<F>(f))
-				{}
-				void operator()(parent_ref,TaskInput const& input) noexcept override
+				else
 				{
-					thread_pool_detail::apply(task,input);
+					shared_task_loop(id);
 				}
-			};
-			template<typename BaseFunc>
-			struct job_impl_accept_parent:job {
-				BaseFunc task;
-				template<typename F>
-				job_impl_accept_parent(F&& f):task(std::forward<F>(f))
-				{}
-				void operator()(parent_ref tp,TaskInput const& input) noexcept override
+				this_worker()=worker_id{nullptr,0,0};
+			}
+
+			void shared_task_loop(size_t id) noexcept
+			{
+				job task;
+				while(true)
 				{
-					thread_pool_detail::apply_fa(task,tp,input);
+					if(!this->_running)
+					{
+						return; //don't bother locking if not running
+					}
+					if(this->_active&&this->_jobs.urgent()==0&&(find_node_job(task)||pop_lock_free(task)))
+					{
+						run_job(id,task);
+						continue;
+					}
+					{
+						auto lock=lock_jobs(id);
+						while(true)
+						{
+							if(!this->_running)
+							{
+								return;
+							}
+							if(this->_active)
+							{
+								if(!this->_jobs.empty())
+								{
+									task=this->_jobs.pop_front();
+									++this->_active_thread_count;
+									break;
+								}
+								++this->_sleeping;
+								if(this->_lock_free_jobs!=0||this->_node_jobs!=0)
+								{
+									--this->_sleeping;
+									break;
+								}
+							}
+							else
+							{
+								++this->_sleeping;
+							}
+							wait_for_jobs(id,lock);
+							--this->_sleeping;
+						}
+					}
+					if(task)
+					{
+						run_job(id,task);
+					}
 				}
-			};
+			}
 
-			struct make_job_functor_t {
-				template<typename Task>
-				std::unique_ptr<job> operator()(Task&& task) const
+			void stealing_task_loop(size_t id) noexcept
+			{
+				job task;
+				while(true)
 				{
-					return thread_pool_a::make_job(std::forward<Task>(task));
+					if(!this->_running)
+					{
+						return;
+					}
+					//prioritized jobs in the shared queue go ahead of the workers' deques
+					if(this->_active&&this->_jobs.urgent()==0&&(find_local_job(id,task)||find_node_job(task)||pop_lock_free(task)))
+					{
+						run_job(id,task);
+						continue;
+					}
+					{
+						auto lock=lock_jobs(id);
+						while(true)
+						{
+							if(!this->_running)
+							{
+								return;
+							}
+							if(this->_active)
+							{
+								if(!this->_jobs.empty())
+								{
+									take_shared_jobs(id,task);
+									break;
+								}
+								++this->_sleeping;
+								if(unshared_jobs()!=0)
+								{
+									--this->_sleeping;
+									break;
+								}
+							}
+							else
+							{
+								++this->_sleeping;
+							}
+							wait_for_jobs(id,lock);
+							--this->_sleeping;
+						}
+					}
+					if(task)
+					{
+						run_job(id,task);
+					}
 				}
-			};
+			}
 
-			//overload to try to fit to pass arguments without parent
-			template<typename Task,typename... Extra>
-			static std::unique_ptr<job> make_job(Task&& the_task,Extra...)
+			/*
+				Starts an extra worker if elastic scaling allows another thread. Must hold _mtx.
+			*/
+			bool spawn_elastic() noexcept
 			{
-				return make_job2(std::forward<Task>(the_task));
+				if(!this->_running||num_threads()+_elastic_count>=_max_threads)
+				{
+					return false;
+				}
+				try
+				{
+					std::thread(&thread_pool_a::elastic_task_loop,this,_elastic_count).detach();
+				}
+				catch(std::system_error const&)
+				{
+					return false;
+				}
+				++_elastic_count;
+				return true;
 			}
 
-			//overload to try to fit to pass arguments with parent
-			template<typename Task>
-			static auto make_job(Task&& the_task) -> decltype(thread_pool_detail::fake_invoke<parent_ref,Args...>(std::forward<Task>(the_task)),std::unique_ptr<job>())
+			/*
+				Called every check interval. Grows the pool if tasks were queued with no worker free at this check and the last.
+			*/
+			void supervise()
 			{
-				using decayed=typename std::decay<Task>::type;
-				static_assert(noexcept(std::declval<decayed&>()(std::declval<parent_ref>(),std::declval<Args>()...)),"Tasks cannot throw (thread_pool_a has no exception handling mechanism); use async/promise if you need errors.");
-				return std::unique_ptr<job>(new job_impl_accept_parent<thread_pool_detail::remove_cvref_t<Task>>(std::forward<Task>(the_task)));
+				std::lock_guard<std::mutex> guard(this->_mtx);
+				bool const backlogged=this->_active&&this->_sleeping==0&&(!this->_jobs.empty()||unshared_jobs()!=0);
+				if(backlogged&&_backlogged)
+				{
+					spawn_elastic();
+				}
+				_backlogged=backlogged;
 			}
 
-			template<typename Task,typename... Extra>
-			static std::unique_ptr<job> make_job2(Task&& the_task,Extra...)
+			void retire_elastic_worker()
 			{
-				static_assert(!std::is_same<Task,Task>::value,"Task fails to accepts proper arguments; must accept (parent_ref, Args...), or (Args...)");
+				{
+					std::lock_guard<std::mutex> guard(this->_mtx);
+					if(_retire_requests>=_elastic_count)
+					{
+						return;
+					}
+					++_retire_requests;
+				}
+				this->_signal_start.notify_all();
 			}
 
-			template<typename Task>
-			static auto make_job2(Task&& the_task) -> decltype(thread_pool_detail::fake_invoke<Args...>(std::forward<Task>(the_task)),std::unique_ptr<job>())
+			/*
+				Waits for the extra workers to exit. _running must be false.
+			*/
+			void join_elastic()
 			{
-				using decayed=typename std::decay<Task>::type;
-				static_assert(noexcept(std::declval<decayed&>()(std::declval<Args>()...)),"Tasks cannot throw (thread_pool_a has no exception handling mechanism); use async/promise if you need errors.");
-				return std::unique_ptr<job>(new job_impl<thread_pool_detail::remove_cvref_t<Task>>(std::forward<Task>(the_task)));
+				std::unique_lock<std::mutex> lock(this->_mtx);
+				this->_signal_start.notify_all();
+				_elastic_exited.wait(lock,[this]
+					{
+						return _elastic_count==0;
+					});
+				_retire_requests=0;
 			}
 
-			void task_loop() noexcept
+			/*
+				Loop of an extra worker, which exits when the pool stops running, after idle_timeout without work or when asked to retire.
+				It is detached, so it must not touch the pool after releasing _mtx for the last time.
+			*/
+			void elastic_task_loop(size_t ordinal) noexcept
 			{
-				std::unique_ptr<job> task;
+				this_worker()=worker_id{this,elastic_id,0};
+				job task;
+				auto lock=std::unique_lock<std::mutex>(this->_mtx,std::defer_lock);
 				while(true)
 				{
+					if(this->_running&&this->_active&&this->_jobs.urgent()==0&&(steal_local_job(elastic_id,ordinal,task)||find_node_job(task)||pop_lock_free(task)))
+					{
+						run_job(elastic_id,task);
+						continue;
+					}
+					lock.lock();
+					bool timed_out=false;
+					while(true)
 					{
 						if(!this->_running)
 						{
-							return; //don't bother locking if not running
+							goto exit;
 						}
-						std::unique_lock<std::mutex> lock{this->_mtx};
-						while(true)
+						if(this->_active)
 						{
-							if(!this->_running)
+							if(!this->_jobs.empty())
 							{
-								return;
+								task=this->_jobs.pop_front();
+								++this->_active_thread_count;
+								break;
 							}
-							if(this->_active&&!this->_jobs.empty())
+							++this->_sleeping;
+							if(unshared_jobs()!=0)
 							{
-								task=std::move(this->_jobs.front());
-								this->_jobs.pop_front();
-								++this->_active_thread_count;
+								--this->_sleeping;
 								break;
 							}
-							this->_signal_start.wait(lock);
 						}
-					}
-					(*task)(parent_ref{*this},this->_input);
-					task.reset();
-					auto const active=--this->_active_thread_count;
-					if(active==0)
-					{
+						else
 						{
-							std::lock_guard<std::mutex> lock{this->_mtx};
+							++this->_sleeping;
 						}
-						this->_jobs_done.notify_all();
+						if(timed_out||_retire_requests!=0)
+						{
+							--this->_sleeping;
+							goto exit;
+						}
+						timed_out=!wait_for_jobs(lock,_idle_timeout);
+						--this->_sleeping;
+					}
+					lock.unlock();
+					if(task)
+					{
+						run_job(elastic_id,task);
 					}
 				}
+			exit:
+				this_worker()=worker_id{nullptr,0,0};
+				--_elastic_count;
+				if(_retire_requests!=0)
+				{
+					--_retire_requests;
+				}
+				_elastic_exited.notify_all();
 			}
-			std::deque<std::unique_ptr<job>> _jobs;
+
+			thread_pool_detail::job_lanes<job> _jobs;
 			TaskInput _input;
+			std::unique_ptr<worker_data[]> _worker_data;
+			size_t _worker_data_count=0;
+			//number of tasks in the workers' deques
+			std::atomic<size_t> _local_jobs{0};
+#ifdef EXLIB_THREAD_POOL_MPMC
+			using lock_free_queue_type=mpmc_queue<job>;
+			std::unique_ptr<lock_free_queue_type> _lock_free;
+#endif
+			//number of tasks in the lock-free queue
+			std::atomic<size_t> _lock_free_jobs{0};
+			//CPUs of each NUMA node, if NUMA aware
+			std::vector<std::vector<unsigned>> _node_cpus;
+			std::unique_ptr<node_data[]> _node_data;
+			//number of tasks in the nodes' queues
+			std::atomic<size_t> _node_jobs{0};
+			//CPUs to pin workers to if not NUMA aware
+			std::vector<std::vector<unsigned>> _cpu_sets;
+			//one per worker if metrics are enabled; only workers read it, as it is replaced while they are stopped
+			std::unique_ptr<thread_pool_detail::worker_metrics[]> _metrics;
+			//the number of workers _metrics has counters for; guarded by _metrics_mtx
+			size_t _metrics_count=0;
+			//whether _metrics is set, for threads pushing tasks
+			std::atomic<bool> _metrics_on{false};
+			//held while _metrics is replaced or read by stats(), which the metrics_callback calls from its own thread
+			std::mutex mutable _metrics_mtx;
+			//last, so it stops calling stats() before anything else is destroyed
+			std::unique_ptr<thread_pool_detail::periodic_caller> _reporter;
+			//elastic scaling is off if 0
+			size_t _max_threads=0;
+			std::chrono::milliseconds _idle_timeout{1000};
+			std::chrono::milliseconds _check_interval{10};
+			//extra workers running and extra workers asked to exit, both guarded by _mtx
+			size_t _elastic_count=0;
+			size_t _retire_requests=0;
+			//only touched by the supervisor
+			bool _backlogged=false;
+			std::condition_variable _elastic_exited;
+			//declared after _reporter, so it stops growing the pool first
+			std::unique_ptr<thread_pool_detail::periodic_caller> _supervisor;
+			bool _work_stealing=false;
+			//timers and the thread that pushes them, started by the first timer and stopped before the workers are joined
+			std::mutex mutable _timer_mtx;
+			std::condition_variable _timer_cv;
+			timer_wheel<timer_job> _timers;
+			std::chrono::steady_clock::time_point _timer_start;
+			//tick the timer thread sleeps until
+			timer_tick _timer_wake=0;
+			bool _timer_stop=false;
+			//set by join and the destructor, cleared by start
+			bool _timers_closed=false;
+			//last, so it stops before the rest of the timer state is destroyed
+			thread_pool_detail::joining_thread _timer_thread;
 		};
 	}
 
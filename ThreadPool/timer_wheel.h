@@ -0,0 +1,455 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXLIB_TIMER_WHEEL_H
+#define EXLIB_TIMER_WHEEL_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <assert.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+namespace exlib {
+
+	/*
+		Identifies a timer of a timer_wheel. Stays safe to cancel after the timer has fired or been cancelled.
+		A default constructed handle refers to no timer.
+	*/
+	struct timer_handle {
+		std::uint32_t index=0xFFFFFFFF;
+		std::uint32_t generation=0;
+
+		timer_handle() noexcept=default;
+		timer_handle(std::uint32_t index,std::uint32_t generation) noexcept:index(index),generation(generation)
+		{}
+
+		explicit operator bool() const noexcept
+		{
+			return index!=0xFFFFFFFF;
+		}
+	};
+
+	/*
+		A hierarchical timing wheel holding Tasks due at integer ticks, with O(1) insert and cancel.
+		Four levels of 256 slots cover 2^32 ticks ahead; timers further out wait in an overflow list.
+		A timer sits in the level of the highest base 256 digit in which its expiry differs from the current tick,
+		and moves down a level each time the current tick reaches its slot, so each timer is moved at most once per level.
+		Timers live in chunks that are reused once freed, so a wheel at its high water mark does not allocate.
+		Task must be default constructible and nothrow move assignable. Not thread safe.
+	*/
+	template<typename Task>
+	class timer_wheel {
+	public:
+		using tick_type=std::uint64_t;
+	private:
+		static constexpr unsigned slot_bits=8;
+		static constexpr std::size_t slot_count=std::size_t(1)<<slot_bits;
+		static constexpr unsigned level_count=4;
+		//slot of the list of timers beyond the last level
+		static constexpr std::size_t overflow_slot=level_count*slot_count;
+		static constexpr std::uint32_t nil=0xFFFFFFFF;
+		static constexpr unsigned chunk_bits=12;
+		static constexpr std::size_t chunk_size=std::size_t(1)<<chunk_bits;
+		static constexpr std::size_t word_bits=64;
+		static constexpr std::size_t words_per_level=slot_count/word_bits;
+
+		struct node {
+			Task task;
+			tick_type expiry=0;
+			//0 if the timer fires once
+			tick_type period=0;
+			std::uint32_t prev=nil;
+			std::uint32_t next=nil;
+			std::uint32_t generation=0;
+			//list the node is in, or nil if free
+			std::uint32_t slot=nil;
+		};
+
+		std::vector<std::unique_ptr<node[]>> _chunks;
+		//heads of each slot's list and the overflow list, allocated by the first insert
+		std::unique_ptr<std::uint32_t[]> _heads;
+		std::uint32_t _free=nil;
+		std::uint32_t _capacity=0;
+		std::size_t _size=0;
+		tick_type _now=0;
+		//which slots of each level have timers, so the next one can be found without visiting empty slots
+		std::uint64_t _occupied[level_count][words_per_level]={};
+
+		node& at(std::uint32_t index) noexcept
+		{
+			return _chunks[index>>chunk_bits][index&(chunk_size-1)];
+		}
+
+		node const& at(std::uint32_t index) const noexcept
+		{
+			return _chunks[index>>chunk_bits][index&(chunk_size-1)];
+		}
+
+		static std::size_t digit(tick_type tick,unsigned level) noexcept
+		{
+			return static_cast<std::size_t>(tick>>(level*slot_bits))&(slot_count-1);
+		}
+
+		static unsigned lowest_bit(std::uint64_t word) noexcept
+		{
+#if defined(_MSC_VER)&&defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index,word);
+			return index;
+#elif defined(__GNUC__)
+			return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+			unsigned index=0;
+			for(;!(word&1);word>>=1)
+			{
+				++index;
+			}
+			return index;
+#endif
+		}
+
+		void mark(std::size_t slot) noexcept
+		{
+			if(slot<overflow_slot)
+			{
+				_occupied[slot/slot_count][slot%slot_count/word_bits]|=std::uint64_t(1)<<(slot%word_bits);
+			}
+		}
+
+		void unmark(std::size_t slot) noexcept
+		{
+			if(slot<overflow_slot)
+			{
+				_occupied[slot/slot_count][slot%slot_count/word_bits]&=~(std::uint64_t(1)<<(slot%word_bits));
+			}
+		}
+
+		//first slot of the level at or after from that has timers, or slot_count if none does
+		std::size_t next_occupied(unsigned level,std::size_t from) const noexcept
+		{
+			for(auto word=from/word_bits;word<words_per_level;++word)
+			{
+				auto bits=_occupied[level][word];
+				if(word==from/word_bits)
+				{
+					bits&=~std::uint64_t(0)<<(from%word_bits);
+				}
+				if(bits)
+				{
+					return word*word_bits+lowest_bit(bits);
+				}
+			}
+			return slot_count;
+		}
+
+		/*
+			The next tick at which a timer fires or moves, or the maximum tick_type if there are no timers.
+			A timer in a level's slot is always ahead of the current tick's digit of that level, and the tick's higher digits match its expiry's,
+			so the tick at which the current tick reaches the slot is the earliest the timer needs to be visited.
+		*/
+		tick_type next_event() const noexcept
+		{
+			auto next=std::numeric_limits<tick_type>::max();
+			if(_size==0)
+			{
+				return next;
+			}
+			if(_heads[overflow_slot]!=nil)
+			{
+				next=((_now>>(level_count*slot_bits))+1)<<(level_count*slot_bits);
+			}
+			for(unsigned level=0;level<level_count;++level)
+			{
+				auto const slot=next_occupied(level,digit(_now,level)+1);
+				if(slot<slot_count)
+				{
+					auto const shift=(level+1)*slot_bits;
+					auto const base=shift<64?_now>>shift<<shift:0;
+					auto const tick=base|(static_cast<tick_type>(slot)<<(level*slot_bits));
+					if(tick<next)
+					{
+						next=tick;
+					}
+				}
+			}
+			return next;
+		}
+
+		std::uint32_t allocate()
+		{
+			if(_free==nil)
+			{
+				if(!_heads)
+				{
+					_heads.reset(new std::uint32_t[overflow_slot+1]);
+					std::fill(_heads.get(),_heads.get()+overflow_slot+1,std::uint32_t(nil));
+				}
+				assert(_capacity<=nil-chunk_size);
+				_chunks.emplace_back(new node[chunk_size]);
+				for(std::size_t i=chunk_size;i-->0;)
+				{
+					auto const index=static_cast<std::uint32_t>(_capacity+i);
+					at(index).next=_free;
+					_free=index;
+				}
+				_capacity+=static_cast<std::uint32_t>(chunk_size);
+			}
+			auto const index=_free;
+			_free=at(index).next;
+			return index;
+		}
+
+		void release(std::uint32_t index) noexcept
+		{
+			auto& n=at(index);
+			n.task=Task();
+			n.slot=nil;
+			++n.generation;
+			n.next=_free;
+			_free=index;
+			--_size;
+		}
+
+		//the list a timer due at expiry belongs in; timers already due go in the slot about to fire
+		std::size_t slot_of(tick_type expiry) const noexcept
+		{
+			if(expiry<=_now)
+			{
+				return digit(_now,0);
+			}
+			auto const diff=expiry^_now;
+			for(unsigned level=0;level<level_count;++level)
+			{
+				if((diff>>((level+1)*slot_bits))==0)
+				{
+					return level*slot_count+digit(expiry,level);
+				}
+			}
+			return overflow_slot;
+		}
+
+		void link(std::uint32_t index) noexcept
+		{
+			auto& n=at(index);
+			auto const slot=slot_of(n.expiry);
+			auto& head=_heads[slot];
+			n.slot=static_cast<std::uint32_t>(slot);
+			mark(slot);
+			n.prev=nil;
+			n.next=head;
+			if(head!=nil)
+			{
+				at(head).prev=index;
+			}
+			head=index;
+		}
+
+		void unlink(std::uint32_t index) noexcept
+		{
+			auto& n=at(index);
+			if(n.prev!=nil)
+			{
+				at(n.prev).next=n.next;
+			}
+			else
+			{
+				_heads[n.slot]=n.next;
+				if(n.next==nil)
+				{
+					unmark(n.slot);
+				}
+			}
+			if(n.next!=nil)
+			{
+				at(n.next).prev=n.prev;
+			}
+		}
+
+		//takes the whole list out of the slot, for its timers to be moved or fired
+		std::uint32_t detach(std::size_t slot) noexcept
+		{
+			auto const head=_heads[slot];
+			_heads[slot]=nil;
+			unmark(slot);
+			return head;
+		}
+
+		void cascade(std::size_t slot) noexcept
+		{
+			for(auto index=detach(slot);index!=nil;)
+			{
+				auto const next=at(index).next;
+				link(index);
+				index=next;
+			}
+		}
+	public:
+		timer_wheel()=default;
+		timer_wheel(timer_wheel&&)=default;
+		timer_wheel& operator=(timer_wheel&&)=default;
+
+		/*
+			The tick the wheel has advanced to.
+		*/
+		tick_type now() const noexcept
+		{
+			return _now;
+		}
+
+		/*
+			The number of timers waiting.
+		*/
+		std::size_t size() const noexcept
+		{
+			return _size;
+		}
+
+		bool empty() const noexcept
+		{
+			return _size==0;
+		}
+
+		/*
+			Adds a timer that fires at expiry, or at the next tick if expiry has passed,
+			and then every period ticks after that until cancelled if period is not 0.
+		*/
+		timer_handle insert(tick_type expiry,Task task,tick_type period=0)
+		{
+			auto const index=allocate();
+			auto& n=at(index);
+			n.task=std::move(task);
+			n.expiry=expiry>_now?expiry:_now+1;
+			n.period=period;
+			link(index);
+			++_size;
+			return timer_handle{index,n.generation};
+		}
+
+		/*
+			Removes a timer before it fires, destroying its Task. Returns false if it already fired or was cancelled.
+		*/
+		bool cancel(timer_handle handle) noexcept
+		{
+			if(handle.index>=_capacity)
+			{
+				return false;
+			}
+			auto const& n=at(handle.index);
+			if(n.generation!=handle.generation||n.slot==nil)
+			{
+				return false;
+			}
+			unlink(handle.index);
+			release(handle.index);
+			return true;
+		}
+
+		/*
+			Whether the timer is waiting to fire.
+		*/
+		bool contains(timer_handle handle) const noexcept
+		{
+			return handle.index<_capacity&&at(handle.index).generation==handle.generation&&at(handle.index).slot!=nil;
+		}
+
+		/*
+			Moves the wheel to tick to, calling on_expired(Task&) for each timer due by then, in order of tick.
+			Periodic timers are put back after their call, skipping periods that have already passed.
+			on_expired must not throw or change the wheel.
+		*/
+		template<typename OnExpired>
+		void advance(tick_type to,OnExpired&& on_expired)
+		{
+			while(_now<to)
+			{
+				auto const next=next_event();
+				if(next>to)
+				{
+					_now=to;
+					return;
+				}
+				_now=next;
+				if((_now&((tick_type(1)<<(level_count*slot_bits))-1))==0)
+				{
+					cascade(overflow_slot);
+				}
+				for(unsigned level=level_count-1;level>0;--level)
+				{
+					if((_now&((tick_type(1)<<(level*slot_bits))-1))==0)
+					{
+						cascade(level*slot_count+digit(_now,level));
+					}
+				}
+				for(auto index=detach(digit(_now,0));index!=nil;)
+				{
+					auto& n=at(index);
+					auto const next=n.next;
+					on_expired(n.task);
+					if(n.period!=0)
+					{
+						n.expiry+=n.period;
+						if(n.expiry<=_now)
+						{
+							n.expiry=_now+n.period-(_now-n.expiry)%n.period;
+						}
+						link(index);
+					}
+					else
+					{
+						release(index);
+					}
+					index=next;
+				}
+			}
+		}
+
+		/*
+			Ticks from now() until advancing next fires or moves a timer, or the maximum tick_type if the wheel is empty.
+			Waiting that long never misses a timer, so a thread driving the wheel can sleep for it.
+			Advancing costs the number of ticks at which this happens, not the number of ticks passed.
+		*/
+		tick_type ticks_to_next() const noexcept
+		{
+			auto const next=next_event();
+			return next==std::numeric_limits<tick_type>::max()?next:next-_now;
+		}
+
+		/*
+			Removes all timers and goes back to tick 0, keeping memory for reuse.
+		*/
+		void clear() noexcept
+		{
+			if(!_heads)
+			{
+				_now=0;
+				return;
+			}
+			for(std::size_t slot=0;slot<=overflow_slot;++slot)
+			{
+				for(auto index=detach(slot);index!=nil;)
+				{
+					auto const next=at(index).next;
+					release(index);
+					index=next;
+				}
+			}
+			_now=0;
+		}
+	};
+}
+#endif
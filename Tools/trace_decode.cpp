@@ -0,0 +1,41 @@
+/*
+	Turns the binary output of exlib::TraceLogger into text.
+	Usage: trace_decode <trace file> [text file]
+	Writes to stdout if no text file is given.
+*/
+#include "../ThreadPool/ThreadPool.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+int main(int argc,char** argv)
+{
+	if(argc<2)
+	{
+		std::fprintf(stderr,"Usage: %s <trace file> [text file]\n",argv[0]);
+		return 2;
+	}
+	std::ifstream in(argv[1],std::ios::binary);
+	if(!in)
+	{
+		std::fprintf(stderr,"Could not open %s\n",argv[1]);
+		return 1;
+	}
+	std::ofstream file;
+	if(argc>2)
+	{
+		file.open(argv[2]);
+		if(!file)
+		{
+			std::fprintf(stderr,"Could not open %s\n",argv[2]);
+			return 1;
+		}
+	}
+	std::ostream& out=argc>2?static_cast<std::ostream&>(file):std::cout;
+	if(!exlib::decode_trace(in,out))
+	{
+		std::fprintf(stderr,"%s is not a complete trace\n",argv[1]);
+		return 1;
+	}
+	return 0;
+}
@@ -1,8 +1,20 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 #include "../Utils/exmem.h"
+#include "../Utils/exalloc.h"
+#include "../Utils/excolumn.h"
+#include "../Utils/exmapped.h"
+#include "../ThreadPool/thread_pool.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace ExMemTests {
@@ -20,4 +32,365 @@ namespace ExMemTests {
 			exlib::iterator<std::string> b(mem.get());
 		}
 	};
+	TEST_CLASS(SmallVector)
+	{
+		TEST_METHOD(stays_inline)
+		{
+			exlib::small_vector<int,8> vec;
+			for(int i=0;i<8;++i)
+			{
+				vec.push_back(i);
+			}
+			Assert::IsTrue(vec.is_inline());
+			Assert::AreEqual(size_t(8),vec.size());
+			Assert::AreEqual(7,vec.back());
+		}
+		TEST_METHOD(spills_to_heap)
+		{
+			exlib::small_vector<std::string,2> vec;
+			for(int i=0;i<20;++i)
+			{
+				vec.push_back(std::to_string(i)+" is long enough to be on the heap");
+			}
+			vec.push_back(vec[0]);
+			Assert::IsFalse(vec.is_inline());
+			Assert::AreEqual(size_t(21),vec.size());
+			Assert::AreEqual(vec[0],vec[20]);
+			vec.erase(vec.begin(),vec.begin()+19);
+			vec.shrink_to_fit();
+			Assert::IsTrue(vec.is_inline());
+			Assert::AreEqual(std::string("19 is long enough to be on the heap"),vec[0]);
+		}
+		TEST_METHOD(insert_erase)
+		{
+			exlib::small_vector<int,4> vec{1,2,4};
+			vec.insert(vec.begin()+2,3);
+			vec.insert(vec.begin(),vec[3]);
+			Assert::IsTrue(vec==exlib::small_vector<int,4>{4,1,2,3,4});
+			vec.erase(vec.begin()+1);
+			Assert::IsTrue(vec==exlib::small_vector<int,4>{4,2,3,4});
+		}
+		TEST_METHOD(move)
+		{
+			exlib::small_vector<std::unique_ptr<int>,2> small;
+			small.push_back(std::make_unique<int>(1));
+			auto moved_small=std::move(small);
+			Assert::IsTrue(small.empty());
+			Assert::AreEqual(1,*moved_small[0]);
+			exlib::small_vector<std::unique_ptr<int>,2> big;
+			for(int i=0;i<5;++i)
+			{
+				big.push_back(std::make_unique<int>(i));
+			}
+			auto const heap=big.data();
+			auto moved_big=std::move(big);
+			Assert::IsTrue(moved_big.data()==heap);
+			Assert::IsTrue(big.is_inline());
+			Assert::AreEqual(4,*moved_big[4]);
+		}
+	};
+	TEST_CLASS(ColumnAlgorithms)
+	{
+		//key, value, original row; enough rows for several parallel chunks
+		using table=exlib::multi_vector<int,std::int64_t,std::size_t>;
+		static table make_table()
+		{
+			table t;
+			std::size_t const rows=100000;
+			unsigned state=1;
+			for(std::size_t i=0;i<rows;++i)
+			{
+				state=state*1103515245+12345;
+				t.push_back(static_cast<int>(state>>16)%1000,static_cast<std::int64_t>(i%7),i);
+			}
+			return t;
+		}
+	public:
+		TEST_METHOD(column_select)
+		{
+			exlib::thread_pool pool(4);
+			auto const t=make_table();
+			auto const pred=[](int key)
+			{
+				return key<300;
+			};
+			auto const serial=exlib::column_select<0>(t,pred);
+			Assert::IsFalse(serial.empty());
+			Assert::IsTrue(serial==exlib::parallel_column_select<0>(pool,t,pred));
+			for(auto const row:serial)
+			{
+				Assert::IsTrue(t.data<0>()[row]<300);
+			}
+		}
+		TEST_METHOD(sort_by_column)
+		{
+			exlib::thread_pool pool(4);
+			auto serial=make_table();
+			auto parallel=serial;
+			exlib::sort_by_column<0>(serial);
+			exlib::parallel_sort_by_column<0>(pool,parallel);
+			for(std::size_t i=0;i<serial.size();++i)
+			{
+				Assert::AreEqual(serial.data<0>()[i],parallel.data<0>()[i]);
+				Assert::AreEqual(serial.data<2>()[i],parallel.data<2>()[i]);
+				if(i!=0)
+				{
+					Assert::IsTrue(serial.data<0>()[i-1]<=serial.data<0>()[i]);
+					//stable: equal keys keep their original order
+					Assert::IsTrue(serial.data<0>()[i-1]<serial.data<0>()[i]||serial.data<2>()[i-1]<serial.data<2>()[i]);
+				}
+			}
+		}
+		TEST_METHOD(group_sum)
+		{
+			exlib::thread_pool pool(4);
+			auto const t=make_table();
+			auto const serial=exlib::group_sum<0,1>(t);
+			auto const parallel=exlib::parallel_group_sum<0,1>(pool,t);
+			Assert::AreEqual(size_t(1000),serial.size());
+			Assert::AreEqual(serial.size(),parallel.size());
+			std::int64_t total=0;
+			for(std::size_t i=0;i<serial.size();++i)
+			{
+				Assert::AreEqual(serial.data<0>()[i],parallel.data<0>()[i]);
+				Assert::AreEqual(serial.data<1>()[i],parallel.data<1>()[i]);
+				total+=serial.data<1>()[i];
+			}
+			std::int64_t expected=0;
+			for(std::size_t i=0;i<t.size();++i)
+			{
+				expected+=t.data<1>()[i];
+			}
+			Assert::AreEqual(expected,total);
+		}
+	};
+	TEST_CLASS(Allocators)
+	{
+	public:
+		TEST_METHOD(slab_free_on_other_thread)
+		{
+			//a block size no other test uses, so this thread's cache starts empty
+			using resource=exlib::slab_resource<72>;
+			std::vector<void*> blocks(3*resource::batch_size);
+			for(auto& block:blocks)
+			{
+				block=resource::allocate();
+				std::memset(block,0xAB,72);
+			}
+			std::thread([&blocks]
+				{
+					for(auto const block:blocks)
+					{
+						resource::deallocate(block);
+					}
+				}).join();
+			//the exited thread handed its blocks to the depot, which gives them out again first
+			std::unordered_set<void*> const freed(blocks.begin(),blocks.end());
+			std::size_t reused=0;
+			for(auto& block:blocks)
+			{
+				block=resource::allocate();
+				reused+=freed.count(block);
+			}
+			Assert::AreEqual(blocks.size(),reused);
+			for(auto const block:blocks)
+			{
+				resource::deallocate(block);
+			}
+		}
+		TEST_METHOD(monotonic_reset)
+		{
+			exlib::monotonic_arena arena(1024);
+			auto const first=arena.allocate(64);
+			arena.reset();
+			Assert::IsTrue(arena.allocate(64)==first);
+			arena.allocate(5000);
+			auto const grown=arena.capacity();
+			Assert::IsTrue(grown>1024);
+			arena.reset();
+			//only the newest chunk, the one that held 5000 bytes, is kept
+			auto const kept=arena.capacity();
+			Assert::IsTrue(kept>=5000&&kept<grown);
+			auto const again=arena.allocate(5000);
+			Assert::AreEqual(kept,arena.capacity());
+			arena.reset();
+			Assert::IsTrue(arena.allocate(5000)==again);
+		}
+		TEST_METHOD(size_class_boundaries)
+		{
+			exlib::size_class_pool pool;
+			auto const small=pool.allocate(256);
+			pool.deallocate(small,256);
+			Assert::IsTrue(pool.allocate(257)!=small);
+			Assert::IsTrue(pool.allocate(241)==small);
+			auto const medium=pool.allocate(257);
+			std::memset(medium,0,512);
+			pool.deallocate(medium,257);
+			Assert::IsTrue(pool.allocate(512)==medium);
+			auto const largest=pool.allocate(4096);
+			pool.deallocate(largest,4096);
+			auto const big=pool.allocate(4097);
+			Assert::IsTrue(big!=largest);
+			std::memset(big,0,4097);
+			Assert::IsTrue(pool.allocate(4096)==largest);
+			//blocks over max_block_size go back to operator delete, not to a free list
+			pool.deallocate(big,4097);
+			Assert::IsTrue(pool.allocate(4096)!=big);
+		}
+	};
+	TEST_CLASS(MappedMultiVector)
+	{
+		TEST_METHOD(reopen)
+		{
+			char const* const path="exmemtests_mapped.bin";
+			{
+				auto table=exlib::mapped_multi_vector<int,double>::create(path);
+				for(int i=0;i<100;++i)
+				{
+					table.push_back(i,i*0.5);
+				}
+				table.flush();
+			}
+			{
+				auto const table=exlib::mapped_multi_vector<int,double>::open(path,exlib::map_access::read_only);
+				Assert::IsFalse(table.writable());
+				Assert::AreEqual(size_t(100),table.size());
+				for(int i=0;i<100;++i)
+				{
+					Assert::AreEqual(i,table.data<0>()[i]);
+					Assert::AreEqual(i*0.5,table.data<1>()[i]);
+				}
+			}
+			Assert::ExpectException<std::runtime_error>([path]
+				{
+					exlib::mapped_multi_vector<double,int>::open(path,exlib::map_access::read_only);
+				});
+			std::remove(path);
+		}
+	};
+	TEST_CLASS(AlignedMultiVector)
+	{
+		//counts live objects, and throws from its copy constructor once copies_left runs out
+		struct counted {
+			static inline int live=0;
+			static inline int copies_left=-1;
+			int value;
+			counted(int v) noexcept:value(v)
+			{
+				++live;
+			}
+			counted(counted const& other):value(other.value)
+			{
+				if(copies_left==0)
+				{
+					throw std::runtime_error("copy failed");
+				}
+				if(copies_left>0)
+				{
+					--copies_left;
+				}
+				++live;
+			}
+			//takes over the count of other, as mvector does not destroy what it moves from (noop_destructor_after_move)
+			counted(counted&& other) noexcept:value(other.value)
+			{}
+			counted& operator=(counted const&)=default;
+			~counted()
+			{
+				--live;
+			}
+		};
+
+		template<typename Vector,std::size_t... Is>
+		static bool columns_aligned(Vector const& v,std::index_sequence<Is...>)
+		{
+			bool const aligned[]={reinterpret_cast<std::uintptr_t>(v.template data<Is>())%64==0 ...};
+			for(auto const a:aligned)
+			{
+				if(!a)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	public:
+		TEST_METHOD(alignment_and_padding)
+		{
+			using table_t=exlib::aligned_multi_vector<char,double,std::uint16_t>;
+			//64 chars, 8 doubles and 32 uint16_t each fill a whole 64 byte block
+			Assert::AreEqual(table_t::size_type(64),table_t::capacity_granularity);
+			table_t table;
+			table.push_back_n(10,'a',1.5,std::uint16_t(7));
+			Assert::AreEqual(table_t::size_type(10),table.size());
+			Assert::AreEqual(table_t::size_type(64),table.padded_size());
+			Assert::IsTrue(table.capacity()%table_t::capacity_granularity==0);
+			Assert::IsTrue(columns_aligned(table,std::make_index_sequence<3>{}));
+			std::vector<char> chars(100,'b');
+			std::vector<double> doubles(100);
+			std::vector<std::uint16_t> shorts(100);
+			for(std::size_t i=0;i<100;++i)
+			{
+				doubles[i]=i*0.25;
+				shorts[i]=static_cast<std::uint16_t>(i);
+			}
+			table.append_columns(100,chars.data(),doubles.data(),shorts.data());
+			Assert::AreEqual(table_t::size_type(110),table.size());
+			Assert::AreEqual(table_t::size_type(128),table.padded_size());
+			Assert::IsTrue(table.capacity()>=table.padded_size());
+			Assert::IsTrue(table.capacity()%table_t::capacity_granularity==0);
+			Assert::IsTrue(columns_aligned(table,std::make_index_sequence<3>{}));
+			for(std::size_t i=0;i<10;++i)
+			{
+				Assert::IsTrue(table.data<0>()[i]=='a'&&table.data<1>()[i]==1.5&&table.data<2>()[i]==7);
+			}
+			for(std::size_t i=0;i<100;++i)
+			{
+				Assert::IsTrue(table.data<0>()[10+i]=='b'&&table.data<1>()[10+i]==doubles[i]&&table.data<2>()[10+i]==shorts[i]);
+			}
+			table.shrink_to_fit();
+			Assert::AreEqual(table_t::size_type(128),table.capacity());
+			Assert::IsTrue(columns_aligned(table,std::make_index_sequence<3>{}));
+		}
+		TEST_METHOD(append_columns_throws)
+		{
+			using table_t=exlib::aligned_multi_vector<int,counted,double>;
+			{
+				table_t table;
+				table.push_back_n(5,1,counted(2),3.0);
+				Assert::AreEqual(5,counted::live);
+				std::vector<int> ints(20,4);
+				std::vector<counted> objects(20,counted(5));
+				std::vector<double> doubles(20,6.0);
+				int const outside=counted::live-5;
+				//the copy of the 8th element throws, after the int column is copied and before the double column
+				counted::copies_left=7;
+				Assert::ExpectException<std::runtime_error>([&]
+					{
+						table.append_columns(20,ints.data(),objects.data(),doubles.data());
+					});
+				counted::copies_left=-1;
+				Assert::AreEqual(table_t::size_type(5),table.size());
+				Assert::AreEqual(5+outside,counted::live);
+				//the same through push_back_n, whose columns are constructed from one value each
+				counted::copies_left=3;
+				Assert::ExpectException<std::runtime_error>([&]
+					{
+						table.push_back_n(20,7,counted(8),9.0);
+					});
+				counted::copies_left=-1;
+				Assert::AreEqual(table_t::size_type(5),table.size());
+				Assert::AreEqual(5+outside,counted::live);
+				for(std::size_t i=0;i<5;++i)
+				{
+					Assert::IsTrue(table.data<0>()[i]==1&&table.data<1>()[i].value==2&&table.data<2>()[i]==3.0);
+				}
+				table.append_columns(20,ints.data(),objects.data(),doubles.data());
+				Assert::AreEqual(table_t::size_type(25),table.size());
+				Assert::AreEqual(25+outside,counted::live);
+				Assert::IsTrue(columns_aligned(table,std::make_index_sequence<3>{}));
+			}
+			Assert::AreEqual(0,counted::live);
+		}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,572 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXALLOC_H
+#define EXALLOC_H
+#include "exmem.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+/*
+	Memory sources for small objects, each with a std allocator over it that also works with allocator_ptr:
+	slab_resource/slab_allocator hands out blocks of one size from any thread,
+	monotonic_arena/monotonic_allocator bumps a pointer and frees everything at once,
+	and size_class_pool/pool_allocator keeps free lists of blocks in a range of sizes for one thread.
+	Chunks come from buffer_allocator.
+*/
+namespace exlib {
+
+	namespace alloc_detail {
+		constexpr std::size_t round_up(std::size_t n,std::size_t align) noexcept
+		{
+			return (n+align-1)/align*align;
+		}
+
+		constexpr std::size_t max_size(std::size_t a,std::size_t b) noexcept
+		{
+			return a>b?a:b;
+		}
+
+		constexpr std::size_t clamp_size(std::size_t n,std::size_t low,std::size_t high) noexcept
+		{
+			return n<low?low:n>high?high:n;
+		}
+
+		//a free block; the first of a batch also links to the next batch
+		struct free_block {
+			free_block* next;
+			free_block* next_batch;
+		};
+
+		template<std::size_t Alignment>
+		void* allocate_chunk(std::size_t bytes)
+		{
+			return buffer_allocator<1,Alignment>().allocate(bytes);
+		}
+
+		template<std::size_t Alignment>
+		void deallocate_chunk(void* chunk) noexcept
+		{
+			buffer_allocator<1,Alignment>().deallocate(chunk,0);
+		}
+	}
+
+	/*
+		Blocks of BlockSize bytes aligned to Alignment, shared by the whole process.
+		Each thread allocates from and frees to its own cache of blocks without locking;
+		caches trade batches of blocks with a shared depot under a mutex when they run empty or grow too full.
+		A block can be freed on any thread. Blocks are cut from slabs that are kept until the process exits.
+	*/
+	template<std::size_t BlockSize,std::size_t Alignment=alignof(std::max_align_t)>
+	class slab_resource {
+		static_assert(Alignment!=0&&(Alignment&(Alignment-1))==0,"Alignment must be a power of 2");
+		using free_block=alloc_detail::free_block;
+	public:
+		static constexpr std::size_t block_size=alloc_detail::round_up(alloc_detail::max_size(BlockSize,sizeof(free_block)),
+			alloc_detail::max_size(Alignment,alignof(free_block)));
+
+		//blocks moved between a thread's cache and the depot at once
+		static constexpr std::size_t batch_size=alloc_detail::clamp_size(16*1024/block_size,4,256);
+	private:
+		static constexpr std::size_t slab_batches=alloc_detail::max_size(64*1024/(block_size*batch_size),1);
+		static constexpr std::size_t slab_bytes=block_size*batch_size*slab_batches;
+
+		class depot {
+			std::mutex _mtx;
+			free_block* _batches=nullptr;
+
+			//links a new slab into batches, keeps the first and stores the rest
+			free_block* cut_slab()
+			{
+				auto const slab=static_cast<char*>(alloc_detail::allocate_chunk<alloc_detail::max_size(Alignment,alignof(free_block))>(slab_bytes));
+				free_block* first=nullptr;
+				for(std::size_t b=slab_batches;b-->0;)
+				{
+					auto const batch=slab+b*batch_size*block_size;
+					for(std::size_t i=0;i<batch_size;++i)
+					{
+						reinterpret_cast<free_block*>(batch+i*block_size)->next=i+1<batch_size?reinterpret_cast<free_block*>(batch+(i+1)*block_size):nullptr;
+					}
+					auto const head=reinterpret_cast<free_block*>(batch);
+					if(b==0)
+					{
+						first=head;
+					}
+					else
+					{
+						head->next_batch=_batches;
+						_batches=head;
+					}
+				}
+				return first;
+			}
+		public:
+			free_block* take_batch()
+			{
+				std::lock_guard<std::mutex> lock(_mtx);
+				if(auto const batch=_batches)
+				{
+					_batches=batch->next_batch;
+					return batch;
+				}
+				return cut_slab();
+			}
+
+			void give_batch(free_block* batch) noexcept
+			{
+				std::lock_guard<std::mutex> lock(_mtx);
+				batch->next_batch=_batches;
+				_batches=batch;
+			}
+		};
+
+		//never destroyed, as threads may free blocks after static destructors run
+		static depot& shared()
+		{
+			static depot* const instance=new depot;
+			return *instance;
+		}
+
+		struct cache {
+			free_block* head=nullptr;
+			std::size_t count=0;
+
+			void refill()
+			{
+				head=shared().take_batch();
+				count=0;
+				for(auto block=head;block;block=block->next)
+				{
+					++count;
+				}
+			}
+
+			//hands the first batch_size blocks back to the depot
+			void flush_batch() noexcept
+			{
+				auto last=head;
+				for(std::size_t i=1;i<batch_size;++i)
+				{
+					last=last->next;
+				}
+				auto const batch=head;
+				head=last->next;
+				last->next=nullptr;
+				count-=batch_size;
+				shared().give_batch(batch);
+			}
+
+			~cache()
+			{
+				while(count>=batch_size)
+				{
+					flush_batch();
+				}
+				if(head)
+				{
+					shared().give_batch(head);
+				}
+				head=nullptr;
+				count=0;
+			}
+		};
+
+		static cache& local() noexcept
+		{
+			static thread_local cache instance;
+			return instance;
+		}
+	public:
+		static void* allocate()
+		{
+			auto& c=local();
+			if(!c.head)
+			{
+				c.refill();
+			}
+			auto const block=c.head;
+			c.head=block->next;
+			--c.count;
+			return block;
+		}
+
+		static void deallocate(void* p) noexcept
+		{
+			auto& c=local();
+			auto const block=static_cast<free_block*>(p);
+			block->next=c.head;
+			c.head=block;
+			if(++c.count>=2*batch_size)
+			{
+				c.flush_batch();
+			}
+		}
+	};
+
+	/*
+		Allocates single Ts from slab_resource and arrays of them with std::allocator.
+	*/
+	template<typename T>
+	class slab_allocator {
+		using resource=slab_resource<sizeof(T),alignof(T)>;
+	public:
+		using value_type=T;
+		using is_always_equal=std::true_type;
+		using propagate_on_container_move_assignment=std::true_type;
+
+		slab_allocator() noexcept=default;
+		template<typename U>
+		slab_allocator(slab_allocator<U> const&) noexcept
+		{}
+
+		T* allocate(std::size_t n)
+		{
+			if(n==1)
+			{
+				return static_cast<T*>(resource::allocate());
+			}
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p,std::size_t n) noexcept
+		{
+			if(n==1)
+			{
+				resource::deallocate(p);
+			}
+			else
+			{
+				std::allocator<T>().deallocate(p,n);
+			}
+		}
+
+		template<typename U>
+		bool operator==(slab_allocator<U> const&) const noexcept
+		{
+			return true;
+		}
+		template<typename U>
+		bool operator!=(slab_allocator<U> const&) const noexcept
+		{
+			return false;
+		}
+	};
+
+	/*
+		Bump allocator over chunks that double in size, starting with an optional buffer of the caller's.
+		Deallocating does nothing; reset frees everything at once and keeps the largest chunk for reuse.
+		Destructors of objects placed in it are not run. Not thread safe.
+	*/
+	class monotonic_arena {
+		struct chunk {
+			chunk* next;
+			std::size_t size;
+		};
+		static constexpr std::size_t header_size=alloc_detail::round_up(sizeof(chunk),alignof(std::max_align_t));
+
+		char* _initial;
+		std::size_t _initial_size;
+		char* _pos;
+		char* _end;
+		chunk* _chunks=nullptr;
+		std::size_t _next_size;
+
+		void enter(char* data,std::size_t size) noexcept
+		{
+			_pos=data;
+			_end=data+size;
+		}
+
+		static char* data(chunk* c) noexcept
+		{
+			return reinterpret_cast<char*>(c)+header_size;
+		}
+
+		void* allocate_slow(std::size_t size,std::size_t align)
+		{
+			auto const needed=size+align-1;
+			while(_next_size<needed)
+			{
+				_next_size*=2;
+			}
+			auto const fresh=static_cast<chunk*>(alloc_detail::allocate_chunk<alignof(std::max_align_t)>(header_size+_next_size));
+			fresh->next=_chunks;
+			fresh->size=_next_size;
+			_chunks=fresh;
+			enter(data(fresh),_next_size);
+			_next_size*=2;
+			auto const start=reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(_pos)+align-1)&~std::uintptr_t(align-1));
+			_pos=start+size;
+			return start;
+		}
+	public:
+		static constexpr std::size_t default_chunk_size=4096;
+
+		explicit monotonic_arena(std::size_t first_chunk_size=default_chunk_size) noexcept:
+			_initial(nullptr),_initial_size(0),_pos(nullptr),_end(nullptr),_next_size(first_chunk_size?first_chunk_size:1)
+		{}
+
+		/*
+			Allocates from buffer until it runs out; buffer must outlive the arena.
+		*/
+		monotonic_arena(void* buffer,std::size_t size) noexcept:
+			_initial(static_cast<char*>(buffer)),_initial_size(size),_pos(_initial),_end(_initial+size),_next_size(size?2*size:default_chunk_size)
+		{}
+
+		monotonic_arena(monotonic_arena const&)=delete;
+		monotonic_arena& operator=(monotonic_arena const&)=delete;
+
+		~monotonic_arena()
+		{
+			release();
+		}
+
+		/*
+			Returns size bytes aligned to align, which must be a power of 2.
+		*/
+		void* allocate(std::size_t size,std::size_t align=alignof(std::max_align_t))
+		{
+			assert(align!=0&&(align&(align-1))==0);
+			auto const start=reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(_pos)+align-1)&~std::uintptr_t(align-1));
+			if(_pos&&start<=_end&&size<=std::size_t(_end-start))
+			{
+				_pos=start+size;
+				return start;
+			}
+			return allocate_slow(size,align);
+		}
+
+		void deallocate(void*,std::size_t) noexcept
+		{}
+
+		/*
+			Frees everything allocated, keeping the newest and largest chunk, or the initial buffer if there is none.
+		*/
+		void reset() noexcept
+		{
+			if(_chunks)
+			{
+				for(auto c=_chunks->next;c;)
+				{
+					auto const next=c->next;
+					alloc_detail::deallocate_chunk<alignof(std::max_align_t)>(c);
+					c=next;
+				}
+				_chunks->next=nullptr;
+				enter(data(_chunks),_chunks->size);
+			}
+			else
+			{
+				enter(_initial,_initial_size);
+			}
+		}
+
+		/*
+			Frees everything allocated and returns all chunks to the heap.
+		*/
+		void release() noexcept
+		{
+			for(auto c=_chunks;c;)
+			{
+				auto const next=c->next;
+				alloc_detail::deallocate_chunk<alignof(std::max_align_t)>(c);
+				c=next;
+			}
+			_chunks=nullptr;
+			enter(_initial,_initial_size);
+		}
+
+		/*
+			Bytes held in chunks, not counting the initial buffer.
+		*/
+		std::size_t capacity() const noexcept
+		{
+			std::size_t total=0;
+			for(auto c=_chunks;c;c=c->next)
+			{
+				total+=c->size;
+			}
+			return total;
+		}
+	};
+
+	template<typename T>
+	class monotonic_allocator {
+		template<typename U>
+		friend class monotonic_allocator;
+		monotonic_arena* _arena;
+	public:
+		using value_type=T;
+		using propagate_on_container_copy_assignment=std::true_type;
+		using propagate_on_container_move_assignment=std::true_type;
+		using propagate_on_container_swap=std::true_type;
+
+		explicit monotonic_allocator(monotonic_arena& arena) noexcept:_arena(&arena)
+		{}
+		template<typename U>
+		monotonic_allocator(monotonic_allocator<U> const& o) noexcept:_arena(o._arena)
+		{}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(_arena->allocate(n*sizeof(T),alignof(T)));
+		}
+
+		void deallocate(T*,std::size_t) noexcept
+		{}
+
+		template<typename U>
+		bool operator==(monotonic_allocator<U> const& o) const noexcept
+		{
+			return _arena==o._arena;
+		}
+		template<typename U>
+		bool operator!=(monotonic_allocator<U> const& o) const noexcept
+		{
+			return _arena!=o._arena;
+		}
+	};
+
+	/*
+		Free lists of blocks in size classes up to max_block_size, cut from a monotonic_arena and reused until release.
+		Classes are multiples of 16 bytes up to 256 and powers of 2 above that; bigger requests go to operator new.
+		Blocks are aligned to alignof(std::max_align_t). Deallocation must pass the size given to allocate. Not thread safe.
+	*/
+	class size_class_pool {
+		struct free_block {
+			free_block* next;
+		};
+	public:
+		static constexpr std::size_t max_block_size=4096;
+		static constexpr std::size_t alignment=alignof(std::max_align_t);
+	private:
+		static constexpr std::size_t small_step=16;
+		static constexpr std::size_t small_limit=256;
+		static constexpr std::size_t small_classes=small_limit/small_step;
+		//512, 1024, 2048, 4096
+		static constexpr std::size_t class_count=small_classes+4;
+		static_assert(alignment<=small_step,"Size classes are not aligned");
+
+		monotonic_arena _arena;
+		free_block* _free[class_count]={};
+
+		static std::size_t class_of(std::size_t size) noexcept
+		{
+			if(size<=small_limit)
+			{
+				return size==0?0:(size-1)/small_step;
+			}
+			std::size_t index=small_classes;
+			for(std::size_t cap=2*small_limit;cap<size;cap*=2)
+			{
+				++index;
+			}
+			return index;
+		}
+
+		static std::size_t class_size(std::size_t index) noexcept
+		{
+			return index<small_classes?(index+1)*small_step:small_limit<<(index-small_classes+1);
+		}
+	public:
+		explicit size_class_pool(std::size_t chunk_size=64*1024) noexcept:_arena(chunk_size)
+		{}
+
+		size_class_pool(size_class_pool const&)=delete;
+		size_class_pool& operator=(size_class_pool const&)=delete;
+
+		void* allocate(std::size_t size)
+		{
+			if(size>max_block_size)
+			{
+				return ::operator new(size);
+			}
+			auto const index=class_of(size);
+			if(auto const block=_free[index])
+			{
+				_free[index]=block->next;
+				return block;
+			}
+			return _arena.allocate(class_size(index),alignment);
+		}
+
+		void deallocate(void* p,std::size_t size) noexcept
+		{
+			if(size>max_block_size)
+			{
+				::operator delete(p);
+				return;
+			}
+			auto const index=class_of(size);
+			auto const block=static_cast<free_block*>(p);
+			block->next=_free[index];
+			_free[index]=block;
+		}
+
+		/*
+			Frees every block, including those still in use, and returns the chunks to the heap.
+		*/
+		void release() noexcept
+		{
+			std::fill(std::begin(_free),std::end(_free),nullptr);
+			_arena.release();
+		}
+	};
+
+	template<typename T>
+	class pool_allocator {
+		static_assert(alignof(T)<=size_class_pool::alignment,"pool_allocator cannot over-align");
+		template<typename U>
+		friend class pool_allocator;
+		size_class_pool* _pool;
+	public:
+		using value_type=T;
+		using propagate_on_container_copy_assignment=std::true_type;
+		using propagate_on_container_move_assignment=std::true_type;
+		using propagate_on_container_swap=std::true_type;
+
+		explicit pool_allocator(size_class_pool& pool) noexcept:_pool(&pool)
+		{}
+		template<typename U>
+		pool_allocator(pool_allocator<U> const& o) noexcept:_pool(o._pool)
+		{}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(_pool->allocate(n*sizeof(T)));
+		}
+
+		void deallocate(T* p,std::size_t n) noexcept
+		{
+			_pool->deallocate(p,n*sizeof(T));
+		}
+
+		template<typename U>
+		bool operator==(pool_allocator<U> const& o) const noexcept
+		{
+			return _pool==o._pool;
+		}
+		template<typename U>
+		bool operator!=(pool_allocator<U> const& o) const noexcept
+		{
+			return _pool!=o._pool;
+		}
+	};
+}
+#endif
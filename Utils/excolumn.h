@@ -0,0 +1,442 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXCOLUMN_H
+#define EXCOLUMN_H
+#include "exmem.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+/*
+	Column-wise algorithms for mvector/multi_vector used as a columnar table.
+	Columns are chosen by index; the loops run over the contiguous data<I>() arrays without branching on the data where they can,
+	so the compiler can vectorize them.
+	The parallel_ versions split the rows into chunks run with pool.parallel_for(first, last, grain, f),
+	such as that of exlib::thread_pool_a, and give the same results as the serial ones,
+	except that parallel_group_sum may add floating point values in a different order.
+*/
+namespace exlib {
+
+	//indices of the selected rows, in increasing order
+	using column_selection=std::vector<std::size_t>;
+
+	namespace column_detail {
+		//rows per chunk a parallel algorithm hands to a task
+		constexpr std::size_t chunk_rows=std::size_t(1)<<14;
+
+		inline std::size_t chunk_count(std::size_t rows) noexcept
+		{
+			return (rows+chunk_rows-1)/chunk_rows;
+		}
+
+		template<typename MVector,std::size_t I>
+		using column_t=typename MVector::template subrange_value_type<I>;
+
+		//writes every index before testing it, so the loop has no branch on the predicate
+		template<typename T,typename Pred>
+		std::size_t select_range(T const* column,std::size_t first,std::size_t last,Pred& pred,std::size_t* out)
+		{
+			std::size_t n=0;
+			for(std::size_t i=first;i<last;++i)
+			{
+				out[n]=i;
+				n+=static_cast<bool>(pred(column[i]));
+			}
+			return n;
+		}
+
+		template<typename T>
+		void gather_range(T const* column,std::size_t const* selection,std::size_t first,std::size_t last,T* out)
+		{
+			for(std::size_t k=first;k<last;++k)
+			{
+				out[k]=column[selection[k]];
+			}
+		}
+
+		template<typename T>
+		void scatter_range(T* column,std::size_t const* selection,std::size_t first,std::size_t last,T const* values)
+		{
+			for(std::size_t k=first;k<last;++k)
+			{
+				column[selection[k]]=values[k];
+			}
+		}
+
+		//copy constructs the selected rows of one column into uninitialized storage, destroying them again if one throws
+		template<typename T>
+		void construct_gathered(T const* column,column_selection const& selection,T* out)
+		{
+			std::size_t k=0;
+			try
+			{
+				for(;k<selection.size();++k)
+				{
+					::new (static_cast<void*>(out+k)) T(column[selection[k]]);
+				}
+			}
+			catch(...)
+			{
+				while(k-->0)
+				{
+					out[k].~T();
+				}
+				throw;
+			}
+		}
+
+		template<typename T>
+		void destroy_column(T* column,std::size_t n) noexcept
+		{
+			for(std::size_t i=0;i<n;++i)
+			{
+				column[i].~T();
+			}
+		}
+
+		template<typename MVector>
+		void gather_columns(MVector const&,MVector&,column_selection const&,index_sequence<>)
+		{}
+
+		template<typename MVector,std::size_t I,std::size_t... Is>
+		void gather_columns(MVector const& src,MVector& dst,column_selection const& selection,index_sequence<I,Is...>)
+		{
+			construct_gathered(src.template data<I>(),selection,dst.template data<I>());
+			try
+			{
+				gather_columns(src,dst,selection,index_sequence<Is...>{});
+			}
+			catch(...)
+			{
+				destroy_column(dst.template data<I>(),selection.size());
+				throw;
+			}
+		}
+
+		template<typename MVector,std::size_t I>
+		void permute_column(MVector& mv,std::vector<std::size_t> const& permutation)
+		{
+			using T=column_t<MVector,I>;
+			auto const column=mv.template data<I>();
+			std::vector<T> sorted;
+			sorted.reserve(permutation.size());
+			for(auto const index:permutation)
+			{
+				sorted.push_back(std::move(column[index]));
+			}
+			std::move(sorted.begin(),sorted.end(),column);
+		}
+
+		//trivially copyable columns are permuted in chunks on the pool; others are moved on the calling thread
+		template<typename MVector,std::size_t I,typename Pool>
+		void parallel_permute_column(Pool& pool,MVector& mv,std::vector<std::size_t> const& permutation,std::true_type)
+		{
+			using T=column_t<MVector,I>;
+			auto const column=mv.template data<I>();
+			auto const n=permutation.size();
+			std::vector<T> sorted(n);
+			pool.parallel_for(std::size_t(0),chunk_count(n),1,[&](std::size_t chunk)
+				{
+					auto const first=chunk*chunk_rows;
+					gather_range(column,permutation.data(),first,std::min(first+chunk_rows,n),sorted.data());
+				});
+			pool.parallel_for(std::size_t(0),chunk_count(n),1,[&](std::size_t chunk)
+				{
+					auto const first=chunk*chunk_rows;
+					std::memcpy(column+first,sorted.data()+first,(std::min(first+chunk_rows,n)-first)*sizeof(T));
+				});
+		}
+
+		template<typename MVector,std::size_t I,typename Pool>
+		void parallel_permute_column(Pool&,MVector& mv,std::vector<std::size_t> const& permutation,std::false_type)
+		{
+			permute_column<MVector,I>(mv,permutation);
+		}
+
+		template<typename MVector,std::size_t... Is>
+		void permute_columns(MVector& mv,std::vector<std::size_t> const& permutation,index_sequence<Is...>)
+		{
+			using expand=int[];
+			(void)expand{0,(permute_column<MVector,Is>(mv,permutation),0)...};
+		}
+
+		template<typename Pool,typename MVector,std::size_t... Is>
+		void parallel_permute_columns(Pool& pool,MVector& mv,std::vector<std::size_t> const& permutation,index_sequence<Is...>)
+		{
+			using expand=int[];
+			(void)expand{0,(parallel_permute_column<MVector,Is>(pool,mv,permutation,std::is_trivially_copyable<column_t<MVector,Is>>{}),0)...};
+		}
+
+		//sums of one chunk of rows, keyed in order of first appearance
+		template<typename Key,typename Value,typename Hash>
+		struct group_sums {
+			std::unordered_map<Key,std::size_t,Hash> index;
+			std::vector<Key> keys;
+			std::vector<Value> sums;
+
+			void add(Key const& key,Value const& value)
+			{
+				auto const found=index.emplace(key,keys.size());
+				if(found.second)
+				{
+					keys.push_back(key);
+					sums.push_back(value);
+				}
+				else
+				{
+					sums[found.first->second]+=value;
+				}
+			}
+		};
+
+		template<typename Key,typename Value,typename Hash>
+		multi_vector<Key,Value> to_table(group_sums<Key,Value,Hash> const& groups)
+		{
+			multi_vector<Key,Value> table;
+			table.append_columns(groups.keys.size(),groups.keys.data(),groups.sums.data());
+			return table;
+		}
+	}
+
+	/*
+		The rows whose Ith column satisfies pred.
+	*/
+	template<std::size_t I,typename MVector,typename Pred>
+	column_selection column_select(MVector const& mv,Pred pred)
+	{
+		column_selection selection(mv.size());
+		selection.resize(column_detail::select_range(mv.template data<I>(),0,mv.size(),pred,selection.data()));
+		return selection;
+	}
+
+	/*
+		column_select with chunks of rows tested on pool, then put together in order.
+	*/
+	template<std::size_t I,typename Pool,typename MVector,typename Pred>
+	column_selection parallel_column_select(Pool& pool,MVector const& mv,Pred pred)
+	{
+		using namespace column_detail;
+		auto const n=mv.size();
+		auto const chunks=chunk_count(n);
+		column_selection selection(n);
+		std::vector<std::size_t> counts(chunks);
+		auto const column=mv.template data<I>();
+		pool.parallel_for(std::size_t(0),chunks,1,[&](std::size_t chunk)
+			{
+				auto local_pred=pred;
+				auto const first=chunk*chunk_rows;
+				counts[chunk]=select_range(column,first,std::min(first+chunk_rows,n),local_pred,selection.data()+first);
+			});
+		std::size_t size=0;
+		for(std::size_t chunk=0;chunk<chunks;++chunk)
+		{
+			auto const first=selection.begin()+chunk*chunk_rows;
+			size=std::copy(first,first+counts[chunk],selection.begin()+size)-selection.begin();
+		}
+		selection.resize(size);
+		return selection;
+	}
+
+	/*
+		Copies the Ith column of the selected rows to out, which must have room for selection.size() values.
+	*/
+	template<std::size_t I,typename MVector>
+	void column_gather(MVector const& mv,column_selection const& selection,column_detail::column_t<MVector,I>* out)
+	{
+		column_detail::gather_range(mv.template data<I>(),selection.data(),0,selection.size(),out);
+	}
+
+	template<std::size_t I,typename Pool,typename MVector>
+	void parallel_column_gather(Pool& pool,MVector const& mv,column_selection const& selection,column_detail::column_t<MVector,I>* out)
+	{
+		using namespace column_detail;
+		auto const n=selection.size();
+		pool.parallel_for(std::size_t(0),chunk_count(n),1,[&](std::size_t chunk)
+			{
+				auto const first=chunk*chunk_rows;
+				gather_range(mv.template data<I>(),selection.data(),first,std::min(first+chunk_rows,n),out);
+			});
+	}
+
+	/*
+		Assigns values[k] to the Ith column of row selection[k], the inverse of column_gather.
+		In the parallel version, the selected rows must be distinct.
+	*/
+	template<std::size_t I,typename MVector>
+	void column_scatter(MVector& mv,column_selection const& selection,column_detail::column_t<MVector,I> const* values)
+	{
+		column_detail::scatter_range(mv.template data<I>(),selection.data(),0,selection.size(),values);
+	}
+
+	template<std::size_t I,typename Pool,typename MVector>
+	void parallel_column_scatter(Pool& pool,MVector& mv,column_selection const& selection,column_detail::column_t<MVector,I> const* values)
+	{
+		using namespace column_detail;
+		auto const n=selection.size();
+		pool.parallel_for(std::size_t(0),chunk_count(n),1,[&](std::size_t chunk)
+			{
+				auto const first=chunk*chunk_rows;
+				scatter_range(mv.template data<I>(),selection.data(),first,std::min(first+chunk_rows,n),values);
+			});
+	}
+
+	/*
+		A new table of the selected rows, in the order of selection.
+	*/
+	template<typename MVector>
+	MVector gather_rows(MVector const& mv,column_selection const& selection)
+	{
+		MVector rows;
+		rows.reserve(selection.size());
+		column_detail::gather_columns(mv,rows,selection,make_index_sequence<MVector::type_count>{});
+		rows.force_set_size(selection.size());
+		return rows;
+	}
+
+	/*
+		The order of rows that stably sorts the Ith column by comp.
+	*/
+	template<std::size_t I,typename MVector,typename Compare=std::less<column_detail::column_t<MVector,I>>>
+	std::vector<std::size_t> sort_permutation(MVector const& mv,Compare comp=Compare())
+	{
+		std::vector<std::size_t> permutation(mv.size());
+		std::iota(permutation.begin(),permutation.end(),std::size_t(0));
+		auto const key=mv.template data<I>();
+		std::stable_sort(permutation.begin(),permutation.end(),[&](std::size_t a,std::size_t b)
+			{
+				return comp(key[a],key[b]);
+			});
+		return permutation;
+	}
+
+	/*
+		sort_permutation with chunks sorted on pool and then merged in pairs, each round's merges also on pool.
+	*/
+	template<std::size_t I,typename Pool,typename MVector,typename Compare=std::less<column_detail::column_t<MVector,I>>>
+	std::vector<std::size_t> parallel_sort_permutation(Pool& pool,MVector const& mv,Compare comp=Compare())
+	{
+		using namespace column_detail;
+		auto const n=mv.size();
+		std::vector<std::size_t> permutation(n);
+		std::iota(permutation.begin(),permutation.end(),std::size_t(0));
+		auto const key=mv.template data<I>();
+		auto const less=[&](std::size_t a,std::size_t b)
+		{
+			return comp(key[a],key[b]);
+		};
+		auto const begin=permutation.begin();
+		pool.parallel_for(std::size_t(0),chunk_count(n),1,[&](std::size_t chunk)
+			{
+				auto const first=chunk*chunk_rows;
+				std::stable_sort(begin+first,begin+std::min(first+chunk_rows,n),less);
+			});
+		for(std::size_t width=chunk_rows;width<n;width*=2)
+		{
+			auto const pairs=(n+2*width-1)/(2*width);
+			pool.parallel_for(std::size_t(0),pairs,1,[&](std::size_t pair)
+				{
+					auto const first=pair*2*width;
+					auto const middle=std::min(first+width,n);
+					auto const last=std::min(first+2*width,n);
+					std::inplace_merge(begin+first,begin+middle,begin+last,less);
+				});
+		}
+		return permutation;
+	}
+
+	/*
+		Reorders every column by permutation, so that row k becomes the old row permutation[k].
+	*/
+	template<typename MVector>
+	void permute_rows(MVector& mv,std::vector<std::size_t> const& permutation)
+	{
+		column_detail::permute_columns(mv,permutation,make_index_sequence<MVector::type_count>{});
+	}
+
+	template<typename Pool,typename MVector>
+	void parallel_permute_rows(Pool& pool,MVector& mv,std::vector<std::size_t> const& permutation)
+	{
+		column_detail::parallel_permute_columns(pool,mv,permutation,make_index_sequence<MVector::type_count>{});
+	}
+
+	/*
+		Stably sorts the rows by their Ith column, moving the other columns along with it.
+	*/
+	template<std::size_t I,typename MVector,typename Compare=std::less<column_detail::column_t<MVector,I>>>
+	void sort_by_column(MVector& mv,Compare comp=Compare())
+	{
+		permute_rows(mv,sort_permutation<I>(mv,comp));
+	}
+
+	template<std::size_t I,typename Pool,typename MVector,typename Compare=std::less<column_detail::column_t<MVector,I>>>
+	void parallel_sort_by_column(Pool& pool,MVector& mv,Compare comp=Compare())
+	{
+		parallel_permute_rows(pool,mv,parallel_sort_permutation<I>(pool,mv,comp));
+	}
+
+	/*
+		Sums the Value column of the rows with each distinct value of the Key column.
+		Returns a table of each key and its sum, in order of the key's first row.
+	*/
+	template<std::size_t Key,std::size_t Value,typename MVector,typename Hash=std::hash<column_detail::column_t<MVector,Key>>>
+	multi_vector<column_detail::column_t<MVector,Key>,column_detail::column_t<MVector,Value>> group_sum(MVector const& mv)
+	{
+		column_detail::group_sums<column_detail::column_t<MVector,Key>,column_detail::column_t<MVector,Value>,Hash> groups;
+		auto const keys=mv.template data<Key>();
+		auto const values=mv.template data<Value>();
+		for(std::size_t i=0;i<mv.size();++i)
+		{
+			groups.add(keys[i],values[i]);
+		}
+		return column_detail::to_table(groups);
+	}
+
+	/*
+		group_sum with chunks of rows summed on pool, then merged in order.
+	*/
+	template<std::size_t Key,std::size_t Value,typename Pool,typename MVector,typename Hash=std::hash<column_detail::column_t<MVector,Key>>>
+	multi_vector<column_detail::column_t<MVector,Key>,column_detail::column_t<MVector,Value>> parallel_group_sum(Pool& pool,MVector const& mv)
+	{
+		using namespace column_detail;
+		using groups_type=group_sums<column_t<MVector,Key>,column_t<MVector,Value>,Hash>;
+		auto const n=mv.size();
+		auto const keys=mv.template data<Key>();
+		auto const values=mv.template data<Value>();
+		std::vector<groups_type> partial(chunk_count(n));
+		pool.parallel_for(std::size_t(0),partial.size(),1,[&](std::size_t chunk)
+			{
+				auto const first=chunk*chunk_rows;
+				auto const last=std::min(first+chunk_rows,n);
+				for(std::size_t i=first;i<last;++i)
+				{
+					partial[chunk].add(keys[i],values[i]);
+				}
+			});
+		groups_type groups;
+		for(auto const& part:partial)
+		{
+			for(std::size_t i=0;i<part.keys.size();++i)
+			{
+				groups.add(part.keys[i],part.sums[i]);
+			}
+		}
+		return to_table(groups);
+	}
+}
+#endif
@@ -118,7 +118,7 @@ namespace exlib {
 		{
 			return _base[s];
 		}
-#define iterator_base_comp(op) constexpr bool operator op(Derived other) const noexcept { return _base op other.base() ;}
+#define iterator_base_comp(op) constexpr auto operator op(Derived other) const noexcept { return _base op other.base() ;}
 		EXLIB_FOR_ALL_COMP_OPS(iterator_base_comp)
 #undef comp
 	};
@@ -208,7 +208,7 @@ namespace exlib {
 		{
 			return *(_base-s-1);
 		}
-#define riterator_base_comp(op) constexpr bool operator op(Derived other){ return other.base() op _base ;}
+#define riterator_base_comp(op) constexpr auto operator op(Derived other){ return other.base() op _base ;}
 		EXLIB_FOR_ALL_COMP_OPS(riterator_base_comp)
 #undef comp
 	};
@@ -220,18 +220,18 @@ namespace exlib {
 	template<typename T>
 	struct iterator:iterator_base<T,iterator<T>> {
 		using iterator_base<T,iterator<T>>::iterator_base;
-		iterator(const_iterator<T> ci):iterator_base(ci.base())
+		iterator(const_iterator<T> ci):iterator_base<T,iterator<T>>(ci.base())
 		{}
 	};
 
 	template<typename T>
-	struct const_reverse_iterator:iterator_base<T const,const_reverse_iterator<T>> {
+	struct const_reverse_iterator:riterator_base<T const,const_reverse_iterator<T>> {
 		using riterator_base<T const,const_reverse_iterator<T>>::riterator_base;
 	};
 	template<typename T>
 	struct reverse_iterator:riterator_base<T,reverse_iterator<T>> {
 		using riterator_base<T,reverse_iterator<T>>::riterator_base;
-		reverse_iterator(const_reverse_iterator<T> cri):riterator_base(cri.base())
+		reverse_iterator(const_reverse_iterator<T> cri):riterator_base<T,reverse_iterator<T>>(cri.base())
 		{}
 	};
 
@@ -639,7 +639,7 @@ namespace exlib {
 		return (*it-*it2)/Increment;
 	}
 
-#define make_comp_op_for_gi(op) template<typename Integral,Integral Increment> constexpr bool operator op(count_iterator<Integral,Increment> a,count_iterator<Integral,Increment> b) noexcept {return *a op *b;}
+#define make_comp_op_for_gi(op) template<typename Integral,Integral Increment> constexpr auto operator op(count_iterator<Integral,Increment> a,count_iterator<Integral,Increment> b) noexcept {return *a op *b;}
 	EXLIB_FOR_ALL_COMP_OPS(make_comp_op_for_gi)
 #undef make_comp_op_for_gi
 
@@ -1139,17 +1139,17 @@ namespace exlib {
 
 #define make_multi_reference_compare_base(rtype,op)\
 	template<typename... Types,typename... Types2>\
-	constexpr bool operator op(rtype<Types...> const& a,rtype<Types2...> const& b)\
+	constexpr auto operator op(rtype<Types...> const& a,rtype<Types2...> const& b)\
 	{\
 		return a.base() op b.base();\
 	}\
 	template<typename... Types,typename... Types2>\
-	constexpr bool operator op(std::tuple<Types...> const& a,rtype<Types2...> const& b)\
+	constexpr auto operator op(std::tuple<Types...> const& a,rtype<Types2...> const& b)\
 	{\
 		return a op b.base();\
 	}\
 	template<typename... Types,typename... Types2>\
-	constexpr bool operator op(rtype<Types...> const& a,std::tuple<Types2...> const& b)\
+	constexpr auto operator op(rtype<Types...> const& a,std::tuple<Types2...> const& b)\
 	{\
 		return a.base() op b;\
 	}
@@ -0,0 +1,568 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef EXMAPPED_H
+#define EXMAPPED_H
+#include "exmem.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#define _EXLIB_MAPPED_UNDEF_NOMINMAX
+#endif
+#include <Windows.h>
+#ifdef _EXLIB_MAPPED_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef _EXLIB_MAPPED_UNDEF_NOMINMAX
+#endif
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace exlib {
+
+	enum class map_access {
+		read_only,
+		read_write
+	};
+
+	namespace mapped_detail {
+
+		//at the start of every file, followed by the columns at data_offset
+		struct file_header {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t type_count;
+			std::uint64_t layout;
+			std::uint64_t data_offset;
+			std::uint64_t size;
+			std::uint64_t capacity;
+		};
+
+		constexpr char file_magic[8]={'E','X','M','V','E','C','T','R'};
+		constexpr std::uint32_t file_version=1;
+
+		[[noreturn]] inline void throw_last_error(char const* what)
+		{
+#ifdef _WIN32
+			throw std::system_error(static_cast<int>(GetLastError()),std::system_category(),what);
+#else
+			throw std::system_error(errno,std::generic_category(),what);
+#endif
+		}
+
+		//a file and a shared mapping of its first length() bytes
+		class mapped_file {
+			void* _base=nullptr;
+			std::size_t _length=0;
+			bool _writable=false;
+#ifdef _WIN32
+			HANDLE _file=INVALID_HANDLE_VALUE;
+			HANDLE _mapping=nullptr;
+
+			void release() noexcept
+			{
+				if(_base)
+				{
+					UnmapViewOfFile(_base);
+				}
+				if(_mapping)
+				{
+					CloseHandle(_mapping);
+				}
+				if(_file!=INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(_file);
+				}
+			}
+#else
+			int _fd=-1;
+
+			void release() noexcept
+			{
+				if(_base)
+				{
+					munmap(_base,_length);
+				}
+				if(_fd!=-1)
+				{
+					close(_fd);
+				}
+			}
+#endif
+		public:
+			//opens path, or creates or truncates it if create is set, without mapping anything yet
+			mapped_file(char const* path,map_access access,bool create):_writable(access==map_access::read_write)
+			{
+#ifdef _WIN32
+				_file=CreateFileA(path,GENERIC_READ|(_writable?GENERIC_WRITE:0),FILE_SHARE_READ|FILE_SHARE_WRITE,nullptr,
+					create?CREATE_ALWAYS:OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+				if(_file==INVALID_HANDLE_VALUE)
+				{
+					throw_last_error("CreateFile");
+				}
+#else
+				_fd=::open(path,(_writable?O_RDWR:O_RDONLY)|(create?O_CREAT|O_TRUNC:0),0644);
+				if(_fd==-1)
+				{
+					throw_last_error("open");
+				}
+#endif
+			}
+
+			mapped_file(mapped_file&& other) noexcept:
+				_base(other._base),_length(other._length),_writable(other._writable),
+#ifdef _WIN32
+				_file(other._file),_mapping(other._mapping)
+#else
+				_fd(other._fd)
+#endif
+			{
+				other._base=nullptr;
+				other._length=0;
+#ifdef _WIN32
+				other._file=INVALID_HANDLE_VALUE;
+				other._mapping=nullptr;
+#else
+				other._fd=-1;
+#endif
+			}
+
+			mapped_file& operator=(mapped_file&& other) noexcept
+			{
+				if(this!=&other)
+				{
+					release();
+					_base=other._base;
+					_length=other._length;
+					_writable=other._writable;
+					other._base=nullptr;
+					other._length=0;
+#ifdef _WIN32
+					_file=other._file;
+					_mapping=other._mapping;
+					other._file=INVALID_HANDLE_VALUE;
+					other._mapping=nullptr;
+#else
+					_fd=other._fd;
+					other._fd=-1;
+#endif
+				}
+				return *this;
+			}
+
+			~mapped_file()
+			{
+				release();
+			}
+
+			void* base() const noexcept
+			{
+				return _base;
+			}
+
+			std::size_t length() const noexcept
+			{
+				return _length;
+			}
+
+			bool writable() const noexcept
+			{
+				return _writable;
+			}
+
+			std::uint64_t file_size() const
+			{
+#ifdef _WIN32
+				LARGE_INTEGER size;
+				if(!GetFileSizeEx(_file,&size))
+				{
+					throw_last_error("GetFileSizeEx");
+				}
+				return static_cast<std::uint64_t>(size.QuadPart);
+#else
+				struct stat info;
+				if(fstat(_fd,&info)==-1)
+				{
+					throw_last_error("fstat");
+				}
+				return static_cast<std::uint64_t>(info.st_size);
+#endif
+			}
+
+			/*
+				Maps the first length bytes in place of the current mapping, first growing the file to length if it is writable.
+				The old mapping stays if this throws.
+			*/
+			void map(std::size_t length)
+			{
+#ifdef _WIN32
+				//a writable mapping larger than the file grows it
+				auto const mapping=CreateFileMappingA(_file,nullptr,_writable?PAGE_READWRITE:PAGE_READONLY,
+					static_cast<DWORD>(std::uint64_t(length)>>32),static_cast<DWORD>(length),nullptr);
+				if(!mapping)
+				{
+					throw_last_error("CreateFileMapping");
+				}
+				auto const base=MapViewOfFile(mapping,_writable?FILE_MAP_WRITE:FILE_MAP_READ,0,0,length);
+				if(!base)
+				{
+					auto const error=GetLastError();
+					CloseHandle(mapping);
+					throw std::system_error(static_cast<int>(error),std::system_category(),"MapViewOfFile");
+				}
+				if(_base)
+				{
+					UnmapViewOfFile(_base);
+					CloseHandle(_mapping);
+				}
+				_mapping=mapping;
+#else
+				if(_writable&&file_size()<length)
+				{
+					if(ftruncate(_fd,static_cast<off_t>(length))==-1)
+					{
+						throw_last_error("ftruncate");
+					}
+				}
+				auto const base=mmap(nullptr,length,PROT_READ|(_writable?PROT_WRITE:0),MAP_SHARED,_fd,0);
+				if(base==MAP_FAILED)
+				{
+					throw_last_error("mmap");
+				}
+				if(_base)
+				{
+					munmap(_base,_length);
+				}
+#endif
+				_base=base;
+				_length=length;
+			}
+
+			//writes the mapped pages back to the file
+			void flush() const
+			{
+#ifdef _WIN32
+				if(!FlushViewOfFile(_base,_length)||!FlushFileBuffers(_file))
+				{
+					throw_last_error("FlushViewOfFile");
+				}
+#else
+				if(msync(_base,_length,MS_SYNC)==-1)
+				{
+					throw_last_error("msync");
+				}
+#endif
+			}
+		};
+	}
+
+	/*
+		A multi_vector of trivially copyable types kept in a file mapped into memory, for tables that outlive the process.
+		The file is a small header followed by the columns at the offsets mvector::column_offset gives for the capacity,
+		so opening one reads only the header, and the columns are used where they lie in the page cache.
+		Files opened read only are shared between the processes that map them; writing through data<I>() of one faults.
+		Changes to a writable table reach the file as the system writes back the pages, or at flush().
+		Growing remaps the file and moves the columns apart, which invalidates pointers into it
+		and must not happen while other processes have it open.
+		Files are only checked against the sizes and alignments of the types, and are not portable across byte orders.
+	*/
+	template<std::size_t ColumnAlignment,typename... Types>
+	class basic_mapped_mvector {
+		static_assert(exlib::value_conjunction<std::is_trivially_copyable<Types>::value...>::value,"Types must be trivially copyable");
+		using layout=detail::mvector<std::tuple<Types...>,buffer_allocator<>,ColumnAlignment>;
+		using header_type=mapped_detail::file_header;
+	public:
+		static constexpr std::size_t type_count=sizeof...(Types);
+		using size_type=std::size_t;
+		using value_type=std::tuple<Types...>;
+		template<std::size_t I>
+		using subrange_value_type=typename std::tuple_element<I,value_type>::type;
+
+		//the alignment of every column's data
+		static constexpr size_type column_alignment=layout::column_alignment;
+	private:
+		static_assert(column_alignment<=4096,"Columns cannot be aligned past a page");
+
+		//the columns start on their own cache line after the header
+		static constexpr size_type data_offset=column_alignment>64?column_alignment:64;
+		static_assert(sizeof(header_type)<=data_offset,"Header does not fit");
+
+		mapped_detail::mapped_file _file;
+
+		static constexpr std::uint64_t layout_signature() noexcept
+		{
+			std::size_t const traits[]={ColumnAlignment,sizeof(Types)...,alignof(Types)...};
+			std::uint64_t hash=14695981039346656037ull;
+			for(auto const trait:traits)
+			{
+				hash=(hash^trait)*1099511628211ull;
+			}
+			return hash;
+		}
+
+		static size_type file_length(size_type capacity) noexcept
+		{
+			return data_offset+layout::template column_offset<type_count>(capacity);
+		}
+
+		header_type* header() const noexcept
+		{
+			return static_cast<header_type*>(_file.base());
+		}
+
+		char* columns() const noexcept
+		{
+			return static_cast<char*>(_file.base())+data_offset;
+		}
+
+		explicit basic_mapped_mvector(mapped_detail::mapped_file file) noexcept:_file(std::move(file))
+		{}
+
+		//the highest column moves first, as each column's new place only overlaps the old places of later columns
+		void move_columns(size_type,size_type,index_sequence<>) noexcept
+		{}
+
+		template<std::size_t I,std::size_t... Is>
+		void move_columns(size_type old_capacity,size_type new_capacity,index_sequence<I,Is...>) noexcept
+		{
+			move_columns(old_capacity,new_capacity,index_sequence<Is...>{});
+			std::memmove(columns()+layout::template column_offset<I>(new_capacity),columns()+layout::template column_offset<I>(old_capacity),
+				size()*sizeof(subrange_value_type<I>));
+		}
+
+		void grow_to(size_type new_size)
+		{
+			if(new_size>capacity())
+			{
+				reserve(std::max<size_type>(new_size,2*capacity()));
+			}
+		}
+
+		void assign_columns(size_type,index_sequence<>) noexcept
+		{}
+
+		template<std::size_t I,std::size_t... Is,typename... Rest>
+		void assign_columns(size_type index,index_sequence<I,Is...>,subrange_value_type<I> const& value,Rest const&... rest) noexcept
+		{
+			data<I>()[index]=value;
+			assign_columns(index,index_sequence<Is...>{},rest...);
+		}
+
+		void copy_columns(size_type,size_type,index_sequence<>) noexcept
+		{}
+
+		template<std::size_t I,std::size_t... Is,typename... Rest>
+		void copy_columns(size_type first,size_type n,index_sequence<I,Is...>,subrange_value_type<I> const* column,Rest... rest) noexcept
+		{
+			if(n!=0)
+			{
+				std::memcpy(data<I>()+first,column,n*sizeof(subrange_value_type<I>));
+			}
+			copy_columns(first,n,index_sequence<Is...>{},rest...);
+		}
+
+		void zero_columns(size_type,size_type,index_sequence<>) noexcept
+		{}
+
+		template<std::size_t I,std::size_t... Is>
+		void zero_columns(size_type first,size_type n,index_sequence<I,Is...>) noexcept
+		{
+			std::memset(static_cast<void*>(data<I>()+first),0,n*sizeof(subrange_value_type<I>));
+			zero_columns(first,n,index_sequence<Is...>{});
+		}
+	public:
+		/*
+			Creates the file at path, replacing any file there, holding an empty table with room for capacity elements.
+		*/
+		static basic_mapped_mvector create(char const* path,size_type capacity=0)
+		{
+			mapped_detail::mapped_file file(path,map_access::read_write,true);
+			capacity=layout::aligned_capacity(capacity);
+			file.map(file_length(capacity));
+			auto const header=static_cast<header_type*>(file.base());
+			std::memcpy(header->magic,mapped_detail::file_magic,sizeof(header->magic));
+			header->version=mapped_detail::file_version;
+			header->type_count=type_count;
+			header->layout=layout_signature();
+			header->data_offset=data_offset;
+			header->size=0;
+			header->capacity=capacity;
+			return basic_mapped_mvector(std::move(file));
+		}
+
+		static basic_mapped_mvector create(std::string const& path,size_type capacity=0)
+		{
+			return create(path.c_str(),capacity);
+		}
+
+		/*
+			Maps the table in the file at path without reading past its header.
+			Throws std::system_error if the file cannot be opened or mapped,
+			and std::runtime_error if it does not hold a table of these types.
+		*/
+		static basic_mapped_mvector open(char const* path,map_access access=map_access::read_write)
+		{
+			mapped_detail::mapped_file file(path,access,false);
+			auto const length=file.file_size();
+			if(length<data_offset||length>(std::numeric_limits<size_type>::max)())
+			{
+				throw std::runtime_error("Not a mapped_mvector file");
+			}
+			file.map(static_cast<size_type>(length));
+			auto const header=static_cast<header_type const*>(file.base());
+			if(std::memcmp(header->magic,mapped_detail::file_magic,sizeof(header->magic))!=0||header->version!=mapped_detail::file_version)
+			{
+				throw std::runtime_error("Not a mapped_mvector file");
+			}
+			if(header->type_count!=type_count||header->layout!=layout_signature()||header->data_offset!=data_offset)
+			{
+				throw std::runtime_error("mapped_mvector file holds different types");
+			}
+			if(header->size>header->capacity||header->capacity>layout::max_size()||file_length(header->capacity)>length)
+			{
+				throw std::runtime_error("mapped_mvector file is truncated");
+			}
+			return basic_mapped_mvector(std::move(file));
+		}
+
+		static basic_mapped_mvector open(std::string const& path,map_access access=map_access::read_write)
+		{
+			return open(path.c_str(),access);
+		}
+
+		basic_mapped_mvector(basic_mapped_mvector&&) noexcept=default;
+		basic_mapped_mvector& operator=(basic_mapped_mvector&&) noexcept=default;
+
+		bool writable() const noexcept
+		{
+			return _file.writable();
+		}
+
+		size_type size() const noexcept
+		{
+			return static_cast<size_type>(header()->size);
+		}
+
+		size_type capacity() const noexcept
+		{
+			return static_cast<size_type>(header()->capacity);
+		}
+
+		bool empty() const noexcept
+		{
+			return size()==0;
+		}
+
+		template<std::size_t I>
+		subrange_value_type<I> const* data() const noexcept
+		{
+			return reinterpret_cast<subrange_value_type<I> const*>(columns()+layout::template column_offset<I>(capacity()));
+		}
+
+		template<std::size_t I>
+		subrange_value_type<I>* data() noexcept
+		{
+			return reinterpret_cast<subrange_value_type<I>*>(columns()+layout::template column_offset<I>(capacity()));
+		}
+
+		/*
+			Grows the file to hold at least new_cap elements.
+		*/
+		void reserve(size_type new_cap)
+		{
+			assert(writable());
+			if(new_cap<=capacity())
+			{
+				return;
+			}
+			auto const old_cap=capacity();
+			new_cap=layout::aligned_capacity(new_cap);
+			_file.map(file_length(new_cap));
+			move_columns(old_cap,new_cap,make_index_sequence<type_count>{});
+			header()->capacity=new_cap;
+		}
+
+		/*
+			Resizes to new_size, zeroing any new elements.
+		*/
+		void resize(size_type new_size)
+		{
+			assert(writable());
+			auto const old_size=size();
+			if(new_size>old_size)
+			{
+				grow_to(new_size);
+				zero_columns(old_size,new_size-old_size,make_index_sequence<type_count>{});
+			}
+			header()->size=new_size;
+		}
+
+		void clear() noexcept
+		{
+			assert(writable());
+			header()->size=0;
+		}
+
+		void push_back(Types const&... values)
+		{
+			assert(writable());
+			auto const index=size();
+			grow_to(index+1);
+			assign_columns(index,make_index_sequence<type_count>{},values...);
+			header()->size=index+1;
+		}
+
+		/*
+			Appends n elements, copying each column from an array of n values of its type, growing at most once.
+			Copies an mvector of the same types with append_columns(mv.size(), mv.data<0>(), mv.data<1>(), ...).
+		*/
+		void append_columns(size_type n,Types const*... columns)
+		{
+			assert(writable());
+			auto const first=size();
+			grow_to(first+n);
+			copy_columns(first,n,make_index_sequence<type_count>{},columns...);
+			header()->size=first+n;
+		}
+
+		/*
+			Blocks until the table is written to the file.
+		*/
+		void flush() const
+		{
+			_file.flush();
+		}
+	};
+
+	template<typename Type1,typename... Types>
+	using mapped_multi_vector=basic_mapped_mvector<0,Type1,Types...>;
+
+	//A mapped_multi_vector laid out like aligned_multi_vector
+	template<typename Type1,typename... Types>
+	using mapped_aligned_multi_vector=basic_mapped_mvector<memory_constants::simd_alignment,Type1,Types...>;
+}
+#endif
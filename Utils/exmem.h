@@ -21,7 +21,10 @@ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 #include <array>
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
 #include "extags.h"
 #include "exretype.h"
 #include "exiterator.h"
@@ -42,8 +45,8 @@ namespace exlib {
 
 	template<typename Allocator>
 	class extra_allocator_traits:public std::allocator_traits<Allocator> {
-		template<typename T>
-		static auto destroy_moved_impl(Allocator& a,T* data) -> decltype(a.destroy(data))
+		template<typename T,typename A=Allocator>
+		static auto destroy_moved_impl(A& a,T* data) -> decltype(a.destroy_moved(data))
 		{
 			a.destroy_moved(data);
 		}
@@ -215,18 +218,18 @@ namespace exlib {
 		{}
 		T& operator=(T const& t) noexcept(noexcept(T(t)))
 		{
-			new (_base)(t);
+			new (_base) T(t);
 			return *_base;
 		}
 		T& operator=(T&& t) noexcept(noexcept(T(std::move(t))))
 		{
-			new (_base)(std::move(t));
+			new (_base) T(std::move(t));
 			return *_base;
 		}
 		template<typename... Args>
 		T& emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T,Args&&...>::value)
 		{
-			new (_base)(std::forward<Args>(args)...);
+			new (_base) T(std::forward<Args>(args)...);
 			return *_base;
 		}
 		explicit operator T& () const noexcept
@@ -254,17 +257,17 @@ namespace exlib {
 		using iterator_base<T,uninitialized_iterator<T>>::iterator_base;
 		constexpr uninitialized_reference<T> operator*() const noexcept
 		{
-			return *base();
+			return *this->base();
 		}
 	private:
 		constexpr T* operator->() const noexcept
 		{
-			return base();
+			return this->base();
 		}
 	public:
 		constexpr uninitialized_reference<T> operator[](size_t s) const noexcept
 		{
-			return base()[s];
+			return this->base()[s];
 		}
 	};
 
@@ -361,6 +364,9 @@ namespace exlib {
 #else
 		alignof(std::max_align_t)
 #endif
+		,
+		//widest SIMD register (AVX-512) and cache line size
+		simd_alignment=64
 	};
 
 	namespace exmem_detail {
@@ -385,7 +391,7 @@ namespace exlib {
 			}
 			void deallocate(pointer p,std::size_t) const noexcept
 			{
-				delete[] p;
+				delete[] static_cast<char*>(p);
 			}
 		};
 
@@ -394,20 +400,27 @@ namespace exlib {
 		public:
 			pointer allocate(std::size_t n) const
 			{
+				if(n==0)
+				{
+					return nullptr;
+				}
+				//aligned_alloc wants a multiple of the alignment
+				auto const bytes=(n*ItemSize+Alignment-1)/Alignment*Alignment;
 				auto const ptr=
 #ifdef _WIN32
-					_aligned_malloc(n*ItemSize,Alignment);
+					_aligned_malloc(bytes,Alignment);
 #else
-					aligned_alloc(Alignment,n*ItemSize);
+					aligned_alloc(Alignment,bytes);
 #endif
 				if(!ptr) throw std::bad_alloc{};
+				return static_cast<pointer>(ptr);
 			}
 			void deallocate(pointer p,std::size_t) const noexcept
 			{
 #ifdef _WIN32
 				_aligned_free(p);
 #else
-				free(ptr);
+				free(p);
 #endif
 			}
 		};
@@ -437,15 +450,20 @@ namespace exlib {
 	}
 
 	namespace detail {
-		template<typename Types,typename Allocator>
+		template<typename Types,typename Allocator,std::size_t ColumnAlignment=0>
 		class mvector;
 
 		/*
 			Provide a allocator that allocates n*sum_of_sizes bytes given n as an argument to allocate
+			If ColumnAlignment is 0, each column is aligned to its type.
+			Otherwise every column starts on a multiple of ColumnAlignment bytes and is padded to a whole number of ColumnAlignment blocks,
+			by rounding capacity up to capacity_granularity, so loops over data<I>() up to padded_size() need no scalar tail;
+			the allocator must then return memory aligned to ColumnAlignment.
 		*/
-		template<typename... Types,typename Allocator>
-		class mvector<std::tuple<Types...>,Allocator> {
+		template<typename... Types,typename Allocator,std::size_t ColumnAlignment>
+		class mvector<std::tuple<Types...>,Allocator,ColumnAlignment> {
 			static_assert(exlib::value_conjunction<!std::is_reference<Types>::value...>::value,"No references");
+			static_assert((ColumnAlignment&(ColumnAlignment-1))==0,"ColumnAlignment must be 0 or a power of 2");
 		protected:
 			using TypeTuple=std::tuple<Types...>;
 		public:
@@ -486,11 +504,36 @@ namespace exlib {
 			}
 		protected:
 			static constexpr size_type alignment=get_alignment(idx_seq{});
+		private:
+			static constexpr size_type gcd(size_type a,size_type b)
+			{
+				return b==0?a:gcd(b,a%b);
+			}
+
+			//fewest elements of the Ith type that fill a whole number of ColumnAlignment blocks
+			template<std::size_t I,std::size_t... Is>
+			static constexpr size_type get_granularity(index_sequence<I,Is...>)
+			{
+				return std::max<size_type>(ColumnAlignment/gcd(ColumnAlignment,sizeof(get_t<I>)),get_granularity(index_sequence<Is...>()));
+			}
+
+			static constexpr size_type get_granularity(index_sequence<>)
+			{
+				return 1;
+			}
+		public:
+			static_assert(ColumnAlignment==0||ColumnAlignment>=get_alignment(idx_seq{}),"ColumnAlignment is smaller than a column's alignment");
+
+			//the alignment of every column's data
+			static constexpr size_type column_alignment=ColumnAlignment?ColumnAlignment:alignment;
+
+			//capacity is always a multiple of this
+			static constexpr size_type capacity_granularity=ColumnAlignment?get_granularity(idx_seq{}):1;
 		private:
 			template<typename Ret,typename MV,std::size_t... Is>
-			friend Ret subscript_impl(size_type s,MV& ref,std::index_sequence<Is...>)
+			static Ret subscript_impl(size_type s,MV& ref,index_sequence<Is...>)
 			{
-				return {ref.data<Is>()[s]...};
+				return {ref.template data<Is>()[s]...};
 			}
 		public:
 			reference operator[](size_type s)
@@ -537,7 +580,7 @@ namespace exlib {
 				iterator_op(+)
 				iterator_op(-)
 #undef iterator_op
-#define iterator_comp(op) bool operator op(iterator const& o) const {assert(_parent==o._parent);return _index op o._index;}
+#define iterator_comp(op) auto operator op(iterator const& o) const {assert(_parent==o._parent);return _index op o._index;}
 				EXLIB_FOR_ALL_COMP_OPS(iterator_comp)
 #undef iterator_comp
 				reference operator[](size_t s) const noexcept
@@ -556,7 +599,7 @@ namespace exlib {
 				{
 					return _index-other._index;
 				}
-#define iterator_ment(op) iterator& operator ##op##() noexcept { op##_index;return *this;} iterator operator op(int) noexcept {iterator copy(*this); op##_index;return copy;} 
+#define iterator_ment(op) iterator& operator op() noexcept { op _index;return *this;} iterator operator op(int) noexcept {iterator copy(*this); op _index;return copy;} 
 				iterator_ment(++)
 				iterator_ment(--)
 #undef iterator_ment
@@ -586,7 +629,7 @@ namespace exlib {
 				iterator_op(+)
 				iterator_op(-)
 #undef iterator_op
-#define iterator_comp(op) bool operator op(const_iterator const& o) const noexcept {assert(_parent==o._parent);return _index op o._index;}
+#define iterator_comp(op) auto operator op(const_iterator const& o) const noexcept {assert(_parent==o._parent);return _index op o._index;}
 				EXLIB_FOR_ALL_COMP_OPS(iterator_comp)
 #undef iterator_comp
 				reference operator[](size_t s) const noexcept
@@ -613,7 +656,7 @@ namespace exlib {
 				{
 					return a._index-b._index;
 				}
-#define iterator_ment(op) const_iterator& operator op () noexcept { op##_index;return *this;} const_iterator operator op(int) noexcept {const_iterator copy(*this); op##_index;return copy;} 
+#define iterator_ment(op) const_iterator& operator op () noexcept { op _index;return *this;} const_iterator operator op(int) noexcept {const_iterator copy(*this); op _index;return copy;} 
 				iterator_ment(++)
 				iterator_ment(--)
 #undef iterator_ment
@@ -624,20 +667,20 @@ namespace exlib {
 
 			template<std::size_t I>
 			struct const_subrange_iterator:iterator_base<get_t<I> const,const_subrange_iterator<I>> {
-				using iterator_base::iterator_base;
+				using iterator_base<get_t<I> const,const_subrange_iterator<I>>::iterator_base;
 			};
 			template<std::size_t I>
 			struct subrange_iterator:iterator_base<get_t<I>,subrange_iterator<I>> {
-				using iterator_base::iterator_base;
+				using iterator_base<get_t<I>,subrange_iterator<I>>::iterator_base;
 			};
 
 			template<std::size_t I>
 			struct reverse_subrange_iterator:riterator_base<get_t<I>,reverse_subrange_iterator<I>> {
-				using riterator_base::riterator_base;
+				using riterator_base<get_t<I>,reverse_subrange_iterator<I>>::riterator_base;
 			};
 			template<std::size_t I>
 			struct const_reverse_subrange_iterator:riterator_base<get_t<I> const,const_reverse_subrange_iterator<I>> {
-				using riterator_base::riterator_base;
+				using riterator_base<get_t<I> const,const_reverse_subrange_iterator<I>>::riterator_base;
 			};
 
 		protected:
@@ -674,13 +717,30 @@ namespace exlib {
 			}
 			static constexpr size_type max_size() noexcept
 			{
-				return std::numeric_limits<size_type>::max()/TotalSize;
+				return std::numeric_limits<size_type>::max()/total_size;
+			}
+			/*
+				The byte offset of the Ith array from data() for a buffer holding capacity elements;
+				column_offset<type_count>(capacity) is the size of the whole buffer.
+			*/
+			template<std::size_t I>
+			static constexpr size_type column_offset(size_type capacity) noexcept
+			{
+				return size_up_to<I>::value*capacity;
+			}
+
+			/*
+				The smallest capacity of at least count that keeps every array aligned.
+			*/
+			static size_type aligned_capacity(size_type count) noexcept
+			{
+				return fix_alignment(count);
 			}
 		protected:
 			template<std::size_t I>
 			size_type type_offset() const
 			{
-				return size_up_to<I>::value*capacity();
+				return column_offset<I>(capacity());
 			}
 		public:
 
@@ -698,13 +758,23 @@ namespace exlib {
 			}
 			bool empty() const noexcept
 			{
-				return size==0;
+				return size()==0;
+			}
+
+			/*
+				size() rounded up to capacity_granularity, which capacity() is at least.
+				The elements past size() are uninitialized padding; with ColumnAlignment, vector loops over trivially copyable columns
+				can run up to padded_size() instead of handling a remainder.
+			*/
+			size_type padded_size() const noexcept
+			{
+				return (size()+capacity_granularity-1)/capacity_granularity*capacity_granularity;
 			}
 
 			template<std::size_t I>
 			get_t<I> const* data() const noexcept
 			{
-				return reinterpret_cast<get_t<I> const*>(static_cast<char*>(data())+type_offset<I>());
+				return reinterpret_cast<get_t<I> const*>(static_cast<char const*>(data())+type_offset<I>());
 			}
 			template<std::size_t I>
 			get_t<I>* data() noexcept
@@ -926,7 +996,7 @@ namespace exlib {
 
 			void realloc(size_type new_cap)
 			{
-				assert(new_cap%alignment==0);
+				assert(new_cap==fix_alignment(new_cap));
 				_DataM temp(new_cap,_data.get_allocator_ref());
 				if(noexcept_movable)
 				{
@@ -952,8 +1022,13 @@ namespace exlib {
 			mvector() noexcept:_data(0,Allocator(),0)
 			{}
 		private:
-			static size_t fix_alignment(size_t count)
+			static size_t fix_alignment(size_t count) noexcept
 			{
+				if(ColumnAlignment)
+				{
+					auto const rem=count%capacity_granularity;
+					return rem?count+(capacity_granularity-rem):count;
+				}
 				if (type_count<2)
 				{
 					return count;
@@ -978,7 +1053,7 @@ namespace exlib {
 					}
 					catch(...)
 					{
-						destroy_range<I>(loc+first,last-i);
+						destroy_range<I>(loc+first,i-first);
 						throw;
 					}
 				}
@@ -995,6 +1070,7 @@ namespace exlib {
 				catch(...)
 				{
 					destroy_range<I>(data<I>()+first,last-first);
+					throw;
 				}
 			}
 			template<std::size_t I,std::size_t... Is>
@@ -1008,6 +1084,7 @@ namespace exlib {
 				catch(...)
 				{
 					destroy_range<I>(data<I>()+first,last-first);
+					throw;
 				}
 			}
 
@@ -1050,7 +1127,7 @@ namespace exlib {
 				auto const new_size=size()+1;
 				if(new_size>capacity())
 				{
-					realloc(2*capacity()+alignment);
+					realloc(fix_alignment(2*capacity()+alignment));
 				}
 				push_back_unchecked(std::forward<Args>(args)...);
 			}
@@ -1064,6 +1141,85 @@ namespace exlib {
 				force_set_size(new_size);
 			}
 
+		private:
+			void grow_to(size_type new_size)
+			{
+				if(new_size>capacity())
+				{
+					realloc(fix_alignment(std::max<size_type>(new_size,2*capacity())));
+				}
+			}
+
+			template<std::size_t I>
+			void append_range(size_type first,size_type n,get_t<I> const* src,std::true_type)
+			{
+				if(n!=0)
+				{
+					std::memcpy(data<I>()+first,src,n*sizeof(get_t<I>));
+				}
+			}
+
+			template<std::size_t I>
+			void append_range(size_type first,size_type n,get_t<I> const* src,std::false_type)
+			{
+				auto const dst=data<I>()+first;
+				for(size_type i=0;i<n;++i)
+				{
+					try
+					{
+						do_construct<I>(dst+i,src[i]);
+					}
+					catch(...)
+					{
+						destroy_range<I>(dst,i);
+						throw;
+					}
+				}
+			}
+
+			template<std::size_t I,std::size_t... Is,typename... Rest>
+			void append_ranges(size_type first,size_type n,index_sequence<I,Is...>,get_t<I> const* src,Rest... rest)
+			{
+				append_range<I>(first,n,src,std::is_trivially_copyable<get_t<I>>{});
+				try
+				{
+					append_ranges(first,n,index_sequence<Is...>{},rest...);
+				}
+				catch(...)
+				{
+					destroy_range<I>(data<I>()+first,n);
+					throw;
+				}
+			}
+
+			void append_ranges(size_type,size_type,index_sequence<>)
+			{}
+		public:
+			/*
+				Appends n elements whose columns are constructed from args, growing at most once.
+			*/
+			template<typename... Args>
+			void push_back_n(size_type n,Args const&... args)
+			{
+				static_assert(sizeof...(args)<=type_count,"Too many arguments");
+				auto const new_size=size()+n;
+				grow_to(new_size);
+				construct_ranges(size(),new_size,idx_seq{},args...);
+				force_set_size(new_size);
+			}
+
+			/*
+				Appends n elements, copying each column from an array of n values of its type, growing at most once.
+				Trivially copyable columns are copied as one block with memcpy. The arrays must not be in this mvector.
+			*/
+			void append_columns(size_type n,Types const*... columns)
+			{
+				auto const new_size=size()+n;
+				grow_to(new_size);
+				append_ranges(size(),n,idx_seq{},columns...);
+				force_set_size(new_size);
+			}
+
 		private:
 			template<std::size_t I,std::size_t... Is>
 			void erase_impl(size_type first,size_type last,index_sequence<I,Is...>)
@@ -1162,10 +1318,7 @@ namespace exlib {
 				}
 				if(s>size())
 				{
-					if(s>capacity())
-					{
-						realloc(fix_aligment(2*capacity()+1));
-					}
+					grow_to(s);
 					construct_ranges(size(),s,idx_seq{},args...);
 					force_set_size(s);
 				}
@@ -1209,6 +1362,14 @@ namespace exlib {
 		std::tuple<Type1,Types...>,
 		buffer_allocator<detail::tuple_size_sum<std::tuple<Type1,Types...>>::value,alignof(std::tuple<Type1,Types...>)>>;
 
+	//A multi_vector whose arrays each start on a simd_alignment boundary and are padded to a multiple of simd_alignment bytes,
+	//for aligned vector loads and stores over data<I>() up to padded_size()
+	template<typename Type1,typename... Types>
+	using aligned_multi_vector=detail::mvector<
+		std::tuple<Type1,Types...>,
+		buffer_allocator<detail::tuple_size_sum<std::tuple<Type1,Types...>>::value,memory_constants::simd_alignment>,
+		memory_constants::simd_alignment>;
+
 	namespace stack_array_detail {
 
 		template<typename T>
@@ -1311,7 +1472,10 @@ namespace exlib {
 			{
 				if(!std::is_trivial<T>::value)
 				{
-					new (data()+i) T;
+					for(std::size_t i=0;i<_size;++i)
+					{
+						new (data()+i) T;
+					}
 				}
 			}
 			reference operator[](std::size_t s) noexcept
@@ -1455,6 +1619,695 @@ namespace exlib {
 	template<typename T>
 	using stack_array=stack_array_detail::stack_array<T>;
 
+	/*
+		Vector that keeps up to N elements inside itself and moves them to memory from Allocator once it holds more,
+		so small vectors never touch the heap, and unlike stack_array it can be returned and stored.
+		Growing relocates the elements: with memcpy if is_trivially_relocatable<T>, and otherwise by moving them,
+		or copying them if moving may throw, then ending the originals with extra_allocator_traits::destroy_moved.
+		Inserting and erasing shift trivially relocatable elements with memmove.
+		Moving a small_vector steals its heap memory, but has to relocate elements that are still inline.
+	*/
+	template<typename T,std::size_t N,typename Allocator=std::allocator<T>>
+	class small_vector:private empty_store<Allocator> {
+		static_assert(N>0,"small_vector needs room for an element; use std::vector");
+		using Base=empty_store<Allocator>;
+		using Traits=extra_allocator_traits<Allocator>;
+		using relocatable=is_trivially_relocatable<T>;
+		//as std::move_if_noexcept
+		using move_relocates=std::integral_constant<bool,std::is_nothrow_move_constructible<T>::value||!std::is_copy_constructible<T>::value>;
+	public:
+		using value_type=T;
+		using allocator_type=Allocator;
+		using size_type=std::size_t;
+		using difference_type=std::ptrdiff_t;
+		using reference=T&;
+		using const_reference=T const&;
+		using pointer=T*;
+		using const_pointer=T const*;
+		using iterator=pointer;
+		using const_iterator=const_pointer;
+		using reverse_iterator=std::reverse_iterator<iterator>;
+		using const_reverse_iterator=std::reverse_iterator<const_iterator>;
+
+		static constexpr size_type inline_capacity=N;
+	private:
+		T* _data;
+		size_type _size;
+		size_type _capacity;
+		typename std::aligned_storage<sizeof(T)*N,alignof(T)>::type _inline;
+
+		Allocator& alloc() noexcept
+		{
+			return Base::get();
+		}
+		Allocator const& alloc() const noexcept
+		{
+			return Base::get();
+		}
+
+		T* inline_data() noexcept
+		{
+			return reinterpret_cast<T*>(&_inline);
+		}
+
+		void destroy_range(T* first,T* last) noexcept
+		{
+			if(!std::is_trivially_destructible<T>::value)
+			{
+				for(;first!=last;++first)
+				{
+					Traits::destroy(alloc(),first);
+				}
+			}
+		}
+
+		void release_heap() noexcept
+		{
+			if(!is_inline())
+			{
+				Traits::deallocate(alloc(),_data,_capacity);
+			}
+		}
+
+		//moves n elements from src to the uninitialized dst, ending the originals
+		void relocate(T* src,size_type n,T* dst,std::true_type) noexcept
+		{
+			if(n!=0)
+			{
+				std::memcpy(static_cast<void*>(dst),static_cast<void const*>(src),n*sizeof(T));
+			}
+		}
+
+		void relocate(T* src,size_type n,T* dst,std::false_type)
+		{
+			relocate_elements(src,n,dst,move_relocates{});
+		}
+
+		void relocate(T* src,size_type n,T* dst)
+		{
+			relocate(src,n,dst,relocatable{});
+		}
+
+		void relocate_elements(T* src,size_type n,T* dst,std::true_type) noexcept(std::is_nothrow_move_constructible<T>::value)
+		{
+			for(size_type i=0;i<n;++i)
+			{
+				Traits::construct(alloc(),dst+i,std::move(src[i]));
+				Traits::destroy_moved(alloc(),src+i);
+			}
+		}
+
+		//copies all before destroying any, so the originals survive a throwing copy
+		void relocate_elements(T* src,size_type n,T* dst,std::false_type)
+		{
+			size_type i=0;
+			try
+			{
+				for(;i<n;++i)
+				{
+					Traits::construct(alloc(),dst+i,src[i]);
+				}
+			}
+			catch(...)
+			{
+				destroy_range(dst,dst+i);
+				throw;
+			}
+			destroy_range(src,src+n);
+		}
+
+		size_type next_capacity(size_type needed) const noexcept
+		{
+			return std::max(needed,2*_capacity);
+		}
+
+		//moves the elements to a buffer of new_cap, which must hold them
+		void reallocate(size_type new_cap)
+		{
+			auto const fresh=Traits::allocate(alloc(),new_cap);
+			try
+			{
+				relocate(_data,_size,fresh);
+			}
+			catch(...)
+			{
+				Traits::deallocate(alloc(),fresh,new_cap);
+				throw;
+			}
+			release_heap();
+			_data=fresh;
+			_capacity=new_cap;
+		}
+
+		//constructs the new element before relocating, as args may refer to an element
+		template<typename... Args>
+		reference grow_emplace_back(Args&&... args)
+		{
+			auto const new_cap=next_capacity(_size+1);
+			auto const fresh=Traits::allocate(alloc(),new_cap);
+			try
+			{
+				Traits::construct(alloc(),fresh+_size,std::forward<Args>(args)...);
+			}
+			catch(...)
+			{
+				Traits::deallocate(alloc(),fresh,new_cap);
+				throw;
+			}
+			try
+			{
+				relocate(_data,_size,fresh);
+			}
+			catch(...)
+			{
+				Traits::destroy(alloc(),fresh+_size);
+				Traits::deallocate(alloc(),fresh,new_cap);
+				throw;
+			}
+			release_heap();
+			_data=fresh;
+			_capacity=new_cap;
+			return _data[_size++];
+		}
+
+		//shifts the elements from p on up by one and moves value into the gap; size() must be below capacity()
+		void insert_gap(T* p,T&& value,std::true_type)
+		{
+			auto const bytes=(end()-p)*sizeof(T);
+			std::memmove(static_cast<void*>(p+1),static_cast<void const*>(p),bytes);
+			try
+			{
+				Traits::construct(alloc(),p,std::move(value));
+			}
+			catch(...)
+			{
+				std::memmove(static_cast<void*>(p),static_cast<void const*>(p+1),bytes);
+				throw;
+			}
+			++_size;
+		}
+
+		void insert_gap(T* p,T&& value,std::false_type)
+		{
+			auto const last=end();
+			Traits::construct(alloc(),last,std::move(last[-1]));
+			++_size;
+			std::move_backward(p,last-1,last);
+			*p=std::move(value);
+		}
+
+		void erase_range(T* first,T* last,std::true_type) noexcept
+		{
+			destroy_range(first,last);
+			std::memmove(static_cast<void*>(first),static_cast<void const*>(last),(end()-last)*sizeof(T));
+		}
+
+		void erase_range(T* first,T* last,std::false_type)
+		{
+			auto const new_end=std::move(last,end(),first);
+			destroy_range(new_end,end());
+		}
+
+		//fills a new small_vector, freeing what was made if one throws
+		template<typename Iter>
+		void construct_from(Iter first,Iter last)
+		{
+			try
+			{
+				for(;first!=last;++first)
+				{
+					emplace_back(*first);
+				}
+			}
+			catch(...)
+			{
+				destroy_range(begin(),end());
+				release_heap();
+				throw;
+			}
+		}
+
+		void construct_n(size_type n,T const* value)
+		{
+			reserve(n);
+			try
+			{
+				for(;_size<n;++_size)
+				{
+					if(value)
+					{
+						Traits::construct(alloc(),_data+_size,*value);
+					}
+					else
+					{
+						Traits::construct(alloc(),_data+_size);
+					}
+				}
+			}
+			catch(...)
+			{
+				destroy_range(begin(),end());
+				release_heap();
+				throw;
+			}
+		}
+	public:
+		small_vector() noexcept(std::is_nothrow_default_constructible<Allocator>::value):_data(inline_data()),_size(0),_capacity(N)
+		{}
+
+		explicit small_vector(Allocator const& a) noexcept:Base(a),_data(inline_data()),_size(0),_capacity(N)
+		{}
+
+		explicit small_vector(size_type n,Allocator const& a=Allocator()):small_vector(a)
+		{
+			construct_n(n,nullptr);
+		}
+
+		small_vector(size_type n,T const& value,Allocator const& a=Allocator()):small_vector(a)
+		{
+			construct_n(n,&value);
+		}
+
+		template<typename Iter,typename=typename std::iterator_traits<Iter>::iterator_category>
+		small_vector(Iter first,Iter last,Allocator const& a=Allocator()):small_vector(a)
+		{
+			construct_from(first,last);
+		}
+
+		small_vector(std::initializer_list<T> list,Allocator const& a=Allocator()):small_vector(a)
+		{
+			reserve(list.size());
+			construct_from(list.begin(),list.end());
+		}
+
+		small_vector(small_vector const& other):small_vector(Traits::select_on_container_copy_construction(other.alloc()))
+		{
+			reserve(other.size());
+			construct_from(other.begin(),other.end());
+		}
+
+		small_vector(small_vector&& other) noexcept(relocatable::value||std::is_nothrow_move_constructible<T>::value):
+			Base(std::move(other.alloc())),_data(inline_data()),_size(0),_capacity(N)
+		{
+			if(other.is_inline())
+			{
+				relocate(other._data,other._size,_data);
+				_size=other._size;
+			}
+			else
+			{
+				_data=other._data;
+				_size=other._size;
+				_capacity=other._capacity;
+				other._data=other.inline_data();
+				other._capacity=N;
+			}
+			other._size=0;
+		}
+
+		small_vector& operator=(small_vector const& other)
+		{
+			if(this!=&other)
+			{
+				if(Traits::propagate_on_container_copy_assignment::value&&alloc()!=other.alloc())
+				{
+					clear();
+					release_heap();
+					_data=inline_data();
+					_capacity=N;
+					alloc()=other.alloc();
+				}
+				assign(other.begin(),other.end());
+			}
+			return *this;
+		}
+
+		small_vector& operator=(small_vector&& other) noexcept(relocatable::value||std::is_nothrow_move_constructible<T>::value)
+		{
+			if(this!=&other)
+			{
+				clear();
+				if(!other.is_inline()&&(Traits::propagate_on_container_move_assignment::value||alloc()==other.alloc()))
+				{
+					release_heap();
+					if(Traits::propagate_on_container_move_assignment::value)
+					{
+						alloc()=std::move(other.alloc());
+					}
+					_data=other._data;
+					_capacity=other._capacity;
+					other._data=other.inline_data();
+					other._capacity=N;
+				}
+				else
+				{
+					reserve(other._size);
+					relocate(other._data,other._size,_data);
+				}
+				_size=other._size;
+				other._size=0;
+			}
+			return *this;
+		}
+
+		small_vector& operator=(std::initializer_list<T> list)
+		{
+			assign(list.begin(),list.end());
+			return *this;
+		}
+
+		~small_vector()
+		{
+			destroy_range(begin(),end());
+			release_heap();
+		}
+
+		template<typename Iter,typename=typename std::iterator_traits<Iter>::iterator_category>
+		void assign(Iter first,Iter last)
+		{
+			clear();
+			for(;first!=last;++first)
+			{
+				emplace_back(*first);
+			}
+		}
+
+		allocator_type get_allocator() const noexcept
+		{
+			return alloc();
+		}
+
+		/*
+			Whether the elements are in the inline buffer rather than on the heap.
+		*/
+		bool is_inline() const noexcept
+		{
+			return _data==reinterpret_cast<T const*>(&_inline);
+		}
+
+		reference operator[](size_type s) noexcept
+		{
+			return _data[s];
+		}
+		const_reference operator[](size_type s) const noexcept
+		{
+			return _data[s];
+		}
+		reference at(size_type s)
+		{
+			if(s>=_size)
+			{
+				throw std::out_of_range("small_vector index out of range");
+			}
+			return _data[s];
+		}
+		const_reference at(size_type s) const
+		{
+			if(s>=_size)
+			{
+				throw std::out_of_range("small_vector index out of range");
+			}
+			return _data[s];
+		}
+		reference front() noexcept
+		{
+			return _data[0];
+		}
+		const_reference front() const noexcept
+		{
+			return _data[0];
+		}
+		reference back() noexcept
+		{
+			return _data[_size-1];
+		}
+		const_reference back() const noexcept
+		{
+			return _data[_size-1];
+		}
+		T* data() noexcept
+		{
+			return _data;
+		}
+		T const* data() const noexcept
+		{
+			return _data;
+		}
+
+		iterator begin() noexcept
+		{
+			return _data;
+		}
+		iterator end() noexcept
+		{
+			return _data+_size;
+		}
+		const_iterator begin() const noexcept
+		{
+			return _data;
+		}
+		const_iterator end() const noexcept
+		{
+			return _data+_size;
+		}
+		const_iterator cbegin() const noexcept
+		{
+			return begin();
+		}
+		const_iterator cend() const noexcept
+		{
+			return end();
+		}
+		reverse_iterator rbegin() noexcept
+		{
+			return reverse_iterator{end()};
+		}
+		reverse_iterator rend() noexcept
+		{
+			return reverse_iterator{begin()};
+		}
+		const_reverse_iterator rbegin() const noexcept
+		{
+			return const_reverse_iterator{end()};
+		}
+		const_reverse_iterator rend() const noexcept
+		{
+			return const_reverse_iterator{begin()};
+		}
+		const_reverse_iterator crbegin() const noexcept
+		{
+			return rbegin();
+		}
+		const_reverse_iterator crend() const noexcept
+		{
+			return rend();
+		}
+
+		bool empty() const noexcept
+		{
+			return _size==0;
+		}
+		size_type size() const noexcept
+		{
+			return _size;
+		}
+		size_type capacity() const noexcept
+		{
+			return _capacity;
+		}
+		size_type max_size() const noexcept
+		{
+			return Traits::max_size(alloc());
+		}
+
+		void reserve(size_type new_cap)
+		{
+			if(new_cap>_capacity)
+			{
+				reallocate(new_cap);
+			}
+		}
+
+		/*
+			Frees unused heap memory, moving the elements back inline if they fit.
+		*/
+		void shrink_to_fit()
+		{
+			if(is_inline()||_size==_capacity)
+			{
+				return;
+			}
+			if(_size<=N)
+			{
+				auto const heap=_data;
+				auto const heap_cap=_capacity;
+				relocate(heap,_size,inline_data());
+				_data=inline_data();
+				_capacity=N;
+				Traits::deallocate(alloc(),heap,heap_cap);
+			}
+			else
+			{
+				reallocate(_size);
+			}
+		}
+
+		template<typename... Args>
+		reference emplace_back(Args&&... args)
+		{
+			if(_size==_capacity)
+			{
+				return grow_emplace_back(std::forward<Args>(args)...);
+			}
+			Traits::construct(alloc(),_data+_size,std::forward<Args>(args)...);
+			return _data[_size++];
+		}
+
+		void push_back(T const& value)
+		{
+			emplace_back(value);
+		}
+		void push_back(T&& value)
+		{
+			emplace_back(std::move(value));
+		}
+
+		void pop_back() noexcept
+		{
+			--_size;
+			Traits::destroy(alloc(),_data+_size);
+		}
+
+		template<typename... Args>
+		iterator emplace(const_iterator pos,Args&&... args)
+		{
+			auto const index=pos-cbegin();
+			if(static_cast<size_type>(index)==_size)
+			{
+				emplace_back(std::forward<Args>(args)...);
+			}
+			else
+			{
+				//made first, as args may refer to an element
+				T value(std::forward<Args>(args)...);
+				if(_size==_capacity)
+				{
+					reallocate(next_capacity(_size+1));
+				}
+				insert_gap(_data+index,std::move(value),relocatable{});
+			}
+			return _data+index;
+		}
+
+		iterator insert(const_iterator pos,T const& value)
+		{
+			return emplace(pos,value);
+		}
+		iterator insert(const_iterator pos,T&& value)
+		{
+			return emplace(pos,std::move(value));
+		}
+
+		iterator erase(const_iterator first,const_iterator last)
+		{
+			auto const f=_data+(first-cbegin());
+			auto const l=_data+(last-cbegin());
+			if(f!=l)
+			{
+				erase_range(f,l,relocatable{});
+				_size-=l-f;
+			}
+			return f;
+		}
+		iterator erase(const_iterator pos)
+		{
+			return erase(pos,pos+1);
+		}
+
+		void clear() noexcept
+		{
+			destroy_range(begin(),end());
+			_size=0;
+		}
+
+		void resize(size_type n)
+		{
+			resize_impl(n,nullptr);
+		}
+		void resize(size_type n,T const& value)
+		{
+			resize_impl(n,&value);
+		}
+	private:
+		void resize_impl(size_type n,T const* value)
+		{
+			if(n<=_size)
+			{
+				destroy_range(_data+n,end());
+				_size=n;
+				return;
+			}
+			if(n>_capacity)
+			{
+				//value may be an element, so it is copied before relocating
+				if(value)
+				{
+					T const copy(*value);
+					reallocate(next_capacity(n));
+					resize_impl(n,&copy);
+					return;
+				}
+				reallocate(next_capacity(n));
+			}
+			auto const old_size=_size;
+			try
+			{
+				for(;_size<n;++_size)
+				{
+					if(value)
+					{
+						Traits::construct(alloc(),_data+_size,*value);
+					}
+					else
+					{
+						Traits::construct(alloc(),_data+_size);
+					}
+				}
+			}
+			catch(...)
+			{
+				destroy_range(_data+old_size,end());
+				_size=old_size;
+				throw;
+			}
+		}
+	public:
+		void swap(small_vector& other) noexcept(relocatable::value||std::is_nothrow_move_constructible<T>::value)
+		{
+			small_vector temp(std::move(other));
+			other=std::move(*this);
+			*this=std::move(temp);
+		}
+
+		friend void swap(small_vector& a,small_vector& b) noexcept(noexcept(a.swap(b)))
+		{
+			a.swap(b);
+		}
+
+		friend bool operator==(small_vector const& a,small_vector const& b)
+		{
+			return a.size()==b.size()&&std::equal(a.begin(),a.end(),b.begin());
+		}
+		friend bool operator!=(small_vector const& a,small_vector const& b)
+		{
+			return !(a==b);
+		}
+		friend bool operator<(small_vector const& a,small_vector const& b)
+		{
+			return std::lexicographical_compare(a.begin(),a.end(),b.begin(),b.end());
+		}
+	};
+
 }
 #undef IFCONSTEXPR
 #endif
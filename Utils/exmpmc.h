@@ -0,0 +1,448 @@
+/*
+Copyright 2019 Edward Xie
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+#ifndef EXMPMC_H
+#define EXMPMC_H
+#include "exmem.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+namespace exlib {
+
+	namespace mpmc_detail {
+
+		constexpr std::size_t cache_line_size=64;
+
+		//an atomic position alone on its cache line, so producers and consumers do not false share
+		struct padded_position {
+			std::atomic<std::size_t> value;
+			char pad[cache_line_size-sizeof(std::atomic<std::size_t>)];
+			padded_position() noexcept:value(0)
+			{}
+		};
+
+		inline std::size_t round_up_pow2(std::size_t n) noexcept
+		{
+			std::size_t p=1;
+			while(p<n)
+			{
+				p<<=1;
+			}
+			return p;
+		}
+
+		inline std::ptrdiff_t sequence_difference(std::size_t a,std::size_t b) noexcept
+		{
+			return static_cast<std::ptrdiff_t>(a-b);
+		}
+	}
+
+	/*
+		A bounded multi-producer multi-consumer queue.
+		Each cell of the ring carries a sequence number that says whether it is ready to be written or read for the current lap,
+		so producers and consumers only contend on their own position and never take a lock in the try_ operations.
+		Capacity is rounded up to a power of 2.
+		The blocking operations spin on the try_ operations and sleep on a condition variable only when the queue is full or empty;
+		the try_ operations take the lock to wake sleepers only if a sleeper exists.
+		Moving T must not throw.
+	*/
+	template<typename T,typename Allocator=std::allocator<T>>
+	class mpmc_queue {
+	public:
+		using value_type=T;
+		using size_type=std::size_t;
+		using allocator_type=Allocator;
+	private:
+		static_assert(std::is_nothrow_move_constructible<T>::value,"mpmc_queue requires T to be nothrow move constructible");
+		struct cell {
+			std::atomic<std::size_t> sequence;
+			typename std::aligned_storage<sizeof(T),alignof(T)>::type storage;
+			explicit cell(std::size_t seq) noexcept:sequence(seq)
+			{}
+			T* data() noexcept
+			{
+				return reinterpret_cast<T*>(&storage);
+			}
+		};
+		using cell_allocator=typename std::allocator_traits<Allocator>::template rebind_alloc<cell>;
+		using cell_traits=std::allocator_traits<cell_allocator>;
+
+		allocator_ptr<cell,cell_allocator> _cells;
+		std::size_t _mask;
+		char _pad[mpmc_detail::cache_line_size];
+		mpmc_detail::padded_position _push_pos;
+		mpmc_detail::padded_position _pop_pos;
+		std::mutex _mtx;
+		std::condition_variable _not_empty;
+		std::condition_variable _not_full;
+		std::atomic<std::size_t> _waiting_pushers;
+		std::atomic<std::size_t> _waiting_poppers;
+
+		cell& at(std::size_t pos) noexcept
+		{
+			return _cells[pos&_mask];
+		}
+
+		//claims up to max consecutive cells whose sequence is ready for lap offset; returns the first position and sets count
+		std::size_t claim(mpmc_detail::padded_position& position,std::size_t offset,std::size_t max,std::size_t& count) noexcept
+		{
+			auto pos=position.value.load(std::memory_order_relaxed);
+			while(true)
+			{
+				std::size_t n=0;
+				for(;n<max&&n<=_mask;++n)
+				{
+					auto const seq=at(pos+n).sequence.load(std::memory_order_acquire);
+					if(seq!=pos+n+offset)
+					{
+						break;
+					}
+				}
+				if(n==0)
+				{
+					auto const seq=at(pos).sequence.load(std::memory_order_acquire);
+					if(mpmc_detail::sequence_difference(seq,pos+offset)<0)
+					{
+						count=0;
+						return pos;
+					}
+					pos=position.value.load(std::memory_order_relaxed);
+					continue;
+				}
+				if(position.value.compare_exchange_weak(pos,pos+n,std::memory_order_relaxed))
+				{
+					count=n;
+					return pos;
+				}
+			}
+		}
+
+		void publish_push(cell& c,std::size_t pos) noexcept
+		{
+			c.sequence.store(pos+1,std::memory_order_release);
+		}
+
+		void publish_pop(cell& c,std::size_t pos) noexcept
+		{
+			c.data()->~T();
+			c.sequence.store(pos+_mask+1,std::memory_order_release);
+		}
+
+		void wake(std::atomic<std::size_t>& waiting,std::condition_variable& cv) noexcept
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(waiting.load(std::memory_order_relaxed)!=0)
+			{
+				std::lock_guard<std::mutex> lock{_mtx};
+				cv.notify_all();
+			}
+		}
+
+		template<typename Ready>
+		void sleep_until(std::atomic<std::size_t>& waiting,std::condition_variable& cv,Ready ready)
+		{
+			std::unique_lock<std::mutex> lock{_mtx};
+			waiting.fetch_add(1,std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!ready())
+			{
+				cv.wait(lock);
+			}
+			waiting.fetch_sub(1,std::memory_order_relaxed);
+		}
+
+		bool full_now() noexcept
+		{
+			auto const pos=_push_pos.value.load(std::memory_order_relaxed);
+			return mpmc_detail::sequence_difference(at(pos).sequence.load(std::memory_order_acquire),pos)<0;
+		}
+
+		bool empty_now() noexcept
+		{
+			auto const pos=_pop_pos.value.load(std::memory_order_relaxed);
+			return mpmc_detail::sequence_difference(at(pos).sequence.load(std::memory_order_acquire),pos+1)<0;
+		}
+
+		template<typename... Args>
+		bool try_emplace_impl(std::true_type,Args&&... args) noexcept
+		{
+			std::size_t count;
+			auto const pos=claim(_push_pos,0,1,count);
+			if(count==0)
+			{
+				return false;
+			}
+			auto& c=at(pos);
+			new (c.data()) T(std::forward<Args>(args)...);
+			publish_push(c,pos);
+			wake(_waiting_poppers,_not_empty);
+			return true;
+		}
+
+		template<typename... Args>
+		bool try_emplace_impl(std::false_type,Args&&... args)
+		{
+			if(full_now())
+			{
+				return false;
+			}
+			T temp(std::forward<Args>(args)...);
+			return try_emplace_impl(std::true_type{},std::move(temp));
+		}
+	public:
+		/*
+			Creates a queue that holds at least capacity elements.
+		*/
+		explicit mpmc_queue(size_type capacity,Allocator const& alloc=Allocator()):
+			_cells(mpmc_detail::round_up_pow2(capacity),cell_allocator(alloc)),
+			_mask(_cells.capacity()-1),
+			_waiting_pushers(0),
+			_waiting_poppers(0)
+		{
+			if(capacity==0)
+			{
+				throw std::invalid_argument("mpmc_queue capacity must be positive");
+			}
+			for(std::size_t i=0;i<=_mask;++i)
+			{
+				new (&_cells[i]) cell(i);
+			}
+		}
+
+		mpmc_queue(mpmc_queue const&)=delete;
+		mpmc_queue& operator=(mpmc_queue const&)=delete;
+
+		/*
+			Destroys the elements still in the queue. No other thread may be using the queue.
+		*/
+		~mpmc_queue()
+		{
+			auto const end=_push_pos.value.load(std::memory_order_relaxed);
+			for(auto pos=_pop_pos.value.load(std::memory_order_relaxed);pos!=end;++pos)
+			{
+				at(pos).data()->~T();
+			}
+			for(std::size_t i=0;i<=_mask;++i)
+			{
+				_cells[i].~cell();
+			}
+		}
+
+		allocator_type get_allocator() const noexcept
+		{
+			return allocator_type(_cells.get_allocator());
+		}
+
+		size_type capacity() const noexcept
+		{
+			return _mask+1;
+		}
+
+		/*
+			The number of elements in the queue at some moment during the call.
+		*/
+		size_type size_approx() const noexcept
+		{
+			auto const pop=_pop_pos.value.load(std::memory_order_acquire);
+			auto const push=_push_pos.value.load(std::memory_order_acquire);
+			auto const diff=mpmc_detail::sequence_difference(push,pop);
+			return diff<0?0:static_cast<size_type>(diff);
+		}
+
+		bool empty() const noexcept
+		{
+			return size_approx()==0;
+		}
+
+		/*
+			Constructs an element at the back if there is room.
+			If constructing T from args can throw, it is constructed before a cell is claimed.
+		*/
+		template<typename... Args>
+		bool try_emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T,Args&&...>::value)
+		{
+			return try_emplace_impl(std::integral_constant<bool,std::is_nothrow_constructible<T,Args&&...>::value>{},std::forward<Args>(args)...);
+		}
+
+		bool try_push(T const& value) noexcept(std::is_nothrow_copy_constructible<T>::value)
+		{
+			return try_emplace(value);
+		}
+
+		/*
+			Moves value into the queue if there is room; value is untouched otherwise.
+		*/
+		bool try_push(T&& value) noexcept
+		{
+			return try_emplace_impl(std::true_type{},std::move(value));
+		}
+
+		/*
+			Moves the front element into out if there is one.
+		*/
+		bool try_pop(T& out) noexcept(std::is_nothrow_move_assignable<T>::value)
+		{
+			std::size_t count;
+			auto const pos=claim(_pop_pos,1,1,count);
+			if(count==0)
+			{
+				return false;
+			}
+			auto& c=at(pos);
+			out=std::move(*c.data());
+			publish_pop(c,pos);
+			wake(_waiting_pushers,_not_full);
+			return true;
+		}
+
+		/*
+			Pushes up to n elements from first, claiming them with a single atomic operation, and returns the number pushed.
+			Constructing T from *first must not throw; use a move_iterator to move elements in.
+		*/
+		template<typename Iter>
+		size_type try_push_n(Iter first,size_type n) noexcept
+		{
+			static_assert(std::is_nothrow_constructible<T,decltype(*first)>::value,"constructing from the iterator must not throw");
+			std::size_t count;
+			auto const pos=claim(_push_pos,0,n,count);
+			for(std::size_t i=0;i<count;++i,++first)
+			{
+				auto& c=at(pos+i);
+				new (c.data()) T(*first);
+				publish_push(c,pos+i);
+			}
+			if(count!=0)
+			{
+				wake(_waiting_poppers,_not_empty);
+			}
+			return count;
+		}
+
+		/*
+			Pops up to n elements into out, claiming them with a single atomic operation, and returns the number popped.
+		*/
+		template<typename OutIter>
+		size_type try_pop_n(OutIter out,size_type n)
+		{
+			std::size_t count;
+			auto const pos=claim(_pop_pos,1,n,count);
+			for(std::size_t i=0;i<count;++i,++out)
+			{
+				auto& c=at(pos+i);
+				*out=std::move(*c.data());
+				publish_pop(c,pos+i);
+			}
+			if(count!=0)
+			{
+				wake(_waiting_pushers,_not_full);
+			}
+			return count;
+		}
+
+		/*
+			Constructs an element at the back, waiting for room.
+		*/
+		template<typename... Args>
+		void emplace(Args&&... args)
+		{
+			T temp(std::forward<Args>(args)...);
+			push(std::move(temp));
+		}
+
+		void push(T const& value)
+		{
+			T temp(value);
+			push(std::move(temp));
+		}
+
+		void push(T&& value)
+		{
+			while(!try_push(std::move(value)))
+			{
+				sleep_until(_waiting_pushers,_not_full,[this]
+					{
+						return !full_now();
+					});
+			}
+		}
+
+		/*
+			Pops the front element into out, waiting for one to be available.
+		*/
+		void pop(T& out)
+		{
+			while(!try_pop(out))
+			{
+				sleep_until(_waiting_poppers,_not_empty,[this]
+					{
+						return !empty_now();
+					});
+			}
+		}
+
+		/*
+			Pushes all n elements from first, waiting for room as needed.
+		*/
+		template<typename Iter>
+		void push_n(Iter first,size_type n)
+		{
+			while(n!=0)
+			{
+				auto const pushed=try_push_n(first,n);
+				if(pushed==0)
+				{
+					sleep_until(_waiting_pushers,_not_full,[this]
+						{
+							return !full_now();
+						});
+					continue;
+				}
+				std::advance(first,pushed);
+				n-=pushed;
+			}
+		}
+
+		/*
+			Waits for at least one element, then pops up to n elements into out and returns the number popped.
+		*/
+		template<typename OutIter>
+		size_type pop_n(OutIter out,size_type n)
+		{
+			if(n==0)
+			{
+				return 0;
+			}
+			while(true)
+			{
+				auto const popped=try_pop_n(out,n);
+				if(popped!=0)
+				{
+					return popped;
+				}
+				sleep_until(_waiting_poppers,_not_empty,[this]
+					{
+						return !empty_now();
+					});
+			}
+		}
+	};
+}
+#endif
@@ -1173,6 +1173,11 @@ namespace exlib {
 	template<typename T>
 	struct noop_destructor_after_move:std::true_type {};
 
+	//whether a T can be moved to other memory with memcpy, leaving the old bytes dead without running the destructor
+	//specialize for types that can be, such as ones that only own heap memory through pointers
+	template<typename T>
+	struct is_trivially_relocatable:std::is_trivially_copyable<T> {};
+
 	template<typename U,U val,typename Rep>
 	struct is_representable:
 		std::integral_constant<bool,